@@ -107,6 +107,8 @@ object python_interpreter_t::import(const string& str)
 
     object newmod(handle<>(borrowed(mod)));
 
+    clear_functors();
+
 #if 1
     // Import all top-level entries directly into the main namespace
     dict m_nspace(handle<>(borrowed(PyModule_GetDict(mod))));
@@ -148,6 +150,8 @@ object python_interpreter_t::eval(std::istream& in, py_eval_mode_t mode)
     case PY_EVAL_STMT:  input_mode = Py_single_input; break;
     case PY_EVAL_MULTI: input_mode = Py_file_input;   break;
     }
+    if (mode != PY_EVAL_EXPR)
+      clear_functors();
     assert(Py_IsInitialized());
     return python_run(this, buffer, input_mode);
   }
@@ -167,6 +171,8 @@ object python_interpreter_t::eval(const string& str, py_eval_mode_t mode)
     case PY_EVAL_STMT:  input_mode = Py_single_input; break;
     case PY_EVAL_MULTI: input_mode = Py_file_input;   break;
     }
+    if (mode != PY_EVAL_EXPR)
+      clear_functors();
     assert(Py_IsInitialized());
     return python_run(this, str, input_mode);
   }
@@ -177,6 +183,30 @@ object python_interpreter_t::eval(const string& str, py_eval_mode_t mode)
   return object();
 }
 
+expr_t::ptr_op_t python_interpreter_t::lookup(const string& name)
+{
+  functor_map::iterator i = functors.find(name);
+  if (i != functors.end())
+    return (*i).second;
+
+  // Plain identifiers are found in the namespace, or in the builtins,
+  // rather than by compiling and evaluating them as code.
+  expr_t::ptr_op_t def;
+  if (name.find_first_of(".()[] ") == string::npos) {
+    global_t global(name, nspace);
+    if (! global.resolve())
+      return expr_t::ptr_op_t();
+    def = WRAP_FUNCTOR(global);
+  }
+  else if (object func = eval(name)) {
+    def = WRAP_FUNCTOR(functor_t(name, func));
+  }
+
+  if (def)
+    functors.insert(functor_map::value_type(name, def));
+  return def;
+}
+
 value_t python_interpreter_t::functor_t::operator()(call_scope_t& args)
 {
   try {
@@ -184,16 +214,21 @@ value_t python_interpreter_t::functor_t::operator()(call_scope_t& args)
       return extract<value_t>(func.ptr());
     } else {
       if (args.size() > 0) {
-	list arglist;
-	if (args.value().is_sequence())
-	  foreach (const value_t& value, args.value().as_sequence())
-	    arglist.append(value);
-	else
-	  arglist.append(args.value());
-
-	if (PyObject * val =
-	    PyObject_CallObject(func.ptr(),
-				boost::python::tuple(arglist).ptr())) {
+	// Build the argument tuple directly, instead of going by way of
+	// a temporary list.
+	handle<> arglist;
+	if (args.value().is_sequence()) {
+	  const value_t::sequence_t& seq(args.value().as_sequence());
+	  arglist = handle<>(PyTuple_New(seq.size()));
+	  for (std::size_t i = 0; i < seq.size(); i++)
+	    PyTuple_SET_ITEM(arglist.get(), i, incref(object(seq[i]).ptr()));
+	} else {
+	  arglist = handle<>(PyTuple_New(1));
+	  PyTuple_SET_ITEM(arglist.get(), 0,
+			   incref(object(args.value()).ptr()));
+	}
+
+	if (PyObject * val = PyObject_CallObject(func.ptr(), arglist.get())) {
 	  value_t result = extract<value_t>(val)();
 	  Py_DECREF(val);
 	  return result;
@@ -218,6 +253,25 @@ value_t python_interpreter_t::functor_t::operator()(call_scope_t& args)
   return NULL_VALUE;
 }
 
+boost::optional<object> python_interpreter_t::global_t::resolve() const
+{
+  PyObject * obj = PyDict_GetItemString(nspace.ptr(), name.c_str());
+  if (! obj)
+    obj = PyDict_GetItemString(PyEval_GetBuiltins(), name.c_str());
+  if (! obj)
+    return none;
+  return object(handle<>(borrowed(obj)));
+}
+
+value_t python_interpreter_t::global_t::operator()(call_scope_t& args)
+{
+  boost::optional<object> bound = resolve();
+  if (! bound)
+    throw_(calc_error, "Python name '" << name << "' is no longer bound");
+  func = *bound;
+  return functor_t::operator()(args);
+}
+
 value_t python_interpreter_t::lambda_t::operator()(call_scope_t& args)
 {
   try {
@@ -43,6 +43,13 @@ class python_interpreter_t : public noncopyable, public scope_t
 {
   boost::python::handle<> mmodule;
 
+  // Symbols already resolved by lookup(), so that each name is only
+  // looked up in the Python namespace once.  Importing a module or
+  // evaluating a statement may rebind names, and so clears the cache.
+  typedef std::map<const string, expr_t::ptr_op_t> functor_map;
+
+  functor_map functors;
+
   python_interpreter_t();
 
 public:
@@ -91,10 +98,37 @@ public:
     virtual value_t operator()(call_scope_t& args);
   };
 
-  virtual expr_t::ptr_op_t lookup(const string& name) {
-    if (boost::python::object func = eval(name))
-      return WRAP_FUNCTOR(functor_t(name, func));
-    return expr_t::ptr_op_t();
+  // A plain name, bound in the namespace or among the builtins.  It is
+  // looked up again on every call, since Python code may rebind it with
+  // `global' at any time, which no cache here would notice.
+  class global_t : public functor_t {
+    global_t();
+    boost::python::dict nspace;
+    string		name;
+  public:
+    global_t(const string& _name, boost::python::dict _nspace)
+      : functor_t(_name, boost::python::object()),
+	nspace(_nspace), name(_name) {
+      TRACE_CTOR(global_t, "const string&, boost::python::dict");
+    }
+    global_t(const global_t& other)
+      : functor_t(other), nspace(other.nspace), name(other.name) {
+      TRACE_CTOR(global_t, "copy");
+    }
+    virtual ~global_t() throw() {
+      TRACE_DTOR(global_t);
+    }
+
+    // What the name is bound to now, if anything.
+    optional<boost::python::object> resolve() const;
+
+    virtual value_t operator()(call_scope_t& args);
+  };
+
+  virtual expr_t::ptr_op_t lookup(const string& name);
+
+  void clear_functors() {
+    functors.clear();
   }
 
   class lambda_t : public functor_t {
@@ -34,6 +34,8 @@
 
 namespace ledger {
 
+THREAD_LOCAL xdata_pool_t<account_t::xdata_t> * account_t::xdata_pool = NULL;
+
 account_t::~account_t()
 {
   TRACE_DTOR(account_t);
@@ -134,13 +136,13 @@ namespace {
   }
 
   value_t get_total(account_t& account) {
-    assert(account.xdata_);
-    return account.xdata_->total;
+    assert(account.has_xdata());
+    return account.xdata().total;
   }
 
   value_t get_amount(account_t& account) {
-    assert(account.xdata_);
-    return account.xdata_->value;
+    assert(account.has_xdata());
+    return account.xdata().value;
   }
 
   value_t get_depth(account_t& account) {
@@ -190,7 +192,7 @@ expr_t::ptr_op_t account_t::lookup(const string& name)
     break;
   }
 
-  return session_t::current->current_report->lookup(name);
+  return current_report().lookup(name);
 }
 
 bool account_t::valid() const
@@ -233,7 +235,7 @@ void account_t::calculate_sums()
   }
 
   call_scope_t args(*this);
-  value_t amount(session_t::current->current_report->get_amount_expr(args));
+  value_t amount(current_report().get_amount_expr(args));
   if (! amount.is_null()) {
     add_or_set_value(xd.total, amount);
     xd.total_count += xd.count;
@@ -34,6 +34,7 @@
 
 #include "utils.h"
 #include "scope.h"
+#include "xdata.h"
 
 namespace ledger {
 
@@ -121,6 +122,7 @@ class account_t : public scope_t
 	virtuals(0), dflags(0)
     {
       TRACE_CTOR(account_t::xdata_t, "");
+      COUNT_CTOR(account_t::xdata_t);
     }
     xdata_t(const xdata_t& other)
       : supports_flags<>(other.flags()),
@@ -133,29 +135,36 @@ class account_t : public scope_t
 	dflags(other.dflags)
     {
       TRACE_CTOR(account_t::xdata_t, "copy");
+      COUNT_CTOR(account_t::xdata_t);
     }
 
     ~xdata_t() throw() {
       TRACE_DTOR(account_t::xdata_t);
+      COUNT_DTOR(account_t::xdata_t);
     }
   };
 
-  // This variable holds optional "extended data" which is usually produced
-  // only during reporting, and only for the transaction set being reported.
-  // It's a memory-saving measure to delay allocation until the last possible
-  // moment.
-  mutable optional<xdata_t> xdata_;
+  // This variable refers to optional "extended data" which is usually
+  // produced only during reporting.  The data itself lives in xdata_pool,
+  // which is reset once the report is done (see session_t::clean_accounts).
+  // The pool belongs to the current session; see xact_t::xdata_pool.
+  static THREAD_LOCAL xdata_pool_t<xdata_t> * xdata_pool;
+
+  mutable xdata_pool_t<xdata_t>::handle_t xdata_;
 
   bool has_xdata() const {
-    return xdata_;
+    return xdata_pool->valid(xdata_);
   }
   void clear_xdata() {
-    xdata_ = none;
+    xdata_pool->release(xdata_);
   }
   xdata_t& xdata() {
-    if (! xdata_)
-      xdata_ = xdata_t();
-    return *xdata_;
+    if (! has_xdata())
+      return xdata_pool->acquire(xdata_);
+    return (*xdata_pool)[xdata_];
+  }
+  const xdata_t& xdata() const {
+    return (*xdata_pool)[xdata_];
   }
 
   void calculate_sums();
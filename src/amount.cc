@@ -46,53 +46,57 @@
 
 namespace ledger {
 
-commodity_pool_t * amount_t::current_pool = NULL;
+THREAD_LOCAL commodity_pool_t * amount_t::current_pool = NULL;
 
-bool amount_t::keep_base = false;
+THREAD_LOCAL bool amount_t::keep_base = false;
 
-bool amount_t::keep_price = false;
-bool amount_t::keep_date  = false;
-bool amount_t::keep_tag	  = false;
+THREAD_LOCAL bool amount_t::keep_price = false;
+THREAD_LOCAL bool amount_t::keep_date  = false;
+THREAD_LOCAL bool amount_t::keep_tag	= false;
 
-bool amount_t::stream_fullstrings = false;
+THREAD_LOCAL bool amount_t::stream_fullstrings = false;
 
-#ifndef THREADSAFE
 /**
- * These global temporaries are pre-initialized for the sake of
- * efficiency, and reused over and over again.
+ * These temporaries are pre-initialized for the sake of efficiency,
+ * and reused over and over again.  Each thread has its own pair,
+ * readied by amount_t::initialize.
  */
-static mpz_t temp;
-static mpz_t divisor;
-#endif
+static THREAD_LOCAL mpz_t temp;
+static THREAD_LOCAL mpz_t divisor;
 
 struct amount_t::bigint_t : public supports_flags<>
 {
 #define BIGINT_BULK_ALLOC 0x01
 #define BIGINT_KEEP_PREC  0x02
+#define BIGINT_SHARED	  0x04
 
   mpz_t		 val;
   precision_t	 prec;
-  uint_least16_t ref;
+  uint_least32_t ref;
   uint_fast32_t	 index;
 
 #define MPZ(bigint) ((bigint)->val)
 
   bigint_t() : prec(0), ref(1), index(0) {
     TRACE_CTOR(bigint_t, "");
+    COUNT_CTOR(bigint_t);
     mpz_init(val);
   }
   bigint_t(mpz_t _val) : prec(0), ref(1), index(0) {
     TRACE_CTOR(bigint_t, "mpz_t");
+    COUNT_CTOR(bigint_t);
     mpz_init_set(val, _val);
   }
   bigint_t(const bigint_t& other)
-    : supports_flags<>(other.flags() & ~BIGINT_BULK_ALLOC),
+    : supports_flags<>(other.flags() & ~(BIGINT_BULK_ALLOC | BIGINT_SHARED)),
       prec(other.prec), ref(1), index(0) {
     TRACE_CTOR(bigint_t, "copy");
+    COUNT_CTOR(bigint_t);
     mpz_init_set(val, other.val);
   }
   ~bigint_t() {
     TRACE_DTOR(bigint_t);
+    COUNT_DTOR(bigint_t);
     assert(ref == 0);
     mpz_clear(val);
   }
@@ -102,8 +106,8 @@ struct amount_t::bigint_t : public supports_flags<>
       DEBUG("ledger.validate", "amount_t::bigint_t: prec > 128");
       return false;
     }
-    if (ref > 16535) {
-      DEBUG("ledger.validate", "amount_t::bigint_t: ref > 16535");
+    if (ref > 0x7fffffff) {
+      DEBUG("ledger.validate", "amount_t::bigint_t: ref > 0x7fffffff");
       return false;
     }
     return true;
@@ -119,9 +123,17 @@ void amount_t::initialize()
 {
   mpz_init(temp);
   mpz_init(divisor);
+}
 
-  if (! current_pool)
-    current_pool = new commodity_pool_t;
+void amount_t::shutdown()
+{
+  mpz_clear(temp);
+  mpz_clear(divisor);
+}
+
+void amount_t::add_builtin_commodities()
+{
+  assert(current_pool);
 
   // Add time commodity conversions, so that timelog's may be parsed
   // in terms of seconds, but reported as minutes or hours.
@@ -135,17 +147,6 @@ void amount_t::initialize()
   }
 }
 
-void amount_t::shutdown()
-{
-  mpz_clear(temp);
-  mpz_clear(divisor);
-
-  if (current_pool) {
-    checked_delete(current_pool);
-    current_pool = NULL;
-  }
-}
-
 void amount_t::_copy(const amount_t& amt)
 {
   assert(amt.valid());
@@ -155,8 +156,9 @@ void amount_t::_copy(const amount_t& amt)
       _release();
 
     // Never maintain a pointer into a bulk allocation pool; such
-    // pointers are not guaranteed to remain.
-    if (amt.quantity->has_flags(BIGINT_BULK_ALLOC)) {
+    // pointers are not guaranteed to remain.  Shared quantities are
+    // copied as well, since other threads may be reading them.
+    if (amt.quantity->has_flags(BIGINT_BULK_ALLOC | BIGINT_SHARED)) {
       quantity = new bigint_t(*amt.quantity);
     } else {
       quantity = amt.quantity;
@@ -170,6 +172,14 @@ void amount_t::_copy(const amount_t& amt)
   assert(valid());
 }
 
+void amount_t::mark_shared()
+{
+  assert(valid());
+
+  if (quantity)
+    quantity->add_flags(BIGINT_SHARED);
+}
+
 void amount_t::_dup()
 {
   assert(valid());
@@ -346,6 +356,29 @@ int amount_t::compare(const amount_t& amt) const
   }
 }
 
+std::size_t amount_t::hash() const
+{
+  if (! quantity)
+    return 0;
+
+  // Strip trailing zeroes first, so that equal quantities held at
+  // different precisions produce the same hash.
+  mpz_set(temp, MPZ(quantity));
+  precision_t prec = quantity->prec;
+  while (prec > 0 && mpz_divisible_ui_p(temp, 10)) {
+    mpz_divexact_ui(temp, temp, 10);
+    prec--;
+  }
+
+  std::size_t seed = 0;
+  hash_combine(seed, has_commodity() ? commodity().base.get() : NULL);
+  hash_combine(seed, prec);
+  hash_combine(seed, mpz_sgn(temp));
+  for (std::size_t i = 0; i < mpz_size(temp); i++)
+    hash_combine(seed, mpz_getlimbn(temp, i));
+
+  return seed;
+}
 
 amount_t& amount_t::operator+=(const amount_t& amt)
 {
@@ -965,9 +998,11 @@ bool amount_t::parse(std::istream& in, flags_t flags)
     quantity->prec = 0;
   }
 
-  // Set the commodity's flags and precision accordingly
+  // Set the commodity's flags and precision accordingly, unless other
+  // threads may be reading them
 
-  if (commodity_ && ! (flags & AMOUNT_PARSE_NO_MIGRATE)) {
+  if (commodity_ && ! (flags & AMOUNT_PARSE_NO_MIGRATE) &&
+      ! current_pool->frozen) {
     commodity().add_flags(comm_flags);
 
     if (quantity->prec > commodity().precision())
@@ -1034,185 +1069,347 @@ void amount_t::parse_conversion(const string& larger_str,
 }
 
 
-void amount_t::print(std::ostream& _out, bool omit_commodity,
-		     bool full_precision) const
-{
-  assert(valid());
+namespace {
+  // Set value to the quantity of an amount, already unreduced for display,
+  // as an integer scaled to the precision it is displayed at, and return
+  // that precision.
+  amount_t::precision_t scaled_mantissa(const amount_t& base, mpz_t value,
+					bool full_precision = false)
+  {
+    commodity_t&	  comm(base.commodity());
+    amount_t::precision_t precision = base.quantity->prec;
+    if (comm && ! full_precision &&
+	! base.quantity->has_flags(BIGINT_KEEP_PREC))
+      precision = comm.precision();
 
-  if (! quantity) {
-    _out << "<null>";
-    return;
+    if (precision < base.quantity->prec) {
+      mpz_round(value, MPZ(base.quantity), base.quantity->prec, precision);
+    }
+    else if (precision > base.quantity->prec) {
+      mpz_ui_pow_ui(divisor, 10, precision - base.quantity->prec);
+      mpz_mul(value, MPZ(base.quantity), divisor);
+    }
+    else {
+      mpz_set(value, MPZ(base.quantity));
+    }
+    return precision;
   }
 
-  amount_t base(*this);
-  if (! amount_t::keep_base)
-    base.in_place_unreduce();
+  // Only amounts in a commodity with a larger unit need to be copied
+  // and unreduced before they are displayed.
+  bool needs_unreduce(const amount_t& amt)
+  {
+    return ! amount_t::keep_base && amt.commodity().larger();
+  }
 
-  std::ostringstream out;
+  amount_t::precision_t display_mantissa(const amount_t& amt, mpz_t value)
+  {
+    if (! needs_unreduce(amt))
+      return scaled_mantissa(amt, value);
 
-  mpz_t quotient;
-  mpz_t rquotient;
-  mpz_t remainder;
+    amount_t base(amt);
+    base.in_place_unreduce();
+    return scaled_mantissa(base, value);
+  }
 
-  mpz_init(quotient);
-  mpz_init(rquotient);
-  mpz_init(remainder);
+  // Read a non-negative value into a 64-bit integer, if it fits, straight
+  // from its limbs.
+  bool mpz_get_u64(mpz_t value, boost::uint64_t& result)
+  {
+    assert(mpz_sgn(value) >= 0);
+    if (mpz_sizeinbase(value, 2) > 64)
+      return false;
 
-  bool negative = false;
+#if GMP_NUMB_BITS >= 64
+    result = mpz_getlimbn(value, 0);
+#else
+    result = 0;
+    for (std::size_t i = mpz_size(value); i > 0; i--)
+      result = (result << GMP_NUMB_BITS) | mpz_getlimbn(value, i - 1);
+#endif
+    return true;
+  }
 
-  // Ensure the value is rounded to the commodity's precision before
-  // outputting it.  NOTE: `rquotient' is used here as a temp variable!
+  const char digit_pairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
 
-  commodity_t& comm(base.commodity());
-  precision_t  precision = 0;
+  // Write the decimal digits of n so that they end just before `end', two
+  // at a time, and return where they begin.
+  char * format_u64(boost::uint64_t n, char * end)
+  {
+    while (n >= 100) {
+      const char * pair = digit_pairs + (n % 100) * 2;
+      n /= 100;
+      *--end = pair[1];
+      *--end = pair[0];
+    }
+    if (n >= 10) {
+      const char * pair = digit_pairs + n * 2;
+      *--end = pair[1];
+      *--end = pair[0];
+    } else {
+      *--end = static_cast<char>('0' + n);
+    }
+    return end;
+  }
 
-  if (quantity) {
-    if (! comm || full_precision || base.quantity->has_flags(BIGINT_KEEP_PREC)) {
-      mpz_ui_pow_ui(divisor, 10, base.quantity->prec);
-      mpz_tdiv_qr(quotient, remainder, MPZ(base.quantity), divisor);
-      precision = base.quantity->prec;
+  // The decimal digits of a non-negative value.  Anything that fits in 64
+  // bits is converted without calling into GMP, which is nearly every
+  // amount ever printed.
+  class decimal_digits_t : public noncopyable
+  {
+    char	      local[32];
+    std::vector<char> big;
+    const char *      str;
+    std::size_t	      len;
+
+  public:
+    explicit decimal_digits_t(mpz_t value) {
+      boost::uint64_t small;
+      if (mpz_get_u64(value, small)) {
+	str = format_u64(small, local + sizeof(local));
+	len = (local + sizeof(local)) - str;
+      } else {
+	// mpz_sizeinbase may overestimate by one; allow for that and the
+	// NUL.
+	big.resize(mpz_sizeinbase(value, 10) + 2);
+	mpz_get_str(&big[0], 10, value);
+	str = &big[0];
+	len = std::strlen(str);
+      }
     }
-    else if (comm.precision() < base.quantity->prec) {
-      mpz_round(rquotient, MPZ(base.quantity), base.quantity->prec,
-		comm.precision());
-      mpz_ui_pow_ui(divisor, 10, comm.precision());
-      mpz_tdiv_qr(quotient, remainder, rquotient, divisor);
-      precision = comm.precision();
+
+    const char * data() const {
+      return str;
     }
-    else if (comm.precision() > base.quantity->prec) {
-      mpz_ui_pow_ui(divisor, 10, comm.precision() - base.quantity->prec);
-      mpz_mul(rquotient, MPZ(base.quantity), divisor);
-      mpz_ui_pow_ui(divisor, 10, comm.precision());
-      mpz_tdiv_qr(quotient, remainder, rquotient, divisor);
-      precision = comm.precision();
+    std::size_t size() const {
+      return len;
+    }
+  };
+
+  // Lay out `digits', a mantissa with `precision' implied decimal places,
+  // into buf, which must hold at least len + len / 3 + precision + 2
+  // characters.  The integer part is grouped by `thousands' unless that is
+  // NUL; trailing zeros of the fraction are dropped, keeping at least
+  // `min_places' of them.  Returns the number of characters written.
+  std::size_t format_quantity(char * buf, const char * digits,
+			      std::size_t len,
+			      amount_t::precision_t precision,
+			      amount_t::precision_t min_places,
+			      char thousands, char decimal_mark)
+  {
+    char *	out	 = buf;
+    std::size_t int_len	 = len > precision ? len - precision : 0;
+    std::size_t frac_len = len - int_len;
+    std::size_t padding	 = precision - frac_len;
+
+    if (int_len == 0) {
+      *out++ = '0';
     }
-    else if (base.quantity->prec) {
-      mpz_ui_pow_ui(divisor, 10, base.quantity->prec);
-      mpz_tdiv_qr(quotient, remainder, MPZ(base.quantity), divisor);
-      precision = base.quantity->prec;
+    else if (! thousands) {
+      std::memcpy(out, digits, int_len);
+      out += int_len;
     }
     else {
-      mpz_set(quotient, MPZ(base.quantity));
-      mpz_set_ui(remainder, 0);
-      precision = 0;
+      std::size_t lead = int_len - ((int_len - 1) / 3) * 3;
+      std::memcpy(out, digits, lead);
+      out += lead;
+
+      for (const char * p = digits + lead; p < digits + int_len; p += 3) {
+	out[0] = thousands;
+	out[1] = p[0];
+	out[2] = p[1];
+	out[3] = p[2];
+	out += 4;
+      }
     }
 
-    if (mpz_sgn(quotient) < 0 || mpz_sgn(remainder) < 0) {
-      negative = true;
+    const char * frac = digits + int_len;
+    std::size_t	 used = frac_len;
+    while (used > 0 && frac[used - 1] == '0')
+      used--;
+
+    std::size_t places = used > 0 ? padding + used : 0;
+    if (places < min_places)
+      places = std::min<std::size_t>(min_places, precision);
+
+    if (places > 0) {
+      *out++ = decimal_mark;
 
-      mpz_abs(quotient, quotient);
-      mpz_abs(remainder, remainder);
+      std::size_t zeros = std::min(places, padding);
+      std::memset(out, '0', zeros);
+      out += zeros;
+
+      std::memcpy(out, frac, places - zeros);
+      out += places - zeros;
     }
-    mpz_set(rquotient, remainder);
-  }
 
-  if (! omit_commodity && ! comm.has_flags(COMMODITY_STYLE_SUFFIXED)) {
-    comm.print(out);
-    if (comm.has_flags(COMMODITY_STYLE_SEPARATED))
-      out << " ";
+    return out - buf;
   }
+}
 
-  if (negative)
-    out << "-";
+namespace {
+  // Append an amount, already unreduced for display, as print() shows
+  // it.
+  void append_amount(const amount_t& base, std::string& out,
+		     bool omit_commodity, bool full_precision)
+  {
+    commodity_t& comm(base.commodity());
 
-  if (! quantity || mpz_sgn(quotient) == 0) {
-    out << '0';
-  }
-  else if (omit_commodity || ! comm.has_flags(COMMODITY_STYLE_THOUSANDS)) {
-    char * p = mpz_get_str(NULL, 10, quotient);
-    out << p;
-    std::free(p);
-  }
-  else {
-    std::list<string> strs;
-    char buf[4];
-
-    for (int powers = 0; true; powers += 3) {
-      if (powers > 0) {
-	mpz_ui_pow_ui(divisor, 10, powers);
-	mpz_tdiv_q(temp, quotient, divisor);
-	if (mpz_sgn(temp) == 0)
-	  break;
-	mpz_tdiv_r_ui(temp, temp, 1000);
-      } else {
-	mpz_tdiv_r_ui(temp, quotient, 1000);
-      }
-      mpz_get_str(buf, 10, temp);
-      strs.push_back(buf);
+    // Ensure the value is rounded to the commodity's precision before
+    // outputting it.
+    mpz_t value;
+    mpz_init(value);
+    amount_t::precision_t precision =
+      scaled_mantissa(base, value, full_precision);
+
+    bool negative = mpz_sgn(value) < 0;
+    if (negative)
+      mpz_neg(value, value);
+
+    decimal_digits_t digits(value);
+    mpz_clear(value);
+
+    char thousands = '\0';
+    char decimal_mark = '.';
+    if (! omit_commodity) {
+      if (comm.has_flags(COMMODITY_STYLE_THOUSANDS))
+	thousands = comm.has_flags(COMMODITY_STYLE_EUROPEAN) ? '.' : ',';
+      if (comm.has_flags(COMMODITY_STYLE_EUROPEAN))
+	decimal_mark = ',';
     }
 
-    bool printed = false;
+    if (! omit_commodity && ! comm.has_flags(COMMODITY_STYLE_SUFFIXED)) {
+      out += comm.symbol();
+      if (comm.has_flags(COMMODITY_STYLE_SEPARATED))
+	out += ' ';
+    }
 
-    for (std::list<string>::reverse_iterator i = strs.rbegin();
-	 i != strs.rend();
-	 i++) {
-      if (printed) {
-	out << (comm.has_flags(COMMODITY_STYLE_EUROPEAN) ? '.' : ',');
-	out.width(3);
-	out.fill('0');
-      }
-      out << *i;
+    if (negative)
+      out += '-';
+
+    // The quantity is laid out in place, at the end of the string.
+    std::size_t start = out.length();
+    out.resize(start + digits.size() + digits.size() / 3 + precision + 2);
+    out.resize(start + format_quantity(&out[start], digits.data(),
+				       digits.size(), precision,
+				       comm.precision(), thousands,
+				       decimal_mark));
+
+    if (! omit_commodity && comm.has_flags(COMMODITY_STYLE_SUFFIXED)) {
+      if (comm.has_flags(COMMODITY_STYLE_SEPARATED))
+	out += ' ';
+      out += comm.symbol();
+    }
+
+    // If there are any annotations associated with this commodity,
+    // output them now.
 
-      printed = true;
+    if (! omit_commodity && comm.annotated) {
+      annotated_commodity_t& ann(static_cast<annotated_commodity_t&>(comm));
+      assert(&*ann.details.price != &base);
+      std::ostringstream annotations;
+      ann.write_annotations(annotations);
+      out += annotations.str();
     }
   }
+}
 
-  if (quantity && precision) {
-    std::ostringstream final;
-    final.width(precision);
-    final.fill('0');
-    char * p = mpz_get_str(NULL, 10, rquotient);
-    final << p;
-    std::free(p);
-
-    const string& str(final.str());
-    int i, len = str.length();
-    const char * q = str.c_str();
-    for (i = len; i > 0; i--)
-      if (q[i - 1] != '0')
-	break;
-
-    string ender;
-    if (i == len)
-      ender = str;
-    else if (i < comm.precision())
-      ender = string(str, 0, comm.precision());
-    else
-      ender = string(str, 0, i);
-
-    if (! ender.empty()) {
-      if (omit_commodity)
-	out << '.';
-      else
-	out << (comm.has_flags(COMMODITY_STYLE_EUROPEAN) ? ',' : '.');
-      out << ender;
-    }
+void amount_t::append(std::string& out, bool omit_commodity,
+		      bool full_precision) const
+{
+  assert(valid());
+
+  if (! quantity) {
+    out += "<null>";
+    return;
   }
 
-  if (! omit_commodity && comm.has_flags(COMMODITY_STYLE_SUFFIXED)) {
-    if (comm.has_flags(COMMODITY_STYLE_SEPARATED))
-      out << " ";
-    comm.print(out);
+  if (! needs_unreduce(*this)) {
+    append_amount(*this, out, omit_commodity, full_precision);
+  } else {
+    amount_t base(*this);
+    base.in_place_unreduce();
+    append_amount(base, out, omit_commodity, full_precision);
   }
+}
 
-  mpz_clear(quotient);
-  mpz_clear(rquotient);
-  mpz_clear(remainder);
+void amount_t::print(std::ostream& out, bool omit_commodity,
+		     bool full_precision) const
+{
+  // Things are formatted into a string first, so that if anyone has
+  // specified a width or fill for out, it will be applied to the
+  // entire amount string, and not just the first part.
+
+  string str;
+  append(str, omit_commodity, full_precision);
+  out << str;
+}
+
+void amount_t::append_quantity(std::string& out) const
+{
+  assert(valid());
+
+  if (! quantity)
+    return;
 
-  // If there are any annotations associated with this commodity,
-  // output them now.
+  mpz_t value;
+  mpz_init(value);
+  precision_t precision = display_mantissa(*this, value);
 
-  if (! omit_commodity && comm.annotated) {
-    annotated_commodity_t& ann(static_cast<annotated_commodity_t&>(comm));
-    assert(&*ann.details.price != this);
-    ann.write_annotations(out);
+  if (mpz_sgn(value) < 0) {
+    out += '-';
+    mpz_neg(value, value);
   }
 
-  // Things are output to a string first, so that if anyone has
-  // specified a width or fill for _out, it will be applied to the
-  // entire amount string, and not just the first part.
+  decimal_digits_t digits(value);
+  mpz_clear(value);
+
+  std::size_t len = digits.size();
+  if (len <= precision) {
+    out += "0.";
+    out.append(precision - len, '0');
+    out.append(digits.data(), len);
+  } else {
+    out.append(digits.data(), len - precision);
+    if (precision > 0) {
+      out += '.';
+      out.append(digits.data() + len - precision, precision);
+    }
+  }
+}
+
+bool amount_t::fixed_quantity(boost::int64_t& mantissa,
+			      precision_t& places) const
+{
+  assert(valid());
+
+  if (! quantity) {
+    mantissa = 0;
+    places   = 0;
+    return true;
+  }
 
-  _out << out.str();
+  mpz_t value;
+  mpz_init(value);
+  places = display_mantissa(*this, value);
+
+  bool negative = mpz_sgn(value) < 0;
+  if (negative)
+    mpz_neg(value, value);
+
+  boost::uint64_t magnitude;
+  bool fits = (mpz_get_u64(value, magnitude) &&
+	       (magnitude >> 63) == 0);
+  if (fits)
+    mantissa = negative ? - boost::int64_t(magnitude)
+			: boost::int64_t(magnitude);
+  mpz_clear(value);
+  return fits;
 }
 
 void amount_t::read(std::istream& in)
@@ -1243,7 +1440,7 @@ void amount_t::read(std::istream& in)
     unsigned short len;
     in.read(reinterpret_cast<char *>(&len), sizeof(len));
     assert(len < 4096);
-    static char buf[4096];
+    char buf[4096];
     in.read(buf, len);
     mpz_import(MPZ(quantity), len / sizeof(short), 1, sizeof(short),
 	       0, 0, buf);
@@ -1353,7 +1550,7 @@ void amount_t::write(std::ostream& out, unsigned int index) const
     out.write(&byte, sizeof(byte));
 
     std::size_t size;
-    static char buf[4096];
+    char buf[4096];
     mpz_export(buf, &size, 1, sizeof(short), 0, 0, MPZ(quantity));
     unsigned short len = size * sizeof(short);
     out.write(reinterpret_cast<char *>(&len), sizeof(len));
@@ -1366,7 +1563,8 @@ void amount_t::write(std::ostream& out, unsigned int index) const
     out.write(&byte, sizeof(byte));
 
     out.write(reinterpret_cast<char *>(&quantity->prec), sizeof(quantity->prec));
-    bigint_t::flags_t tflags = quantity->flags() & ~BIGINT_BULK_ALLOC;
+    bigint_t::flags_t tflags =
+      quantity->flags() & ~(BIGINT_BULK_ALLOC | BIGINT_SHARED);
     assert(sizeof(tflags) == sizeof(bigint_t::flags_t));
     out.write(reinterpret_cast<char *>(&tflags), sizeof(tflags));
   } else {
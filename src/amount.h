@@ -89,12 +89,20 @@ class amount_t
 public:
   /**
    * The initialize and shutdown methods ready the amount subsystem
-   * for use.  Normally they are called by `ledger::initialize' and
-   * `ledger::shutdown'.
+   * for use by the calling thread.  Normally they are called by
+   * `set_session_context', the first time a thread makes a session
+   * current and once it gives up its last one.
    */
   static void initialize();
   static void shutdown();
 
+  /**
+   * add_builtin_commodities defines the time commodities (s, m and h)
+   * in the current pool.  A session calls it once, when its new pool
+   * is first made current.
+   */
+  static void add_builtin_commodities();
+
   /**
    * The amount's decimal precision.
    */
@@ -102,9 +110,10 @@ public:
 
   /**
    * The current_pool is a static variable indicating which commodity
-   * pool should be used.
+   * pool should be used.  It is per-thread, and points into whichever
+   * session the thread last passed to `set_session_context'.
    */
-  static commodity_pool_t * current_pool;
+  static THREAD_LOCAL commodity_pool_t * current_pool;
 
   /**
    * The `keep_base' member determines whether scalable commodities
@@ -118,7 +127,7 @@ public:
    * which is "5.2h" in the second case.  If `keep_base' is true, this
    * amount is displayed as "18720s".
    */
-  static bool keep_base;
+  static THREAD_LOCAL bool keep_base;
 
   /**
    * The following three members determine whether lot details are
@@ -135,9 +144,9 @@ public:
    * exception for adding amounts with different commodities.  In that
    * case, a balance_t object must be used to store the combined sum.
    */
-  static bool keep_price;
-  static bool keep_date;
-  static bool keep_tag;
+  static THREAD_LOCAL bool keep_price;
+  static THREAD_LOCAL bool keep_date;
+  static THREAD_LOCAL bool keep_tag;
 
   /**
    * The `stream_fullstrings' static member is currently only used by
@@ -148,7 +157,7 @@ public:
    * @see to_string
    * @see to_fullstring
    */
-  static bool stream_fullstrings;
+  static THREAD_LOCAL bool stream_fullstrings;
 
   static uint_fast32_t sizeof_bigint_t();
 
@@ -300,6 +309,14 @@ public:
     return compare(amt) > 0;
   }
 
+  /**
+   * hash() returns a hash of the amount's commodity and numerical
+   * value.  Any two amounts which are `operator==' hash alike, even if
+   * their internal precisions differ.  hash_value() is provided so
+   * that amounts may be used with boost::hash.
+   */
+  std::size_t hash() const;
+
   /**
    * Binary arithmetic operators.  Amounts support addition,
    * subtraction, multiplication and division -- but not modulus,
@@ -663,6 +680,39 @@ public:
   void print(std::ostream& out, bool omit_commodity = false,
 	     bool full_precision = false) const;
 
+  /**
+   * append(string, bool omit_commodity = false, bool full_precision =
+   * false) appends to the given string exactly what print() would
+   * write, without going through a stream.  Callers which format many
+   * amounts can reuse one buffer for all of them.
+   */
+  void append(std::string& out, bool omit_commodity = false,
+	      bool full_precision = false) const;
+
+  /**
+   * append_quantity(string) appends an amount's display value to the
+   * given string as a plain decimal number: no commodity, no digit
+   * grouping, '.' as the decimal mark, and exactly as many decimal
+   * places as the commodity displays.  It is meant for machine-read
+   * output such as CSV, and avoids the stream machinery of print().
+   */
+  void append_quantity(std::string& out) const;
+
+  /**
+   * fixed_quantity(mantissa, places) stores the same display value as
+   * a fixed-point number: mantissa / 10^places.  It returns false,
+   * leaving mantissa untouched, if the value does not fit in 64 bits.
+   */
+  bool fixed_quantity(boost::int64_t& mantissa, precision_t& places) const;
+
+  /**
+   * mark_shared() flags the amount's quantity as one that several
+   * threads may read at once.  Copies of it then get a quantity of
+   * their own instead of a reference, so that its reference count is
+   * never changed concurrently.  See session_t::freeze.
+   */
+  void mark_shared();
+
   /**
    * Serialization methods.  An amount may be deserialized from an
    * input stream or a character pointer, and it may be serialized to
@@ -761,6 +811,10 @@ inline bool amount_t::operator==(const amount_t& amt) const {
   return compare(amt) == 0;
 }
 
+inline std::size_t hash_value(const amount_t& amt) {
+  return amt.hash();
+}
+
 inline commodity_t& amount_t::commodity() const {
   return has_commodity() ? *commodity_ : *current_pool->null_commodity;
 }
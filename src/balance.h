@@ -107,40 +107,47 @@ public:
    */
   balance_t() {
     TRACE_CTOR(balance_t, "");
+    COUNT_CTOR(balance_t);
   }
   balance_t(const amount_t& amt) {
     TRACE_CTOR(balance_t, "const amount_t&");
     if (amt.is_null())
       throw_(balance_error,
 	     "Cannot initialize a balance from an uninitialized amount");
+    COUNT_CTOR(balance_t);
     if (! amt.is_realzero())
       amounts.insert(amounts_map::value_type(&amt.commodity(), amt));
   }
 #ifdef HAVE_GDTOA
   balance_t(const double val) {
     TRACE_CTOR(balance_t, "const double");
+    COUNT_CTOR(balance_t);
     amounts.insert
       (amounts_map::value_type(amount_t::current_pool->null_commodity, val));
   }
 #endif
   balance_t(const unsigned long val) {
     TRACE_CTOR(balance_t, "const unsigned long");
+    COUNT_CTOR(balance_t);
     amounts.insert
       (amounts_map::value_type(amount_t::current_pool->null_commodity, val));
   }
   balance_t(const long val) {
     TRACE_CTOR(balance_t, "const long");
+    COUNT_CTOR(balance_t);
     amounts.insert
       (amounts_map::value_type(amount_t::current_pool->null_commodity, val));
   }
 
   explicit balance_t(const string& val) {
     TRACE_CTOR(balance_t, "const string&");
+    COUNT_CTOR(balance_t);
     amount_t temp(val);
     amounts.insert(amounts_map::value_type(&temp.commodity(), temp));
   }
   explicit balance_t(const char * val) {
     TRACE_CTOR(balance_t, "const char *");
+    COUNT_CTOR(balance_t);
     amount_t temp(val);
     amounts.insert(amounts_map::value_type(&temp.commodity(), temp));
   }
@@ -151,6 +158,7 @@ public:
    */
   virtual ~balance_t() {
     TRACE_DTOR(balance_t);
+    COUNT_DTOR(balance_t);
   }
 
   /**
@@ -158,6 +166,7 @@ public:
    */
   balance_t(const balance_t& bal) : amounts(bal.amounts) {
     TRACE_CTOR(balance_t, "copy");
+    COUNT_CTOR(balance_t);
   }
 
   balance_t& operator=(const balance_t& bal) {
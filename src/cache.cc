@@ -49,20 +49,20 @@ void read_xact(const char *& data, xact_t * xact)
   }
   else if (flag == 1) {
     xact->amount.read(data);
-    xact->amount_expr = expr_t();
-    xact->amount_expr->set_text(read_string(data));
+    xact->details().amount_expr = expr_t();
+    xact->details().amount_expr->set_text(read_string(data));
   }
   else {
-    xact->amount_expr = expr_t();
-    xact->amount_expr->read(data);
+    xact->details().amount_expr = expr_t();
+    xact->details().amount_expr->read(data);
   }
 
   if (read_bool(data)) {
     xact->cost = amount_t();
     xact->cost->read(data);
 
-    xact->cost_expr = expr_t();
-    xact->cost_expr->read(data);
+    xact->details().cost_expr = expr_t();
+    xact->details().cost_expr->read(data);
   } else {
     xact->cost = none;
   }
@@ -79,8 +79,9 @@ void read_xact(const char *& data, xact_t * xact)
 
   xact->data = NULL;
 
-  if (xact->amount_expr)
-    expr_t::compute_amount(xact->amount_expr.get(), xact->amount, xact);
+  if (xact->has_amount_expr())
+    expr_t::compute_amount(xact->details().amount_expr.get(), xact->amount,
+			   xact);
 }
 
 void write_amount(std::ostream& out, amount_t& amt)
@@ -101,15 +102,10 @@ void write_xact(std::ostream& out, xact_t * xact,
     amount_t temp;
     write_amount(out, temp);
   }
-  else if (xact->amount_expr) {
+  else if (xact->has_amount_expr()) {
     write_number<unsigned char>(out, 2);
     // jww (2008-07-30): Um, is this right?
-    xact->amount_expr->write(out);
-  }
-  else if (! xact->amount_expr->text().empty()) {
-    write_number<unsigned char>(out, 1);
-    write_amount(out, xact->amount);
-    write_string(out, xact->amount_expr->text());
+    xact->details().amount_expr->write(out);
   }
   else {
     write_number<unsigned char>(out, 0);
@@ -121,7 +117,7 @@ void write_xact(std::ostream& out, xact_t * xact,
     write_bool(out, true);
     write_amount(out, *xact->cost);
     // jww (2008-07-30): What if there is no cost expression?
-    xact->cost_expr->write(out);
+    xact->details().cost_expr->write(out);
   } else {
     write_bool(out, false);
   }
@@ -169,7 +165,7 @@ void write_entry_base(std::ostream& out, entry_base_t * entry)
 
   bool ignore_calculated = false;
   foreach (transaction_t * xact, entry->xacts)
-    if (xact->amount_expr) {
+    if (xact->has_amount_expr()) {
       ignore_calculated = true;
       break;
     }
@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2003-2008, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "checkpoint.h"
+#include "iterators.h"
+#include "binary.h"
+
+namespace ledger {
+
+using namespace binary;
+
+namespace {
+  inline date_t month_of(const date_t& when) {
+    return date_t(when.year(), when.month(), 1);
+  }
+
+  // This mirrors what set_account_value does with an xact that has no
+  // extended data of its own.
+  void add_to_delta(balance_checkpoints_t::delta_t& delta, xact_t& xact)
+  {
+    if (xact.cost ||
+	(! delta.value.is_null() && ! delta.value.is_realzero())) {
+      if (delta.value.is_null())
+	delta.value = amount_t();
+      delta.value.add(xact.amount, xact.cost);
+    } else {
+      delta.value = xact.amount;
+    }
+
+    delta.count++;
+    if (xact.has_flags(XACT_VIRTUAL))
+      delta.virtuals++;
+  }
+
+  // Amounts are kept as a commodity mapping key and a full precision
+  // quantity, since the commodity pool itself is not written anywhere.
+
+  void write_amount(std::ostream& out, const amount_t& amt)
+  {
+    if (amt.has_commodity())
+      write_string(out, amt.commodity().mapping_key());
+    else
+      write_string(out, "");
+
+    // Trailing zeroes are padded back on, so that reading the quantity
+    // restores the amount's internal precision as well as its value.
+    string quantity(amt.number().to_fullstring());
+
+    string::size_type   point  = quantity.find('.');
+    amount_t::precision_t digits =
+      point == string::npos ? 0 : quantity.length() - point - 1;
+    if (digits < amt.precision()) {
+      if (point == string::npos)
+	quantity += '.';
+      quantity.append(amt.precision() - digits, '0');
+    }
+    write_string(out, quantity);
+  }
+
+  bool read_amount(std::istream& in, amount_t& amt)
+  {
+    string key = read_string(in);
+    string quantity = read_string(in);
+
+    amt.parse(quantity, AMOUNT_PARSE_NO_MIGRATE);
+    if (! key.empty()) {
+      commodity_t * comm = amount_t::current_pool->find(key);
+      if (! comm)
+	return false;
+      amt.set_commodity(*comm);
+    }
+    return true;
+  }
+
+  void write_balance(std::ostream& out, const balance_t& bal)
+  {
+    write_long(out, bal.amounts.size());
+    foreach (const balance_t::amounts_map::value_type& pair, bal.amounts)
+      write_amount(out, pair.second);
+  }
+
+  bool read_balance(std::istream& in, balance_t& bal)
+  {
+    for (std::size_t i = 0, count = read_long<std::size_t>(in);
+	 i < count;
+	 i++) {
+      amount_t amt;
+      if (! read_amount(in, amt))
+	return false;
+      bal += amt;
+    }
+    return true;
+  }
+
+  void write_value(std::ostream& out, const value_t& val)
+  {
+    switch (val.type()) {
+    case value_t::AMOUNT:
+      write_number<unsigned char>(out, 1);
+      write_amount(out, val.as_amount());
+      break;
+
+    case value_t::BALANCE:
+      write_number<unsigned char>(out, 2);
+      write_balance(out, val.as_balance());
+      break;
+
+    case value_t::BALANCE_PAIR: {
+      write_number<unsigned char>(out, 3);
+      write_balance(out, val.as_balance_pair().quantity());
+
+      value_t cost(val.cost());
+      if (cost.is_amount())
+	write_balance(out, balance_t(cost.as_amount()));
+      else
+	write_balance(out, cost.as_balance());
+      break;
+    }
+
+    default:
+      assert(val.is_null());
+      write_number<unsigned char>(out, 0);
+      break;
+    }
+  }
+
+  bool read_value(std::istream& in, value_t& val)
+  {
+    switch (read_number<unsigned char>(in)) {
+    case 1: {
+      amount_t amt;
+      if (! read_amount(in, amt))
+	return false;
+      val = amt;
+      break;
+    }
+
+    case 2: {
+      balance_t bal;
+      if (! read_balance(in, bal))
+	return false;
+      val = bal;
+      break;
+    }
+
+    case 3: {
+      balance_t quantity;
+      balance_t cost;
+      if (! read_balance(in, quantity) || ! read_balance(in, cost))
+	return false;
+      val = balance_pair_t(quantity, cost);
+      break;
+    }
+
+    default:
+      val = NULL_VALUE;
+      break;
+    }
+    return true;
+  }
+}
+
+bool balance_checkpoints_t::update()
+{
+  // Gather the current state of every source file, and count how many
+  // entries each one contributed to the session's journals.
+
+  sources_map current;
+  std::vector<std::vector<string> > keys;
+
+  foreach (journal_t& journal, session.journals) {
+    keys.push_back(std::vector<string>());
+
+    foreach (const path& source, journal.sources) {
+      keys.back().push_back(source.string());
+
+      source_t& info(current[source.string()]);
+      if (exists(source)) {
+	info.mtime = last_write_time(source);
+	info.size  = file_size(source);
+      }
+    }
+
+    foreach (entry_t * entry, journal.entries) {
+      if (entry->src_idx >= keys.back().size())
+	return false;
+      current[keys.back()[entry->src_idx]].entries++;
+    }
+
+    // Every source of the journal depends on the files its automated
+    // entries were read from.
+
+    std::set<std::size_t> rule_sources;
+    foreach (auto_entry_t * entry, journal.auto_entries) {
+      if (entry->src_idx >= keys.back().size())
+	return false;
+      rule_sources.insert(entry->src_idx);
+    }
+
+    std::ostringstream automated;
+    foreach (std::size_t idx, rule_sources) {
+      const source_t& info(current[keys.back()[idx]]);
+      automated << keys.back()[idx] << '\0' << info.mtime << '\0'
+		<< info.size << '\0';
+    }
+
+    foreach (const string& key, keys.back())
+      current[key].automated = automated.str();
+  }
+
+  if (! loaded) {
+    read(current);
+    loaded = true;
+  }
+
+  // Forget the months of any source which is gone or has changed, and
+  // then recompute the months of every source not yet in the table.
+
+  bool dirty = false;
+
+  for (sources_map::iterator i = sources.begin(); i != sources.end(); ) {
+    sources_map::const_iterator c = current.find((*i).first);
+    if (c == current.end() || ! (*i).second.same_as((*c).second)) {
+      DEBUG("ledger.checkpoint", "dropped months of " << (*i).first);
+      sources.erase(i++);
+      dirty = true;
+    } else {
+      i++;
+    }
+  }
+
+  std::size_t index = 0;
+  foreach (journal_t& journal, session.journals) {
+    const std::vector<string>& journal_keys(keys[index]);
+    index++;
+
+    std::vector<source_t *> stale;
+
+    foreach (const string& key, journal_keys) {
+      if (sources.find(key) == sources.end()) {
+	DEBUG("ledger.checkpoint", "computing months of " << key);
+	source_t& source(sources[key]);
+	source = current[key];
+	stale.push_back(&source);
+	dirty = true;
+      } else {
+	stale.push_back(NULL);
+      }
+    }
+
+    // Xacts are filed by their own date, which may differ from their
+    // entry's, since that is what sum_accounts compares against.
+    foreach (entry_t * entry, journal.entries) {
+      if (source_t * source = stale[entry->src_idx]) {
+	foreach (xact_t * xact, entry->xacts)
+	  add_to_delta(source->months[month_of(*xact->date())][xact->account],
+		       *xact);
+      }
+    }
+  }
+
+  if (dirty)
+    write();
+
+  return true;
+}
+
+bool balance_checkpoints_t::sum_accounts(xact_handler_ptr	 handler,
+					 const optional<date_t>& begin,
+					 const optional<date_t>& end)
+{
+  if (! update())
+    return false;
+
+  // The months which lie wholly within [begin, end) are taken from the
+  // table; every other month is left to the xact handler chain.
+
+  optional<date_t> first;
+  if (begin) {
+    first = month_of(*begin);
+    if (*first != *begin)
+      *first += boost::gregorian::months(1);
+  }
+
+  optional<date_t> last;
+  if (end)
+    last = month_of(*end);
+
+  if (! first || ! last || *first < *last) {
+    foreach (sources_map::value_type& pair, sources) {
+      months_map& months(pair.second.months);
+
+      months_map::iterator i = first ? months.lower_bound(*first) : months.begin();
+      months_map::iterator e = last  ? months.lower_bound(*last)  : months.end();
+
+      for (; i != e; i++) {
+	foreach (deltas_map::value_type& delta, (*i).second) {
+	  account_t::xdata_t& xdata(delta.first->xdata());
+	  add_or_set_value(xdata.value, delta.second.value);
+	  xdata.count	 += delta.second.count;
+	  xdata.virtuals += delta.second.virtuals;
+	}
+      }
+    }
+  }
+
+  if ((begin && *begin != *first) || (end && *end != *last)) {
+    session_xacts_iterator walker(session);
+    for (xact_t * xact = walker(); xact; xact = walker()) {
+      date_t month = month_of(*xact->date());
+      if ((first && month < *first) || (last && month >= *last) ||
+	  (first && last && *first >= *last))
+	(*handler)(*xact);
+    }
+  }
+
+  handler->flush();
+
+  return true;
+}
+
+bool balance_checkpoints_t::read(const sources_map& current)
+{
+  if (! exists(pathname))
+    return false;
+
+  ifstream in(pathname);
+
+  if (read_number_nocheck<unsigned long>(in) != checkpoint_magic_number ||
+      read_number_nocheck<unsigned long>(in) != format_version ||
+      read_bool(in) != item_t::use_effective_date)
+    return false;
+
+  for (std::size_t i = 0, count = read_long<std::size_t>(in);
+       i < count && in.good();
+       i++) {
+    string key = read_string(in);
+
+    source_t info;
+    read_number(in, info.mtime);
+    read_long(in, info.size);
+    read_long(in, info.entries);
+    read_string(in, info.automated);
+
+    unsigned long length = read_number<unsigned long>(in);
+    istream_pos_type next = in.tellg();
+    next += length;
+
+    // Only read the months of a source which is still current, and whose
+    // accounts and commodities can all be found again.
+
+    sources_map::const_iterator c = current.find(key);
+    if (c == current.end() || ! info.same_as((*c).second)) {
+      in.seekg(next);
+      continue;
+    }
+
+    bool valid = true;
+
+    for (std::size_t j = 0, months = read_long<std::size_t>(in);
+	 valid && j < months;
+	 j++) {
+      unsigned short year  = read_long<unsigned short>(in);
+      unsigned short month = read_long<unsigned short>(in);
+      deltas_map& deltas(info.months[date_t(year, month, 1)]);
+
+      for (std::size_t k = 0, accounts = read_long<std::size_t>(in);
+	   valid && k < accounts;
+	   k++) {
+	account_t * account =
+	  session.master->find_account(read_string(in), false);
+	if (! account) {
+	  valid = false;
+	  break;
+	}
+
+	delta_t& delta(deltas[account]);
+	valid = read_value(in, delta.value);
+	read_long(in, delta.count);
+	read_long(in, delta.virtuals);
+      }
+    }
+
+    if (valid && in.good())
+      sources.insert(sources_map::value_type(key, info));
+    else
+      DEBUG("ledger.checkpoint", "rejected months of " << key);
+
+    in.seekg(next);
+  }
+
+  return true;
+}
+
+void balance_checkpoints_t::write()
+{
+  TRACE_START(checkpoints, 1, "Wrote balance checkpoints");
+
+  ofstream out(pathname);
+
+  write_number_nocheck(out, checkpoint_magic_number);
+  write_number_nocheck(out, format_version);
+  write_bool(out, item_t::use_effective_date);
+
+  write_long(out, sources.size());
+
+  foreach (sources_map::value_type& pair, sources) {
+    source_t& source(pair.second);
+
+    write_string(out, pair.first);
+    write_number(out, source.mtime);
+    write_long(out, source.size);
+    write_long(out, source.entries);
+    write_string(out, source.automated);
+
+    // The length of the months gets patched below, so that a reader can
+    // skip over sources which have since changed.
+    ostream_pos_type length_pos = out.tellp();
+    write_number<unsigned long>(out, 0);
+    ostream_pos_type begin_pos = out.tellp();
+
+    write_long(out, source.months.size());
+    foreach (months_map::value_type& month, source.months) {
+      write_long<unsigned short>(out, month.first.year());
+      write_long<unsigned short>(out, month.first.month());
+
+      write_long(out, month.second.size());
+      foreach (deltas_map::value_type& delta, month.second) {
+	write_string(out, delta.first->fullname());
+	write_value(out, delta.second.value);
+	write_long(out, delta.second.count);
+	write_long(out, delta.second.virtuals);
+      }
+    }
+
+    ostream_pos_type end_pos = out.tellp();
+    out.seekp(length_pos);
+    write_number<unsigned long>(out, static_cast<unsigned long>
+				(static_cast<std::size_t>(end_pos) -
+				 static_cast<std::size_t>(begin_pos)));
+    out.seekp(end_pos);
+  }
+
+  TRACE_FINISH(checkpoints, 1);
+}
+
+} // namespace ledger
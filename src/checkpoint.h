@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2003-2008, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+#include "session.h"
+#include "handler.h"
+
+namespace ledger {
+
+// balance_checkpoints_t remembers, for every source file of the session's
+// journals, how much each account changed during each calendar month.
+// The table is kept in the file given by --checkpoints, and a source's
+// months are only recomputed when the source's size, modification time
+// or entry count has changed.
+//
+// Automated entries change which xacts a file produces, so each source
+// also records the state of the files its journal's "=" entries come
+// from, and is recomputed when any of those changes as well.
+//
+// A balance report whose predicate consists of nothing but --begin and
+// --end bounds can then add up whole months from the table, and only
+// needs to fold those xacts which fall into the partial months at either
+// edge of the reporting range.
+
+class balance_checkpoints_t : public noncopyable
+{
+  static const unsigned long checkpoint_magic_number = 0xFFEED766;
+#if defined(DEBUG_ON)
+  static const unsigned long format_version	     = 0x00000103;
+#else
+  static const unsigned long format_version	     = 0x00000102;
+#endif
+
+public:
+  struct delta_t
+  {
+    value_t	 value;
+    unsigned int count;
+    unsigned int virtuals;
+
+    delta_t() : count(0), virtuals(0) {
+      TRACE_CTOR(balance_checkpoints_t::delta_t, "");
+    }
+    delta_t(const delta_t& other)
+      : value(other.value), count(other.count), virtuals(other.virtuals) {
+      TRACE_CTOR(balance_checkpoints_t::delta_t, "copy");
+    }
+    ~delta_t() throw() {
+      TRACE_DTOR(balance_checkpoints_t::delta_t);
+    }
+  };
+
+  typedef std::map<account_t *, delta_t> deltas_map;
+  typedef std::map<date_t, deltas_map>	  months_map;
+
+  struct source_t
+  {
+    std::time_t	  mtime;
+    unsigned long size;
+    std::size_t	  entries;
+    string	  automated;	// state of the auto-entry sources
+    months_map	  months;
+
+    source_t() : mtime(0), size(0), entries(0) {
+      TRACE_CTOR(balance_checkpoints_t::source_t, "");
+    }
+    source_t(const source_t& other)
+      : mtime(other.mtime), size(other.size), entries(other.entries),
+	automated(other.automated), months(other.months) {
+      TRACE_CTOR(balance_checkpoints_t::source_t, "copy");
+    }
+    ~source_t() throw() {
+      TRACE_DTOR(balance_checkpoints_t::source_t);
+    }
+
+    bool same_as(const source_t& other) const {
+      return (mtime == other.mtime && size == other.size &&
+	      entries == other.entries && automated == other.automated);
+    }
+  };
+
+  typedef std::map<string, source_t> sources_map;
+
+  session_t&  session;
+  path	      pathname;
+  sources_map sources;
+  bool	      loaded;
+
+  balance_checkpoints_t(session_t& _session, const path& _pathname)
+    : session(_session), pathname(_pathname), loaded(false) {
+    TRACE_CTOR(balance_checkpoints_t, "session_t&, const path&");
+  }
+  ~balance_checkpoints_t() throw() {
+    TRACE_DTOR(balance_checkpoints_t);
+  }
+
+  // Bring the table up to date with the session's journals, rewriting
+  // the checkpoint file if any source had to be recomputed.  Returns
+  // false if some entry cannot be attributed to a source file, in which
+  // case the table must not be used.
+  bool update();
+
+  // Add the whole months within [begin, end) into each account's xdata,
+  // and pass every xact from the remaining months to `handler', which is
+  // expected to filter them by the same date range.
+  bool sum_accounts(xact_handler_ptr		handler,
+		    const optional<date_t>&	begin,
+		    const optional<date_t>&	end);
+
+private:
+  bool read(const std::map<string, source_t>& current);
+  void write();
+};
+
+} // namespace ledger
+
+#endif // _CHECKPOINT_H
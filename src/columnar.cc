@@ -0,0 +1,705 @@
+/*
+ * Copyright (c) 2003-2008, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "columnar.h"
+#include "account.h"
+#include "entry.h"
+
+namespace ledger {
+
+const char format_columnar_xacts::magic[8] = {
+  'L', 'D', 'G', 'R', 'C', 'O', 'L', '\0'
+};
+
+namespace {
+  using namespace columnar;
+
+  const boost::uint32_t no_cost = 0xffffffff;
+
+  const date_t		epoch(1970, 1, 1);
+
+  inline boost::int32_t day_number(const optional<date_t>& when)
+  {
+    if (! when || ! is_valid(*when))
+      return no_date;
+    return boost::int32_t((*when - epoch).days());
+  }
+
+  void fixed_point(const amount_t& amt, boost::int64_t& mantissa,
+		   boost::uint8_t& scale)
+  {
+    amount_t::precision_t places;
+    if (! amt.fixed_quantity(mantissa, places) || places > 0xff)
+      throw_(amount_error,
+	     "Amount is too large for a columnar export: " << amt);
+    scale = boost::uint8_t(places);
+  }
+
+  inline void put_signed(string& buf, boost::int64_t value)
+  {
+    put_varint(buf, zigzag(value));
+  }
+
+  template <typename T>
+  void put_varints(string& buf, const std::vector<T>& column)
+  {
+    foreach (T value, column)
+      put_varint(buf, value);
+  }
+
+  template <typename T>
+  void put_bytes(string& buf, const std::vector<T>& column)
+  {
+    foreach (T value, column)
+      buf += char(value);
+  }
+
+  // lz4_compress writes src in the LZ4 block format, so that any LZ4
+  // implementation can read the blocks back.  It is the format's plain
+  // greedy matcher: four-byte sequences are hashed into a table of
+  // their last positions, and a match is taken wherever one repeats
+  // within 64K.  The format requires the last five bytes to be
+  // literals, and no match to start within twelve bytes of the end.
+  class lz4_compressor_t
+  {
+    enum { hash_bits = 12, min_match = 4, end_literals = 5,
+	   match_margin = 12, max_offset = 65535 };
+
+    std::vector<std::size_t> positions; // one more than the position
+
+    static boost::uint32_t read32(const unsigned char * p) {
+      return (boost::uint32_t(p[0])	  | boost::uint32_t(p[1]) << 8 |
+	      boost::uint32_t(p[2]) << 16 | boost::uint32_t(p[3]) << 24);
+    }
+    static std::size_t hash(boost::uint32_t sequence) {
+      return (sequence * 2654435761U) >> (32 - hash_bits);
+    }
+
+    static void put_length(string& dst, std::size_t len) {
+      for (; len >= 255; len -= 255)
+	dst += char(255);
+      dst += char(len);
+    }
+
+    static void put_sequence(string& dst, const unsigned char * literals,
+			     std::size_t literals_len, std::size_t offset,
+			     std::size_t match_len) {
+      std::size_t extra = match_len ? match_len - min_match : 0;
+
+      dst += char((std::min<std::size_t>(literals_len, 15) << 4) |
+		  std::min<std::size_t>(extra, 15));
+      if (literals_len >= 15)
+	put_length(dst, literals_len - 15);
+      dst.append(reinterpret_cast<const char *>(literals), literals_len);
+
+      if (match_len) {
+	dst += char(offset & 0xff);
+	dst += char(offset >> 8);
+	if (extra >= 15)
+	  put_length(dst, extra - 15);
+      }
+    }
+
+  public:
+    lz4_compressor_t() : positions(std::size_t(1) << hash_bits) {}
+
+    void operator()(const string& src, string& dst) {
+      const unsigned char * base =
+	reinterpret_cast<const unsigned char *>(src.data());
+      const std::size_t	    len	 = src.length();
+
+      std::fill(positions.begin(), positions.end(), 0);
+      dst.clear();
+
+      std::size_t anchor = 0;
+      for (std::size_t i = 0; i + match_margin <= len; ) {
+	const boost::uint32_t sequence = read32(base + i);
+	std::size_t&	      last     = positions[hash(sequence)];
+	const std::size_t     ref      = last;
+	last = i + 1;
+
+	if (ref == 0 || i + 1 - ref > max_offset ||
+	    read32(base + ref - 1) != sequence) {
+	  i++;
+	  continue;
+	}
+
+	std::size_t match_len = min_match;
+	while (i + match_len < len - end_literals &&
+	       base[ref - 1 + match_len] == base[i + match_len])
+	  match_len++;
+
+	put_sequence(dst, base + anchor, i - anchor, i + 1 - ref, match_len);
+	i     += match_len;
+	anchor = i;
+      }
+      put_sequence(dst, base + anchor, len - anchor, 0, 0);
+    }
+  };
+
+  template <typename T>
+  T get_scalar(const char *& p, const char * end)
+  {
+    if (std::size_t(end - p) < sizeof(T))
+      throw_(columnar_error, "Columnar data ends unexpectedly");
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+  }
+
+  inline std::size_t get_lz4_length(const unsigned char *& p,
+				     const unsigned char * end)
+  {
+    std::size_t len = 0;
+    unsigned char byte;
+    do {
+      if (p == end)
+	throw_(columnar_error, "LZ4 block ends inside a length");
+      byte = *p++;
+      len += byte;
+    } while (byte == 255);
+    return len;
+  }
+}
+
+namespace columnar {
+
+void put_varint(string& buf, boost::uint64_t value)
+{
+  while (value >= 0x80) {
+    buf += char((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  buf += char(value);
+}
+
+boost::uint64_t get_varint(const char *& data, const char * end)
+{
+  boost::uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (data == end)
+      throw_(columnar_error, "Columnar data ends inside a number");
+    const unsigned char byte = static_cast<unsigned char>(*data++);
+    value |= boost::uint64_t(byte & 0x7f) << shift;
+    if (! (byte & 0x80))
+      return value;
+  }
+  throw_(columnar_error, "Columnar number is longer than 64 bits");
+  return 0;
+}
+
+void lz4_compress(const string& src, string& dst)
+{
+  lz4_compressor_t compress;
+  compress(src, dst);
+}
+
+void lz4_decompress(const char * src, std::size_t src_len,
+		    std::size_t length, string& dst)
+{
+  const unsigned char * p   = reinterpret_cast<const unsigned char *>(src);
+  const unsigned char * end = p + src_len;
+
+  dst.clear();
+  dst.reserve(length);
+
+  while (true) {
+    if (p == end)
+      throw_(columnar_error, "LZ4 block is missing its last sequence");
+
+    const unsigned char token = *p++;
+
+    std::size_t literals = token >> 4;
+    if (literals == 15)
+      literals += get_lz4_length(p, end);
+    if (std::size_t(end - p) < literals || length - dst.length() < literals)
+      throw_(columnar_error, "LZ4 literals overrun the block");
+    dst.append(reinterpret_cast<const char *>(p), literals);
+    p += literals;
+
+    // Only the last sequence lacks a match, and it must then carry the
+    // last five bytes at least.
+    if (p == end) {
+      if (dst.length() != length)
+	throw_(columnar_error, "LZ4 block decompresses to " << dst.length()
+	       << " bytes rather than " << length);
+      if (length >= 5 && literals < 5)
+	throw_(columnar_error, "LZ4 block ends with fewer than five literals");
+      return;
+    }
+
+    if (end - p < 2)
+      throw_(columnar_error, "LZ4 block ends inside an offset");
+    const std::size_t offset = std::size_t(p[0]) | std::size_t(p[1]) << 8;
+    p += 2;
+    if (offset == 0 || offset > dst.length())
+      throw_(columnar_error, "LZ4 match refers outside the block");
+
+    std::size_t match = token & 15;
+    if (match == 15)
+      match += get_lz4_length(p, end);
+    match += 4;
+
+    // A match may not start within twelve bytes of the end, nor reach
+    // into the last five.
+    if (length < 12 || dst.length() > length - 12 ||
+	match > length - 5 - dst.length())
+      throw_(columnar_error, "LZ4 match is too near the end of the block");
+
+    // The source may overlap what is being copied, so go byte by byte.
+    std::size_t from = dst.length() - offset;
+    for (std::size_t i = 0; i < match; i++)
+      dst += dst[from + i];
+  }
+}
+
+} // namespace columnar
+
+format_columnar_xacts::format_columnar_xacts(std::ostream& _out,
+					     std::size_t   _rows_per_block)
+  : out(_out), offset(0), rows_per_block(_rows_per_block),
+    last_entry(NULL), last_payee(0), finished(false)
+{
+  TRACE_CTOR(format_columnar_xacts, "std::ostream&, std::size_t");
+
+  assert(rows_per_block > 0);
+
+  dates.reserve(rows_per_block);
+  effective_dates.reserve(rows_per_block);
+  payees.reserve(rows_per_block);
+  accounts.reserve(rows_per_block);
+  commodities.reserve(rows_per_block);
+  quantities.reserve(rows_per_block);
+  quantity_scales.reserve(rows_per_block);
+  cost_commodities.reserve(rows_per_block);
+  costs.reserve(rows_per_block);
+  cost_scales.reserve(rows_per_block);
+  states.reserve(rows_per_block);
+  notes.reserve(rows_per_block);
+
+  intern(note_ids, note_texts, "");
+
+  write_bytes(magic, sizeof(magic));
+  write_scalar(version);
+  write_scalar(byte_order);
+}
+
+format_columnar_xacts::ident_t
+format_columnar_xacts::intern(string_map& ids, std::vector<string>& names,
+			      const string& name)
+{
+  std::pair<string_map::iterator, bool> result =
+    ids.insert(string_map::value_type(name, ident_t(names.size())));
+  if (result.second)
+    names.push_back(name);
+  return result.first->second;
+}
+
+format_columnar_xacts::ident_t
+format_columnar_xacts::account_id(const account_t * account)
+{
+  account_map::iterator i = account_ids.find(account);
+  if (i != account_ids.end())
+    return i->second;
+
+  ident_t id = ident_t(account_names.size());
+  account_names.push_back(account->fullname());
+  account_ids.insert(account_map::value_type(account, id));
+  return id;
+}
+
+format_columnar_xacts::ident_t
+format_columnar_xacts::commodity_id(const commodity_t& comm)
+{
+  // Annotated commodities are distinct objects sharing a symbol, so
+  // look up by address first and fall back to the name.
+  commodity_map::iterator i = commodity_ids.find(&comm);
+  if (i != commodity_ids.end())
+    return i->second;
+
+  ident_t id = intern(commodity_name_ids, commodity_names, comm.symbol());
+  commodity_ids.insert(commodity_map::value_type(&comm, id));
+  return id;
+}
+
+void format_columnar_xacts::operator()(xact_t& xact)
+{
+  assert(! finished);
+
+  dates.push_back(day_number(xact.actual_date()));
+  effective_dates.push_back(day_number(xact.effective_date()));
+
+  // Transactions of one entry arrive together, so remember the last
+  // payee rather than looking it up again for each of them.
+  if (xact.entry != last_entry) {
+    last_entry = xact.entry;
+    last_payee = intern(payee_ids, payee_names,
+			xact.entry ? xact.entry->payee : string());
+  }
+  payees.push_back(last_payee);
+
+  accounts.push_back(account_id(xact.account));
+
+  boost::int64_t mantissa = 0;
+  boost::uint8_t scale	  = 0;
+  if (! xact.amount.is_null())
+    fixed_point(xact.amount, mantissa, scale);
+  commodities.push_back(commodity_id(xact.amount.commodity()));
+  quantities.push_back(mantissa);
+  quantity_scales.push_back(scale);
+
+  if (xact.cost && ! xact.cost->is_null()) {
+    fixed_point(*xact.cost, mantissa, scale);
+    cost_commodities.push_back(commodity_id(xact.cost->commodity()));
+    costs.push_back(mantissa);
+    cost_scales.push_back(scale);
+  } else {
+    cost_commodities.push_back(no_cost);
+    costs.push_back(0);
+    cost_scales.push_back(0);
+  }
+
+  states.push_back(boost::uint8_t(xact.state()));
+  notes.push_back(xact.note ? intern(note_ids, note_texts, *xact.note) : 0);
+
+  if (dates.size() == rows_per_block)
+    write_row_group();
+}
+
+void format_columnar_xacts::write_row_group()
+{
+  if (dates.empty())
+    return;
+
+  columnar::block_t block;
+  block.offset	   = offset;
+  block.rows	   = boost::uint32_t(dates.size());
+  block.first_date = no_date;
+  block.last_date  = no_date;
+
+  columns.clear();
+
+  boost::int64_t last = 0;
+  foreach (boost::int32_t date, dates) {
+    put_signed(columns, date - last);
+    last = date;
+
+    if (date != no_date) {
+      if (block.first_date == no_date || date < block.first_date)
+	block.first_date = date;
+      if (block.last_date == no_date || date > block.last_date)
+	block.last_date = date;
+    }
+  }
+  for (std::size_t i = 0; i < effective_dates.size(); i++) {
+    if (effective_dates[i] == no_date)
+      put_varint(columns, 0);
+    else
+      put_varint(columns, 1 + zigzag(boost::int64_t(effective_dates[i]) -
+				     dates[i]));
+  }
+  put_varints(columns, payees);
+  put_varints(columns, accounts);
+  put_varints(columns, commodities);
+  foreach (boost::int64_t quantity, quantities)
+    put_signed(columns, quantity);
+  put_bytes(columns, quantity_scales);
+  for (std::size_t i = 0; i < cost_commodities.size(); i++)
+    put_varint(columns, (cost_commodities[i] == no_cost ?
+			 0 : boost::uint64_t(cost_commodities[i]) + 1));
+  for (std::size_t i = 0; i < costs.size(); i++)
+    if (cost_commodities[i] != no_cost)
+      put_signed(columns, costs[i]);
+  for (std::size_t i = 0; i < cost_scales.size(); i++)
+    if (cost_commodities[i] != no_cost)
+      columns += char(cost_scales[i]);
+  put_bytes(columns, states);
+  put_varints(columns, notes);
+
+  lz4_compress(columns, packed);
+
+  // Blocks which do not shrink, such as very small ones, are stored as
+  // they are.
+  const bool	 stored = packed.length() >= columns.length();
+  const string& data   = stored ? columns : packed;
+
+  write_scalar(block.rows);
+  write_scalar(block.first_date);
+  write_scalar(block.last_date);
+  write_scalar(boost::uint8_t(stored ? 0 : 1));
+  write_scalar(boost::uint32_t(columns.length()));
+  write_scalar(boost::uint32_t(data.length()));
+  write_bytes(data.data(), data.length());
+
+  blocks.push_back(block);
+
+  dates.clear();
+  effective_dates.clear();
+  payees.clear();
+  accounts.clear();
+  commodities.clear();
+  quantities.clear();
+  quantity_scales.clear();
+  cost_commodities.clear();
+  costs.clear();
+  cost_scales.clear();
+  states.clear();
+  notes.clear();
+}
+
+void format_columnar_xacts::write_strings(const std::vector<string>& strings)
+{
+  string buf;
+  put_varint(buf, strings.size());
+  write_bytes(buf.data(), buf.length());
+
+  foreach (const string& str, strings) {
+    buf.clear();
+    put_varint(buf, str.length());
+    write_bytes(buf.data(), buf.length());
+    write_bytes(str.data(), str.length());
+  }
+}
+
+void format_columnar_xacts::write_index()
+{
+  write_scalar(boost::uint32_t(blocks.size()));
+  foreach (const columnar::block_t& block, blocks) {
+    write_scalar(block.offset);
+    write_scalar(block.rows);
+    write_scalar(block.first_date);
+    write_scalar(block.last_date);
+  }
+}
+
+void format_columnar_xacts::finish()
+{
+  write_row_group();
+  write_scalar(boost::uint32_t(0));
+
+  boost::uint64_t dictionaries = offset;
+  write_strings(payee_names);
+  write_strings(account_names);
+  write_strings(commodity_names);
+  write_strings(note_texts);
+
+  boost::uint64_t index = offset;
+  write_index();
+
+  write_scalar(dictionaries);
+  write_scalar(index);
+  write_bytes(magic, sizeof(magic));
+
+  finished = true;
+}
+
+void format_columnar_xacts::flush()
+{
+  if (! finished)
+    finish();
+  out.flush();
+}
+
+columnar_reader_t::columnar_reader_t(const string& _data) : data(_data)
+{
+  TRACE_CTOR(columnar_reader_t, "const string&");
+
+  const std::size_t magic_len = sizeof(format_columnar_xacts::magic);
+  const std::size_t trailer   = 2 * sizeof(boost::uint64_t) + magic_len;
+
+  if (data.length() < magic_len + 2 * sizeof(boost::uint32_t) + trailer ||
+      std::memcmp(data.data(), format_columnar_xacts::magic, magic_len) != 0 ||
+      std::memcmp(data.data() + data.length() - magic_len,
+		  format_columnar_xacts::magic, magic_len) != 0)
+    throw_(columnar_error, "This is not a columnar export");
+
+  const char * begin = data.data();
+  const char * end   = begin + data.length();
+
+  const char * p = begin + magic_len;
+  if (get_scalar<boost::uint32_t>(p, end) != format_columnar_xacts::version)
+    throw_(columnar_error, "Columnar export has an unknown version");
+  if (get_scalar<boost::uint32_t>(p, end) != format_columnar_xacts::byte_order)
+    throw_(columnar_error,
+	   "Columnar export was written with another byte order");
+
+  p = end - trailer;
+  const boost::uint64_t dictionaries = get_scalar<boost::uint64_t>(p, end);
+  const boost::uint64_t index	     = get_scalar<boost::uint64_t>(p, end);
+  if (dictionaries > index || index > data.length() - trailer)
+    throw_(columnar_error, "Columnar export has a corrupt trailer");
+
+  p = begin + dictionaries;
+  read_strings(p, payees);
+  read_strings(p, accounts);
+  read_strings(p, commodities);
+  read_strings(p, notes);
+
+  p = begin + index;
+  const boost::uint32_t count = get_scalar<boost::uint32_t>(p, end);
+  for (boost::uint32_t i = 0; i < count; i++) {
+    columnar::block_t block;
+    block.offset     = get_scalar<boost::uint64_t>(p, end);
+    block.rows	     = get_scalar<boost::uint32_t>(p, end);
+    block.first_date = get_scalar<boost::int32_t>(p, end);
+    block.last_date  = get_scalar<boost::int32_t>(p, end);
+    if (block.offset >= dictionaries)
+      throw_(columnar_error, "Columnar block index is corrupt");
+    blocks.push_back(block);
+  }
+}
+
+void columnar_reader_t::read_strings(const char *& p,
+				     std::vector<string>& strings) const
+{
+  const char * end = data.data() + data.length();
+
+  boost::uint64_t count = get_varint(p, end);
+  for (boost::uint64_t i = 0; i < count; i++) {
+    boost::uint64_t len = get_varint(p, end);
+    if (boost::uint64_t(end - p) < len)
+      throw_(columnar_error, "Columnar dictionary ends unexpectedly");
+    strings.push_back(string(p, std::size_t(len)));
+    p += len;
+  }
+}
+
+std::vector<std::size_t>
+columnar_reader_t::blocks_between(boost::int32_t begin,
+				  boost::int32_t end) const
+{
+  std::vector<std::size_t> found;
+  for (std::size_t i = 0; i < blocks.size(); i++)
+    if (blocks[i].first_date != no_date &&
+	blocks[i].first_date <= end && blocks[i].last_date >= begin)
+      found.push_back(i);
+  return found;
+}
+
+namespace {
+  format_columnar_xacts::ident_t
+  get_ident(const char *& p, const char * end, const std::vector<string>& dict)
+  {
+    boost::uint64_t id = get_varint(p, end);
+    if (id >= dict.size())
+      throw_(columnar_error, "Columnar row refers to an unknown string");
+    return format_columnar_xacts::ident_t(id);
+  }
+
+  boost::uint8_t get_byte(const char *& p, const char * end)
+  {
+    return get_scalar<boost::uint8_t>(p, end);
+  }
+}
+
+void columnar_reader_t::read_block(std::size_t index, rows_list& rows) const
+{
+  assert(index < blocks.size());
+  const columnar::block_t& block(blocks[index]);
+
+  const char * p   = data.data() + block.offset;
+  const char * end = data.data() + data.length();
+
+  const boost::uint32_t count  = get_scalar<boost::uint32_t>(p, end);
+  get_scalar<boost::int32_t>(p, end);	// the dates are in the index too
+  get_scalar<boost::int32_t>(p, end);
+  const boost::uint8_t  codec  = get_scalar<boost::uint8_t>(p, end);
+  const boost::uint32_t length = get_scalar<boost::uint32_t>(p, end);
+  const boost::uint32_t stored = get_scalar<boost::uint32_t>(p, end);
+
+  if (count != block.rows || std::size_t(end - p) < stored)
+    throw_(columnar_error, "Columnar block does not match the index");
+
+  string columns;
+  switch (codec) {
+  case 0:
+    if (stored != length)
+      throw_(columnar_error, "Stored columnar block has the wrong length");
+    columns.assign(p, stored);
+    break;
+  case 1:
+    lz4_decompress(p, stored, length, columns);
+    break;
+  default:
+    throw_(columnar_error, "Columnar block uses an unknown codec");
+  }
+
+  p   = columns.data();
+  end = p + columns.length();
+
+  const std::size_t first = rows.size();
+  rows.resize(first + count);
+
+  boost::int64_t last = 0;
+  for (std::size_t i = first; i < rows.size(); i++) {
+    last += unzigzag(get_varint(p, end));
+    rows[i].date = boost::int32_t(last);
+  }
+  for (std::size_t i = first; i < rows.size(); i++) {
+    boost::uint64_t value = get_varint(p, end);
+    if (value == 0)
+      rows[i].effective_date = no_date;
+    else
+      rows[i].effective_date =
+	boost::int32_t(rows[i].date + unzigzag(value - 1));
+  }
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].payee = get_ident(p, end, payees);
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].account = get_ident(p, end, accounts);
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].commodity = get_ident(p, end, commodities);
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].quantity = unzigzag(get_varint(p, end));
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].quantity_scale = get_byte(p, end);
+  for (std::size_t i = first; i < rows.size(); i++) {
+    boost::uint64_t value = get_varint(p, end);
+    if (value > commodities.size())
+      throw_(columnar_error, "Columnar row refers to an unknown string");
+    if (value != 0)
+      rows[i].cost_commodity = ident_t(value - 1);
+  }
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].cost = rows[i].cost_commodity ? unzigzag(get_varint(p, end)) : 0;
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].cost_scale = rows[i].cost_commodity ? get_byte(p, end) : 0;
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].state = get_byte(p, end);
+  for (std::size_t i = first; i < rows.size(); i++)
+    rows[i].note = get_ident(p, end, notes);
+
+  if (p != end)
+    throw_(columnar_error, "Columnar block has bytes left over");
+}
+
+} // namespace ledger
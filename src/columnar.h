@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2003-2008, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _COLUMNAR_H
+#define _COLUMNAR_H
+
+#include "handler.h"
+
+namespace ledger {
+
+DECLARE_EXCEPTION(columnar_error, std::runtime_error);
+
+// The encodings of the columnar format, described below, which are
+// shared by format_columnar_xacts and columnar_reader_t.
+namespace columnar {
+
+const boost::int32_t no_date = -2147483647 - 1;
+
+void		put_varint(string& buf, boost::uint64_t value);
+boost::uint64_t get_varint(const char *& data, const char * end);
+
+inline boost::uint64_t zigzag(boost::int64_t value) {
+  return (boost::uint64_t(value) << 1) ^ boost::uint64_t(value >> 63);
+}
+inline boost::int64_t unzigzag(boost::uint64_t value) {
+  return boost::int64_t(value >> 1) ^ - boost::int64_t(value & 1);
+}
+
+// lz4_compress writes src to dst in the LZ4 block format.
+// lz4_decompress reads such a block back, and throws columnar_error
+// unless it is well formed and comes to exactly length bytes.
+void lz4_compress(const string& src, string& dst);
+void lz4_decompress(const char * src, std::size_t src_len,
+		    std::size_t length, string& dst);
+
+struct block_t
+{
+  boost::uint64_t offset;
+  boost::uint32_t rows;
+  boost::int32_t  first_date;
+  boost::int32_t  last_date;
+};
+
+} // namespace columnar
+
+/**
+ * format_columnar_xacts writes transactions to a self-contained binary
+ * table, storing each column as a contiguous array.  It is meant for
+ * loading a whole journal into analysis tools, and is both far smaller
+ * and far quicker to produce than CSV.
+ *
+ * The file starts with the eight byte magic "LDGRCOL\0", a 32-bit
+ * version number and the 32-bit value 0x01020304, from which readers
+ * can tell the byte order of every fixed-width number that follows.
+ * Variable-length numbers ("varint") are written seven bits at a time,
+ * least significant first, with the high bit set on all but the last
+ * byte; signed ones are zigzag encoded first, mapping 0, -1, 1, -2, ...
+ * to 0, 1, 2, 3, ...
+ *
+ * Rows are written in blocks of up to row_group_size, each of which can
+ * be read on its own.  A block starts with this header:
+ *
+ *   rows            uint32  zero here ends the blocks
+ *   first_date      int32   earliest date in the block, in days since
+ *   last_date       int32     1970-01-01; INT32_MIN if there is none
+ *   codec           uint8   0 stored as is, 1 LZ4 block format
+ *   length          uint32  length of the columns once decompressed
+ *   stored_length   uint32  length of the bytes that follow
+ *
+ * Decompressed, the block holds one run of values per column, in this
+ * order, each run covering every row of the block unless noted:
+ *
+ *   date            varint  signed, change from the previous row's date
+ *                           (from zero for the first row)
+ *   effective_date  varint  0 if there is none, otherwise one more than
+ *                           the zigzagged difference from the date
+ *   payee           varint  index into the payee dictionary
+ *   account         varint  index into the account dictionary
+ *   commodity       varint  index into the commodity dictionary
+ *   quantity        varint  signed fixed-point mantissa
+ *   quantity_scale  uint8   the mantissa is divided by 10^scale
+ *   cost_commodity  varint  0 if there is no cost, or commodity index + 1
+ *   cost            varint  signed mantissa, only for rows with a cost
+ *   cost_scale      uint8   likewise
+ *   state           uint8   0 uncleared, 1 cleared, 2 pending
+ *   note            varint  index into the note dictionary
+ *
+ * Four dictionaries follow the blocks, for payees, accounts, commodities
+ * and notes, each being a varint count and then that many strings, each
+ * a varint length and its bytes.  Note zero is always the empty string,
+ * used for rows without a note.
+ *
+ * Then comes the block index: a uint32 count, and for each block the
+ * uint64 offset of its header, its uint32 row count and its int32 first
+ * and last dates.  The file ends with the uint64 offsets of the
+ * dictionaries and of the block index, and the magic once more.  So a
+ * reader interested in a range of dates loads the index and the
+ * dictionaries from the end, and then only the blocks overlapping it.
+ */
+class format_columnar_xacts : public item_handler<xact_t>
+{
+  format_columnar_xacts();
+
+public:
+  static const std::size_t	row_group_size = 64 * 1024;
+  static const boost::uint32_t	version	       = 2;
+
+  static const char		magic[8];
+  static const boost::uint32_t	byte_order     = 0x01020304;
+
+  typedef boost::uint32_t			 ident_t;
+  typedef std::map<string, ident_t>		 string_map;
+  typedef std::map<const account_t *, ident_t>	 account_map;
+  typedef std::map<const commodity_t *, ident_t> commodity_map;
+
+protected:
+  std::ostream&		 out;
+  boost::uint64_t	 offset;
+  const std::size_t	 rows_per_block;
+
+  std::vector<boost::int32_t>  dates;
+  std::vector<boost::int32_t>  effective_dates;
+  std::vector<ident_t>	       payees;
+  std::vector<ident_t>	       accounts;
+  std::vector<ident_t>	       commodities;
+  std::vector<boost::int64_t>  quantities;
+  std::vector<boost::uint8_t>  quantity_scales;
+  std::vector<ident_t>	       cost_commodities;
+  std::vector<boost::int64_t>  costs;
+  std::vector<boost::uint8_t>  cost_scales;
+  std::vector<boost::uint8_t>  states;
+  std::vector<ident_t>	       notes;
+
+  std::vector<columnar::block_t> blocks;
+  string		 columns;   // the current block, before and
+  string		 packed;    // after compression
+
+  std::vector<string>	 payee_names;
+  std::vector<string>	 account_names;
+  std::vector<string>	 commodity_names;
+  std::vector<string>	 note_texts;
+
+  string_map		 payee_ids;
+  account_map		 account_ids;
+  string_map		 commodity_name_ids;
+  commodity_map		 commodity_ids;
+  string_map		 note_ids;
+
+  const entry_t *	 last_entry;
+  ident_t		 last_payee;
+  bool			 finished;
+
+  ident_t intern(string_map& ids, std::vector<string>& names,
+		 const string& name);
+  ident_t account_id(const account_t * account);
+  ident_t commodity_id(const commodity_t& comm);
+
+  void write_bytes(const void * data, std::size_t len) {
+    out.write(static_cast<const char *>(data), len);
+    offset += len;
+  }
+  template <typename T>
+  void write_scalar(T value) {
+    write_bytes(&value, sizeof(value));
+  }
+  void write_strings(const std::vector<string>& strings);
+  void write_index();
+
+  void write_row_group();
+  void finish();
+
+public:
+  format_columnar_xacts(std::ostream& _out,
+			std::size_t   _rows_per_block = row_group_size);
+  ~format_columnar_xacts() {
+    TRACE_DTOR(format_columnar_xacts);
+  }
+
+  virtual void flush();
+  virtual void operator()(xact_t& xact);
+};
+
+/**
+ * columnar_reader_t reads back what format_columnar_xacts wrote, given
+ * the whole of it in memory; the string must outlive the reader.  The
+ * dictionaries and the block index are read at once, but a block is
+ * only decoded when asked for, so that reading a range of dates costs
+ * only the blocks which overlap it.
+ *
+ * Fixed-width numbers are read in the byte order of this machine, and a
+ * file written with another is refused.
+ */
+class columnar_reader_t : public noncopyable
+{
+public:
+  typedef format_columnar_xacts::ident_t ident_t;
+
+  struct row_t
+  {
+    boost::int32_t    date;		// columnar::no_date if none
+    boost::int32_t    effective_date;	// likewise
+    ident_t	      payee;
+    ident_t	      account;
+    ident_t	      commodity;
+    boost::int64_t    quantity;
+    boost::uint8_t    quantity_scale;
+    optional<ident_t> cost_commodity;
+    boost::int64_t    cost;		// zero if there is no cost
+    boost::uint8_t    cost_scale;
+    boost::uint8_t    state;
+    ident_t	      note;
+  };
+
+  typedef std::vector<row_t> rows_list;
+
+  std::vector<columnar::block_t> blocks;
+
+  std::vector<string> payees;
+  std::vector<string> accounts;
+  std::vector<string> commodities;
+  std::vector<string> notes;
+
+private:
+  const string& data;
+
+  void read_strings(const char *& p, std::vector<string>& strings) const;
+
+public:
+  explicit columnar_reader_t(const string& _data);
+  ~columnar_reader_t() throw() {
+    TRACE_DTOR(columnar_reader_t);
+  }
+
+  // The indices of the blocks with rows dated from begin to end, both
+  // given in days since 1970-01-01 and inclusive.
+  std::vector<std::size_t> blocks_between(boost::int32_t begin,
+					  boost::int32_t end) const;
+
+  // Appends the rows of the given block to rows.
+  void read_block(std::size_t index, rows_list& rows) const;
+};
+
+} // namespace ledger
+
+#endif // _COLUMNAR_H
@@ -516,6 +516,45 @@ void annotation_t::parse(std::istream& in)
 	"Parsed commodity annotations: " << std::endl << *this);
 }
 
+std::size_t hash_value(const annotation_t& details)
+{
+  std::size_t seed = 0;
+  if (details.price)
+    hash_combine(seed, *details.price);
+  if (details.date)
+    hash_combine(seed, details.date->julian_day());
+  if (details.tag)
+    hash_combine(seed, static_cast<const std::string&>(*details.tag));
+  return seed;
+}
+
+namespace {
+  const commodity_t::base_t * price_base(const amount_t& price)
+  {
+    return price.has_commodity() ? price.commodity().base.get() : NULL;
+  }
+
+  bool same_price(const optional<amount_t>& left,
+		  const optional<amount_t>& right)
+  {
+    if (! left || ! right)
+      return ! left && ! right;
+    if (left->is_null() || right->is_null())
+      return left->is_null() && right->is_null();
+    if (price_base(*left) != price_base(*right))
+      return false;
+    return left->number().compare(right->number()) == 0;
+  }
+}
+
+bool annotated_key_t::operator==(const annotated_key_t& rhs) const
+{
+  return (base == rhs.base &&
+	  same_price(details->price, rhs.details->price) &&
+	  details->date == rhs.details->date &&
+	  details->tag  == rhs.details->tag);
+}
+
 bool annotated_commodity_t::operator==(const commodity_t& comm) const
 {
   // If the base commodities don't match, the game's up.
@@ -644,7 +683,8 @@ bool compare_amount_commodities::operator()(const amount_t * left,
   }
 }
 
-commodity_pool_t::commodity_pool_t() : default_commodity(NULL)
+commodity_pool_t::commodity_pool_t()
+  : default_commodity(NULL), frozen(false)
 {
   TRACE_CTOR(commodity_pool_t, "");
   null_commodity = create("");
@@ -654,6 +694,10 @@ commodity_pool_t::commodity_pool_t() : default_commodity(NULL)
 
 commodity_t * commodity_pool_t::create(const string& symbol)
 {
+  if (frozen)
+    throw_(commodity_error,
+	   "Cannot create commodity '" << symbol << "' in a frozen session");
+
   shared_ptr<commodity_t::base_t>
     base_commodity(new commodity_t::base_t(symbol));
   std::auto_ptr<commodity_t> commodity(new commodity_t(this, base_commodity));
@@ -726,13 +770,18 @@ commodity_pool_t::create(const string& symbol, const annotation_t& details)
 }
 
 namespace {
-  string make_qualified_name(const commodity_t&  comm,
-			     const annotation_t& details)
+  void check_annotation(const annotation_t& details)
   {
     assert(details);
 
     if (details.price && details.price->sign() < 0)
       throw_(amount_error, "A commodity's price may not be negative");
+  }
+
+  string make_qualified_name(const commodity_t&  comm,
+			     const annotation_t& details)
+  {
+    check_annotation(details);
 
     std::ostringstream name;
     comm.print(name);
@@ -753,17 +802,24 @@ commodity_pool_t::find(const string& symbol, const annotation_t& details)
   if (! comm)
     return NULL;
 
-  if (details) {
-    string name = make_qualified_name(*comm, details);
-
-    if (commodity_t * ann_comm = find(name)) {
-      assert(ann_comm->annotated && as_annotated_commodity(*ann_comm).details);
-      return ann_comm;
-    }
-    return NULL;
-  } else {
+  if (details)
+    return find(*comm, details);
+  else
     return comm;
+}
+
+commodity_t *
+commodity_pool_t::find(const commodity_t& comm, const annotation_t& details)
+{
+  check_annotation(details);
+
+  annotated_commodities_t::const_iterator i =
+    annotated_commodities.find(annotated_key_t(comm.base.get(), details));
+  if (i != annotated_commodities.end()) {
+    assert((*i)->annotated && (*i)->details);
+    return *i;
   }
+  return NULL;
 }
 
 commodity_t *
@@ -789,6 +845,11 @@ commodity_pool_t::create(commodity_t&	     comm,
   assert(details);
   assert(! mapping_key.empty());
 
+  if (frozen)
+    throw_(commodity_error,
+	   "Cannot create commodity '" << mapping_key
+	   << "' in a frozen session");
+
   std::auto_ptr<commodity_t> commodity
     (new annotated_commodity_t(&comm, details));
 
@@ -805,6 +866,8 @@ commodity_pool_t::create(commodity_t&	     comm,
   commodity->mapping_key_ = mapping_key;
 
   commodities.push_back(commodity.get());
+  annotated_commodities.insert
+    (static_cast<annotated_commodity_t *>(commodity.get()));
   return commodity.release();
 }
 
@@ -814,9 +877,14 @@ commodity_t * commodity_pool_t::find_or_create(commodity_t&	   comm,
   assert(comm);
   assert(details);
 
+  if (commodity_t * ann_comm = find(comm, details))
+    return ann_comm;
+
   string name = make_qualified_name(comm, details);
   assert(! name.empty());
 
+  // Annotations which differ only beyond the display precision of
+  // their price print alike, and so must share one commodity.
   if (commodity_t * ann_comm = find(name)) {
     assert(ann_comm->annotated && as_annotated_commodity(*ann_comm).details);
     return ann_comm;
@@ -824,4 +892,51 @@ commodity_t * commodity_pool_t::find_or_create(commodity_t&	   comm,
   return create(comm, details, name);
 }
 
+namespace {
+  void mark_shared(commodity_t::history_t& history)
+  {
+    foreach (commodity_t::history_map::value_type& pair, history.prices)
+      pair.second.mark_shared();
+  }
+}
+
+void commodity_pool_t::freeze()
+{
+  if (frozen)
+    return;
+
+  // Creating stripped commodities adds to the pool, so walk a copy.
+  std::vector<commodity_t *> existing(commodities.begin(), commodities.end());
+
+  foreach (commodity_t * comm, existing) {
+    if (comm->annotated) {
+      annotated_commodity_t& ann_comm(as_annotated_commodity(*comm));
+      for (int i = 0; i < 8; i++)
+	ann_comm.strip_annotations(i & 1, i & 2, i & 4);
+    }
+  }
+
+  foreach (commodity_t * comm, commodities) {
+    if (comm->annotated) {
+      annotated_commodity_t& ann_comm(as_annotated_commodity(*comm));
+      if (ann_comm.details.price)
+	ann_comm.details.price->mark_shared();
+      continue;			// the base holds everything else
+    }
+
+    commodity_t::base_t& base(*comm->base);
+    if (base.varied_history) {
+      foreach (commodity_t::history_by_commodity_map::value_type& pair,
+	       base.varied_history->histories)
+	mark_shared(pair.second);
+    }
+    if (base.smaller)
+      base.smaller->mark_shared();
+    if (base.larger)
+      base.larger->mark_shared();
+  }
+
+  frozen = true;
+}
+
 } // namespace ledger
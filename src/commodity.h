@@ -366,6 +366,37 @@ inline std::ostream& operator<<(std::ostream& out, const annotation_t& details)
   return out;
 }
 
+std::size_t hash_value(const annotation_t& details);
+
+/**
+ * An annotated commodity is identified by its base commodity together
+ * with its annotation details.  annotated_key_t refers to both without
+ * copying them, so that it may be used to look up annotated
+ * commodities in commodity_pool_t without rendering their names.
+ */
+struct annotated_key_t
+{
+  const commodity_t::base_t * base;
+  const annotation_t *	      details;
+
+  annotated_key_t(const commodity_t::base_t * _base,
+		  const annotation_t&	      _details)
+    : base(_base), details(&_details) {}
+
+  // Prices are compared the way hash_value(annotation_t) hashes them,
+  // by the base of their commodity and then by quantity.  Keys priced
+  // in different commodities may share a bucket, so unlike
+  // amount_t::compare this never throws.
+  bool operator==(const annotated_key_t& rhs) const;
+};
+
+inline std::size_t hash_value(const annotated_key_t& key) {
+  std::size_t seed = 0;
+  hash_combine(seed, key.base);
+  hash_combine(seed, *key.details);
+  return seed;
+}
+
 class annotated_commodity_t
   : public commodity_t,
     public equality_comparable<annotated_commodity_t,
@@ -402,6 +433,10 @@ public:
 				 const bool _keep_date,
 				 const bool _keep_tag);
 
+  annotated_key_t key() const {
+    return annotated_key_t(base.get(), details);
+  }
+
   void write_annotations(std::ostream& out) const {
     annotated_commodity_t::write_annotations(out, details);
   }
@@ -448,15 +483,35 @@ class commodity_pool_t : public noncopyable
     >
   > commodities_t;
 
+  /**
+   * Annotated commodities are indexed a second time by their base
+   * commodity and annotation details.  Looking them up this way is
+   * much cheaper than printing the qualified name used as their key in
+   * `commodities', which only needs to be built once, when a new
+   * annotated commodity is created.
+   */
+  typedef multi_index_container<
+    annotated_commodity_t *,
+    multi_index::indexed_by<
+      multi_index::hashed_unique<
+	multi_index::const_mem_fun<annotated_commodity_t,
+				   annotated_key_t,
+				   &annotated_commodity_t::key> >
+    >
+  > annotated_commodities_t;
+
 public:
   typedef commodity_pool_t::commodities_t::nth_index<0>::type
     commodities_by_ident;
 
-  commodities_t commodities;
+  commodities_t		  commodities;
+  annotated_commodities_t annotated_commodities;
 
   commodity_t *	null_commodity;
   commodity_t *	default_commodity;
 
+  bool		frozen;
+
 private:
   template<typename T>
   struct first_initialized
@@ -498,6 +553,7 @@ public:
 
   commodity_t * create(const string& symbol, const annotation_t& details);
   commodity_t * find(const string& symbol, const annotation_t& details);
+  commodity_t * find(const commodity_t& comm, const annotation_t& details);
   commodity_t * find_or_create(const string& symbol,
 			       const annotation_t& details);
 
@@ -507,6 +563,15 @@ public:
 
   commodity_t * find_or_create(commodity_t&	   comm,
 			       const annotation_t& details);
+
+  /**
+   * freeze readies the pool to be read by several threads at once.
+   * It creates in advance every commodity that stripping annotations
+   * could ask for, and marks the amounts it holds -- prices, lot
+   * prices and conversions -- as shared.  Creating a commodity after
+   * this is an error.
+   */
+  void freeze();
 };
 
 } // namespace ledger
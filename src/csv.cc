@@ -30,106 +30,306 @@
  */
 
 #include "csv.h"
+#include "account.h"
+#include "entry.h"
 
 namespace ledger {
 
+const char * format_csv_xacts::default_columns =
+  "date,payee,account,amount,total,state,code,note";
+
 namespace {
-  inline void write_escaped_string(std::ostream& out, const string& xact)
+  // Rows are collected in memory and written out once they reach this
+  // size, so that the stream sees a few large writes rather than one
+  // per field.
+  const std::size_t csv_buffer_size = 64 * 1024;
+
+  struct csv_column_name_t {
+    const char *		name;
+    format_csv_xacts::column_t column;
+  };
+
+  const csv_column_name_t csv_column_names[] = {
+    { "date",		format_csv_xacts::DATE },
+    { "effective_date", format_csv_xacts::EFFECTIVE_DATE },
+    { "payee",		format_csv_xacts::PAYEE },
+    { "account",	format_csv_xacts::ACCOUNT },
+    { "amount",		format_csv_xacts::AMOUNT },
+    { "quantity",	format_csv_xacts::QUANTITY },
+    { "commodity",	format_csv_xacts::COMMODITY },
+    { "cost",		format_csv_xacts::COST },
+    { "total",		format_csv_xacts::TOTAL },
+    { "state",		format_csv_xacts::STATE },
+    { "code",		format_csv_xacts::CODE },
+    { "note",		format_csv_xacts::NOTE },
+    { NULL,		format_csv_xacts::DATE }
+  };
+
+  inline void append_digits(std::string& out, unsigned int value, int width)
   {
-    out << "\"";
-    foreach (char ch, xact)
-      if (ch == '"') {
-	out << "\\";
-	out << "\"";
-      } else {
-	out << ch;
+    char buf[16];
+    int  i = sizeof(buf);
+    do {
+      buf[--i] = char('0' + value % 10);
+      value /= 10;
+    } while (value > 0 || sizeof(buf) - i < std::size_t(width));
+    out.append(buf + i, sizeof(buf) - i);
+  }
+}
+
+format_csv_xacts::format_csv_xacts(std::ostream& _out,
+				   const string& _columns,
+				   char		 _separator)
+  : out(_out), separator(_separator), header_written(false)
+{
+  TRACE_CTOR(format_csv_xacts, "std::ostream&, const string&, char");
+
+  parse_columns(_columns.empty() ? string(default_columns) : _columns);
+  buffer.reserve(csv_buffer_size + 1024);
+}
+
+void format_csv_xacts::parse_columns(const string& spec)
+{
+  string::size_type beg = 0;
+  while (beg <= spec.length()) {
+    string::size_type end = spec.find(',', beg);
+    if (end == string::npos)
+      end = spec.length();
+
+    string name(spec, beg, end - beg);
+    const csv_column_name_t * entry;
+    for (entry = csv_column_names; entry->name; entry++)
+      if (name == entry->name)
+	break;
+    if (! entry->name)
+      throw_(format_error, "Unknown CSV column '" << name << "'");
+
+    columns.push_back(entry->column);
+    beg = end + 1;
+  }
+}
+
+void format_csv_xacts::write_header()
+{
+  for (std::size_t i = 0; i < columns.size(); i++) {
+    if (i > 0)
+      buffer += separator;
+
+    for (const csv_column_name_t * entry = csv_column_names;
+	 entry->name;
+	 entry++)
+      if (entry->column == columns[i]) {
+	buffer += entry->name;
+	break;
       }
-    out << "\"";
   }
+  buffer += '\n';
 }
 
-void format_csv_xacts::operator()(xact_t& xact)
+void format_csv_xacts::write_field(const char * field, std::size_t len)
 {
-  if (! xact.has_xdata() ||
-      ! xact.xdata().has_flags(XACT_EXT_DISPLAYED)) {
-    {
-      format_t fmt("%D");
-      std::ostringstream str;
-#if 0
-      fmt.format(str, details_t(xact));
-#endif
-      write_escaped_string(out, str.str());
-    }
-    out << ',';
-
-    {
-      format_t fmt("%P");
-      std::ostringstream str;
-#if 0
-      fmt.format(str, details_t(xact));
-#endif
-      write_escaped_string(out, str.str());
-    }
-    out << ',';
-
-    {
-      format_t fmt("%A");
-      std::ostringstream str;
-#if 0
-      fmt.format(str, details_t(xact));
-#endif
-      write_escaped_string(out, str.str());
-    }
-    out << ',';
-
-    {
-      format_t fmt("%t");
-      std::ostringstream str;
-#if 0
-      fmt.format(str, details_t(xact));
-#endif
-      write_escaped_string(out, str.str());
-    }
-    out << ',';
-
-    {
-      format_t fmt("%T");
-      std::ostringstream str;
-#if 0
-      fmt.format(str, details_t(xact));
-#endif
-      write_escaped_string(out, str.str());
+  const char * end = field + len;
+
+  if (separator == '\t') {
+    for (const char * p = field; p != end; p++) {
+      const char * run = p;
+      while (p != end && *p != '\t' && *p != '\n' &&
+	     *p != '\r' && *p != '\\')
+	p++;
+      buffer.append(run, p - run);
+      if (p == end)
+	break;
+
+      buffer += '\\';
+      switch (*p) {
+      case '\t': buffer += 't';  break;
+      case '\n': buffer += 'n';  break;
+      case '\r': buffer += 'r';  break;
+      default:	 buffer += '\\'; break;
+      }
     }
-    out << ',';
+    return;
+  }
+
+  const char * p = field;
+  while (p != end && *p != separator && *p != '"' &&
+	 *p != '\n' && *p != '\r')
+    p++;
+
+  if (p == end) {
+    buffer.append(field, len);
+    return;
+  }
+
+  buffer += '"';
+  for (p = field; p != end; p++) {
+    if (*p == '"')
+      buffer += '"';
+    buffer += *p;
+  }
+  buffer += '"';
+}
+
+void format_csv_xacts::write_date(const optional<date_t>& when)
+{
+  if (! when || ! is_valid(*when))
+    return;
+
+  date_t::ymd_type ymd(when->year_month_day());
+  append_digits(buffer, ymd.year, 4);
+  buffer += '-';
+  append_digits(buffer, ymd.month, 2);
+  buffer += '-';
+  append_digits(buffer, ymd.day, 2);
+}
+
+void format_csv_xacts::write_amount(const amount_t& amt)
+{
+  if (amt.is_null())
+    return;
+
+  field.clear();
+  amt.append(field);
+  write_field(field);
+}
+
+void format_csv_xacts::write_balance(const balance_t& bal)
+{
+  if (bal.amounts.empty()) {
+    buffer += '0';
+    return;
+  }
 
-    switch (xact.state()) {
-    case item_t::CLEARED:
-      write_escaped_string(out, "*");
+  field.clear();
+  bool first = true;
+  foreach (const balance_t::amounts_map::value_type& pair, bal.amounts) {
+    if (! first)
+      field += ", ";
+    pair.second.append(field);
+    first = false;
+  }
+  write_field(field);
+}
+
+void format_csv_xacts::write_value(const value_t& val)
+{
+  if (val.is_null())
+    return;
+
+  if (val.is_amount()) {
+    write_amount(val.as_amount());
+  }
+  else if (val.is_balance()) {
+    write_balance(val.as_balance());
+  }
+  else if (val.is_balance_pair()) {
+    write_balance(val.as_balance_pair().quantity());
+  }
+  else {
+    write_field(val.to_string());
+  }
+}
+
+void format_csv_xacts::write_buffer()
+{
+  if (! buffer.empty()) {
+    out.write(buffer.data(), buffer.length());
+    buffer.clear();
+  }
+}
+
+void format_csv_xacts::flush()
+{
+  write_buffer();
+  out.flush();
+}
+
+void format_csv_xacts::operator()(xact_t& xact)
+{
+  if (xact.has_xdata() &&
+      xact.xdata().has_flags(XACT_EXT_DISPLAYED))
+    return;
+
+  if (! header_written) {
+    write_header();
+    header_written = true;
+  }
+
+  for (std::size_t i = 0; i < columns.size(); i++) {
+    if (i > 0)
+      buffer += separator;
+
+    switch (columns[i]) {
+    case DATE:
+      write_date(xact.reported_date());
       break;
-    case item_t::PENDING:
-      write_escaped_string(out, "!");
+    case EFFECTIVE_DATE:
+      write_date(xact.effective_date());
       break;
-    default:
+
+    case PAYEE:
+      if (xact.entry)
+	write_field(xact.entry->payee);
+      break;
+
+    case ACCOUNT:
+      if (const account_t * account = xact.reported_account())
+	write_field(account->fullname());
+      break;
+
+    case AMOUNT:
+      write_amount(xact.amount);
+      break;
+    case QUANTITY:
+      if (! xact.amount.is_null())
+	xact.amount.append_quantity(buffer);
+      break;
+    case COMMODITY:
+      if (! xact.amount.is_null() && xact.amount.has_commodity())
+	write_field(xact.amount.commodity().symbol());
+      break;
+    case COST:
+      if (xact.cost)
+	write_amount(*xact.cost);
       break;
-    }
-    out << ',';
-
-    if (xact.entry->code)
-      write_escaped_string(out, *xact.entry->code);
-    out << ',';
-
-    {
-      format_t fmt("%N");
-      std::ostringstream str;
-#if 0
-      fmt.format(str, details_t(xact));
-#endif
-      write_escaped_string(out, str.str());
-    }
-    out << '\n';
 
-    xact.xdata().add_flags(XACT_EXT_DISPLAYED);
+    case TOTAL:
+      if (xact.has_xdata())
+	write_value(xact.xdata().total);
+      else
+	write_amount(xact.amount);
+      break;
+
+    case STATE:
+      switch (xact.state()) {
+      case item_t::CLEARED:
+	buffer += '*';
+	break;
+      case item_t::PENDING:
+	buffer += '!';
+	break;
+      default:
+	break;
+      }
+      break;
+
+    case CODE:
+      if (xact.entry && xact.entry->code)
+	write_field(*xact.entry->code);
+      break;
+
+    case NOTE:
+      if (xact.note)
+	write_field(*xact.note);
+      break;
+    }
   }
+  buffer += '\n';
+
+  if (buffer.length() >= csv_buffer_size)
+    write_buffer();
+
+  xact.xdata().add_flags(XACT_EXT_DISPLAYED);
 }
 
 } // namespace ledger
@@ -37,27 +37,72 @@
 
 namespace ledger {
 
+/**
+ * format_csv_xacts writes each transaction as one row of comma- or
+ * tab-separated values.  The list of columns is parsed once, when the
+ * handler is created; rows are rendered directly into a buffer, which
+ * is written out in large blocks.
+ *
+ * With a comma separator, fields are quoted as per RFC 4180 when they
+ * contain a comma, a quote or a line break.  With a tab separator,
+ * tabs, line breaks and backslashes are escaped with a backslash
+ * instead, so that every row stays on one line.
+ */
 class format_csv_xacts : public item_handler<xact_t>
 {
   format_csv_xacts();
 
+public:
+  enum column_t {
+    DATE,
+    EFFECTIVE_DATE,
+    PAYEE,
+    ACCOUNT,
+    AMOUNT,
+    QUANTITY,
+    COMMODITY,
+    COST,
+    TOTAL,
+    STATE,
+    CODE,
+    NOTE
+  };
+
+  static const char * default_columns;
+
 protected:
-  std::ostream&	out;
+  std::ostream&		out;
+  char			separator;
+  std::vector<column_t> columns;
+  bool			header_written;
+  std::string		buffer;
+  std::string		field;
 
-public:
-  format_csv_xacts(std::ostream& _out) : out(_out) {
-    TRACE_CTOR(format_csv_xacts, "std::ostream&");
+  void parse_columns(const string& spec);
+
+  void write_header();
+  void write_field(const char * field, std::size_t len);
+  void write_field(const string& field) {
+    write_field(field.data(), field.length());
   }
+  void write_date(const optional<date_t>& when);
+  void write_amount(const amount_t& amt);
+  void write_balance(const balance_t& bal);
+  void write_value(const value_t& val);
+  void write_buffer();
+
+public:
+  format_csv_xacts(std::ostream& _out, const string& _columns = "",
+		   char _separator = ',');
   ~format_csv_xacts() {
     TRACE_DTOR(format_csv_xacts);
+    write_buffer();
   }
 
-  virtual void flush() {
-    out.flush();
-  }
+  virtual void flush();
   virtual void operator()(xact_t& xact);
 };
 
 } // namespace ledger
 
-#endif // _REPORT_H
+#endif // _CSV_H
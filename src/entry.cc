@@ -50,10 +50,11 @@ entry_base_t::~entry_base_t()
 
   foreach (xact_t * xact, xacts) {
     // If the transaction is a temporary, it will be destructed when the
-    // temporary is.  If it's from a binary cache, we can safely destruct it
-    // but its memory will be deallocated with the cache.
+    // temporary is.  If it's from a binary cache or a journal's arena, we
+    // can safely destruct it but its memory will be deallocated with the
+    // cache or the journal.
     if (! xact->has_flags(ITEM_TEMP)) {
-      if (! xact->has_flags(ITEM_IN_CACHE))
+      if (! xact->has_flags(ITEM_IN_CACHE | ITEM_IN_ARENA))
 	checked_delete(xact);
       else
 	xact->~xact_t();
@@ -82,11 +83,18 @@ void entry_base_t::add_xact(xact_t * xact)
 
 bool entry_base_t::remove_xact(xact_t * xact)
 {
-  xacts.remove(xact);
+  xacts.erase(std::remove(xacts.begin(), xacts.end(), xact), xacts.end());
   return true;
 }
 
 bool entry_base_t::finalize()
+{
+  value_t balance;
+  balance_xacts(balance);
+  return settle(balance);
+}
+
+void entry_base_t::balance_xacts(value_t& balance)
 {
   // Scan through and compute the total balance for the entry.  This is used
   // for auto-calculating the value of entries with no cost, and the per-unit
@@ -95,7 +103,6 @@ bool entry_base_t::finalize()
   // (let ((balance 0)
   //       null-xact)
 
-  value_t  balance;
   xact_t * null_xact = NULL;
 
   foreach (xact_t * xact, xacts) {
@@ -191,7 +198,10 @@ bool entry_base_t::finalize()
 
     DEBUG("entry.finalize", "resolved balance = " << balance);
   }
+}
 
+bool entry_base_t::settle(value_t& balance)
+{
   // Now that the xact list has its final form, calculate the balance
   // once more in terms of total cost, accounting for any possible gain/loss
   // amounts.
@@ -254,6 +264,7 @@ entry_t::entry_t(const entry_t& e)
   : entry_base_t(e), code(e.code), payee(e.payee)
 {
   TRACE_CTOR(entry_t, "copy");
+  COUNT_CTOR(entry_t);
 
   foreach (xact_t * xact, xacts)
     xact->entry = this;
@@ -300,6 +311,23 @@ expr_t::ptr_op_t entry_t::lookup(const string& name)
   return item_t::lookup(name);
 }
 
+const interned_string_t * entry_t::lookup_interned(const string& name)
+{
+  switch (name[0]) {
+  case 'c':
+    if (name == "code")
+      return &code;
+    break;
+
+  case 'p':
+    if (name[1] == '\0' || name == "payee")
+      return &payee;
+    break;
+  }
+
+  return item_t::lookup_interned(name);
+}
+
 bool entry_t::valid() const
 {
   if (! _date || ! journal) {
@@ -326,49 +354,202 @@ void entry_context::describe(std::ostream& out) const throw()
 }
 #endif
 
+namespace {
+  // True if the account is the "$account" placeholder of an automated
+  // entry, which stands for the account of the matching transaction.  This
+  // is what comparing fullname() against "$account" would say, without
+  // building a string for every generated transaction.
+  bool is_account_placeholder(const account_t * account)
+  {
+    if (account->name != "$account" && account->name != "@account")
+      return false;
+
+    for (const account_t * parent = account->parent;
+	 parent;
+	 parent = parent->parent)
+      if (! parent->name.empty())
+	return false;
+
+    return true;
+  }
+
+  bool refers_to_account_only(const expr_t::ptr_op_t& op)
+  {
+    if (! op)
+      return true;
+
+    switch (op->kind) {
+    case expr_t::op_t::VALUE:
+    case expr_t::op_t::MASK:
+      return true;
+
+    case expr_t::op_t::IDENT:
+      return (! op->left() &&
+	      (op->as_ident() == "account" ||
+	       op->as_ident() == "account_base"));
+
+    case expr_t::op_t::O_CALL:
+      return false;
+
+    default:
+      break;
+    }
+
+    if (op->kind < expr_t::op_t::TERMINALS ||
+	op->kind > expr_t::op_t::BINARY_OPERATORS)
+      return false;
+
+    if (! refers_to_account_only(op->left()))
+      return false;
+
+    return (op->kind < expr_t::op_t::UNARY_OPERATORS ||
+	    refers_to_account_only(op->right()));
+  }
+}
+
+auto_entry_t::auto_entry_t(const string& _predicate)
+  : predicate(_predicate),
+    account_only(refers_to_account_only(predicate.predicate.get_op()))
+{
+  TRACE_CTOR(auto_entry_t, "const string&");
+}
+
 void auto_entry_t::extend_entry(entry_base_t& entry, bool post)
 {
   xacts_list initial_xacts(entry.xacts.begin(),
 				  entry.xacts.end());
 
-  foreach (xact_t * initial_xact, initial_xacts) {
-    if (predicate(*initial_xact)) {
-      foreach (xact_t * xact, xacts) {
-	amount_t amt;
-	assert(xact->amount);
-	if (! xact->amount.commodity()) {
-	  if (! post)
-	    continue;
-	  assert(initial_xact->amount);
-	  amt = initial_xact->amount * xact->amount;
-	} else {
-	  if (post)
-	    continue;
-	  amt = xact->amount;
-	}
+  foreach (xact_t * initial_xact, initial_xacts)
+    if (predicate(*initial_xact))
+      extend_xact(entry, *initial_xact, post);
+}
 
-	account_t * account  = xact->account;
-	string fullname = account->fullname();
-	assert(! fullname.empty());
-	if (fullname == "$account" || fullname == "@account")
-	  account = initial_xact->account;
+void auto_entry_t::extend_xact(entry_base_t& entry, xact_t& initial_xact,
+			       bool post)
+{
+  foreach (xact_t * xact, xacts) {
+    amount_t amt;
+    assert(xact->amount);
+    if (! xact->amount.commodity()) {
+      if (! post)
+	continue;
+      assert(initial_xact.amount);
+      amt = initial_xact.amount * xact->amount;
+    } else {
+      if (post)
+	continue;
+      // The generated xact may be balanced on another thread (see
+      // journal_t::add_entries), so it must get a quantity of its own
+      // rather than a reference to this one, whose count isn't atomic.
+      xact->amount.mark_shared();
+      amt = xact->amount;
+    }
 
-	// Copy over details so that the resulting xact is a mirror of
-	// the automated entry's one.
-	xact_t * new_xact = new xact_t(account, amt);
-	new_xact->copy_details(*xact);
-	new_xact->add_flags(XACT_AUTO);
+    account_t * account = xact->account;
+    assert(! account->fullname().empty());
+    if (is_account_placeholder(account))
+      account = initial_xact.account;
 
-	entry.add_xact(new_xact);
-      }
+    // Copy over details so that the resulting xact is a mirror of
+    // the automated entry's one.
+    xact_t * new_xact = new xact_t(account, amt);
+    new_xact->copy_details(*xact);
+    new_xact->add_flags(XACT_AUTO);
+
+    entry.add_xact(new_xact);
+  }
+}
+
+void auto_entry_index_t::clear()
+{
+  auto_entries.clear();
+  by_account.clear();
+  candidates.clear();
+}
+
+void auto_entry_index_t::sync(const auto_entries_list& entries)
+{
+  // Automated entries are only ever appended to a journal, so a change in
+  // their number is all that needs noticing.
+  if (entries.size() == auto_entries.size())
+    return;
+
+  clear();
+
+  foreach (auto_entry_t * entry, entries) {
+    auto_entries.push_back(entry);
+    by_account.push_back(entry->tests_account_only());
+  }
+}
+
+const auto_entry_index_t::candidates_t&
+auto_entry_index_t::candidates_for(xact_t& xact)
+{
+  // The "account" value expression function also reports whether a
+  // transaction is virtual, so that is part of what an account-only
+  // predicate sees.
+  index_key_t key(xact.reported_account(),
+		  xact.flags() & (XACT_VIRTUAL | XACT_MUST_BALANCE));
+
+  candidates_map::iterator i = candidates.find(key);
+  if (i != candidates.end())
+    return (*i).second;
+
+  candidates_t& result(candidates[key]);
+  for (std::size_t n = 0; n < auto_entries.size(); n++)
+    if (! by_account[n] || auto_entries[n]->predicate(xact))
+      result.push_back(n);
+
+  return result;
+}
+
+void auto_entry_index_t::extend_entry(const auto_entries_list& entries,
+				      entry_base_t& base, bool post)
+{
+  sync(entries);
+
+  if (auto_entries.empty())
+    return;
+
+  std::vector<bool> pending(auto_entries.size(), false);
+
+  foreach (xact_t * xact, base.xacts)
+    foreach (std::size_t n, candidates_for(*xact))
+      pending[n] = true;
+
+  // Automated entries are applied in the order they were defined, and
+  // each one sees the transactions generated by those before it; so any
+  // transactions added along the way may still make later entries
+  // pending.
+  for (std::size_t n = 0; n < auto_entries.size(); n++) {
+    if (! pending[n])
+      continue;
+
+    auto_entry_t * entry(auto_entries[n]);
+    xacts_list	   initial_xacts(base.xacts.begin(), base.xacts.end());
+
+    foreach (xact_t * initial_xact, initial_xacts) {
+      const candidates_t& matches(candidates_for(*initial_xact));
+      if (! std::binary_search(matches.begin(), matches.end(), n))
+	continue;
+      if (! by_account[n] && ! entry->predicate(*initial_xact))
+	continue;
+
+      entry->extend_xact(base, *initial_xact, post);
     }
+
+    xacts_list::iterator i = base.xacts.begin();
+    std::advance(i, initial_xacts.size());
+    for (; i != base.xacts.end(); i++)
+      foreach (std::size_t m, candidates_for(**i))
+	if (m > n)
+	  pending[m] = true;
   }
 }
 
 void extend_entry_base(journal_t * journal, entry_base_t& base, bool post)
 {
-  foreach (auto_entry_t * entry, journal->auto_entries)
-    entry->extend_entry(base, post);
+  journal->auto_entry_index.extend_entry(journal->auto_entries, base, post);
 }
 
 } // namespace ledger
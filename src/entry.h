@@ -57,6 +57,13 @@ public:
   virtual void add_xact(xact_t * xact);
   virtual bool remove_xact(xact_t * xact);
 
+  // finalize() is balance_xacts() followed by settle().  The first only
+  // touches the entry itself, so journal_t::add_entries may run it for
+  // several entries at once; the second records commodity exchanges and
+  // account totals, which are shared, and so runs one entry at a time.
+  void balance_xacts(value_t& balance);
+  bool settle(value_t& balance);
+
   virtual bool finalize();
   virtual bool valid() const = 0;
 };
@@ -64,21 +71,24 @@ public:
 class entry_t : public entry_base_t
 {
 public:
-  optional<string> code;
-  string	   payee;
+  interned_string_t code;
+  interned_string_t payee;
 
   entry_t() {
     TRACE_CTOR(entry_t, "");
+    COUNT_CTOR(entry_t);
   }
   entry_t(const entry_t& e);
 
   virtual ~entry_t() {
     TRACE_DTOR(entry_t);
+    COUNT_DTOR(entry_t);
   }
 
   virtual void add_xact(xact_t * xact);
 
   virtual expr_t::ptr_op_t lookup(const string& name);
+  virtual const interned_string_t * lookup_interned(const string& name);
 
   virtual bool valid() const;
 };
@@ -93,18 +103,21 @@ class auto_entry_t : public entry_base_t
 public:
   item_predicate<xact_t> predicate;
 
-  auto_entry_t() {
+  // Whether the predicate tests nothing but the account of a
+  // transaction.  This is decided when the entry is made, since once
+  // the predicate has been compiled it no longer names the identifiers
+  // it refers to.
+  bool account_only;
+
+  auto_entry_t() : account_only(false) {
     TRACE_CTOR(auto_entry_t, "");
   }
   auto_entry_t(const auto_entry_t& other)
-    : entry_base_t(), predicate(other.predicate) {
+    : entry_base_t(), predicate(other.predicate),
+      account_only(other.account_only) {
     TRACE_CTOR(auto_entry_t, "copy");
   }
-  auto_entry_t(const string& _predicate)
-    : predicate(_predicate)
-  {
-    TRACE_CTOR(auto_entry_t, "const string&");
-  }
+  auto_entry_t(const string& _predicate);
 
   virtual ~auto_entry_t() {
     TRACE_DTOR(auto_entry_t);
@@ -114,6 +127,11 @@ public:
   virtual bool valid() const {
     return true;
   }
+
+  void extend_xact(entry_base_t& entry, xact_t& initial_xact, bool post);
+  bool tests_account_only() const {
+    return account_only;
+  }
 };
 
 struct auto_entry_finalizer_t : public entry_finalizer_t
@@ -196,10 +214,48 @@ inline bool auto_entry_finalizer_t::operator()(entry_t& entry, bool post) {
   return true;
 }
 
-typedef std::list<entry_t *>	    entries_list;
+// Journals only ever grow at the end, so entries are kept in a deque:
+// scanning it is linear, and appending never copies what is already
+// there, as growing a vector of millions of entries would.
+typedef std::deque<entry_t *>	    entries_list;
 typedef std::list<auto_entry_t *>   auto_entries_list;
 typedef std::list<period_entry_t *> period_entries_list;
 
+/**
+ * @brief Narrows down which automated entries may apply to a transaction.
+ *
+ * Most automated entries test nothing but the account of a transaction,
+ * such as "= /^Expenses:Food/".  Their verdict is the same for every
+ * transaction posted to that account, so it is computed once per account
+ * and remembered.  Only those entries whose predicates look at anything
+ * else are still evaluated for each transaction.
+ */
+class auto_entry_index_t : public noncopyable
+{
+  typedef std::pair<account_t *, xact_t::flags_t> index_key_t;
+  typedef std::vector<std::size_t>		  candidates_t;
+  typedef std::map<index_key_t, candidates_t>	  candidates_map;
+
+  std::vector<auto_entry_t *> auto_entries;
+  std::vector<bool>	      by_account;
+  candidates_map	      candidates;
+
+  void		      sync(const auto_entries_list& entries);
+  const candidates_t& candidates_for(xact_t& xact);
+
+public:
+  auto_entry_index_t() {
+    TRACE_CTOR(auto_entry_index_t, "");
+  }
+  ~auto_entry_index_t() throw() {
+    TRACE_DTOR(auto_entry_index_t);
+  }
+
+  void clear();
+  void extend_entry(const auto_entries_list& entries, entry_base_t& base,
+		    bool post);
+};
+
 } // namespace ledger
 
 #endif // _ENTRY_H
@@ -34,26 +34,30 @@
 
 namespace ledger {
 
-extern std::ostringstream _desc_buffer;
+// The buffers used to build exception messages and their context are
+// kept per thread, so that threads reporting errors at the same time do
+// not garble each other's messages.
+std::ostringstream& error_desc_buffer();
+std::ostringstream& error_ctxt_buffer();
+void release_error_buffers();
 
 template <typename T>
 inline void throw_func(const string& message) {
-  _desc_buffer.str("");
+  error_desc_buffer().str("");
   throw T(message);
 }
 
 #define throw_(cls, msg)					\
-  ((_desc_buffer << msg), throw_func<cls>(_desc_buffer.str()))
-
-extern std::ostringstream _ctxt_buffer;
+  ((error_desc_buffer() << msg),				\
+   throw_func<cls>(error_desc_buffer().str()))
 
 #define add_error_context(msg)					\
-  ((long(_ctxt_buffer.tellp()) == 0) ?				\
-   (_ctxt_buffer << msg) : (_ctxt_buffer << std::endl << msg))
+  ((long(error_ctxt_buffer().tellp()) == 0) ?			\
+   (error_ctxt_buffer() << msg) : (error_ctxt_buffer() << std::endl << msg))
 
 inline string error_context() {
-  string context = _ctxt_buffer.str();
-  _ctxt_buffer.str("");
+  string context = error_ctxt_buffer().str();
+  error_ctxt_buffer().str("");
   return context;
 }
 
@@ -35,7 +35,7 @@
 
 namespace ledger {
 
-std::auto_ptr<expr_t::parser_t> expr_t::parser;
+THREAD_LOCAL expr_t::parser_t * expr_t::parser = NULL;
 
 expr_t::expr_t() : compiled(false)
 {
@@ -88,7 +88,7 @@ expr_t& expr_t::operator=(const expr_t& _expr)
 
 void expr_t::parse(const string& _str, const unsigned int flags)
 {
-  if (! parser.get())
+  if (! parser)
     throw_(parse_error, "Value expression parser not initialized");
 
   str	   = _str;
@@ -99,7 +99,7 @@ void expr_t::parse(const string& _str, const unsigned int flags)
 void expr_t::parse(std::istream& in, const unsigned int flags,
 		   const string * original_string)
 {
-  if (! parser.get())
+  if (! parser)
     throw_(parse_error, "Value expression parser not initialized");
 
   str	   = "<stream>";
@@ -185,12 +185,17 @@ void expr_t::write(std::ostream& out) const
 
 void expr_t::initialize()
 {
-  parser.reset(new expr_t::parser_t);
+  // The parser keeps a lookahead token, so each thread needs its own.
+  if (! parser)
+    parser = new expr_t::parser_t;
 }
 
 void expr_t::shutdown()
 {
-  parser.reset();
+  if (parser) {
+    checked_delete(parser);
+    parser = NULL;
+  }
 }
 
 std::ostream& operator<<(std::ostream& out, const expr_t& expr) {
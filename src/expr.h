@@ -51,7 +51,7 @@ class expr_t
   struct token_t;
 
   class parser_t;
-  static std::auto_ptr<parser_t> parser;
+  static THREAD_LOCAL parser_t * parser;
 
 public:
   class op_t;
@@ -89,6 +89,9 @@ public:
   string text() const throw() {
     return str;
   }
+  ptr_op_t get_op() const throw() {
+    return ptr;
+  }
 
   // This has special use in the textual parser
   void set_text(const string& txt) {
@@ -111,10 +111,72 @@ void set_account_value::operator()(xact_t& xact)
   item_handler<xact_t>::operator()(xact);
 }
 
+namespace {
+  typedef std::pair<std::size_t, xact_t *> ranked_xact_t;
+
+  bool compare_texts(const string * left, const string * right) {
+    return (left ? *left : empty_string) < (right ? *right : empty_string);
+  }
+  bool compare_ranks(const ranked_xact_t& left, const ranked_xact_t& right) {
+    return left.first < right.first;
+  }
+}
+
+// When the sort order is an interned string alone, such as "payee", each
+// distinct string is ranked once, by its text, and the transactions are
+// then ordered by rank.  This spares copying every payee into a value
+// and comparing texts on every step of the sort.  It gives up, leaving
+// the general sort to run, if some transaction has no such string.
+bool sort_xacts::sort_by_interned()
+{
+  expr_t::ptr_op_t op(sort_order.get_op());
+  if (! op || ! op->is_ident())
+    return false;
+
+  std::vector<const string *> keys;
+  keys.reserve(xacts.size());
+  foreach (xact_t * xact, xacts) {
+    const interned_string_t * str = xact->lookup_interned(op->as_ident());
+    if (! str)
+      return false;
+    keys.push_back(str->id());
+  }
+
+  std::vector<const string *> ids(keys);
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  std::sort(ids.begin(), ids.end(), compare_texts);
+
+  // Strings from different tables may have the same text, and must then
+  // share a rank.
+  typedef std::map<const string *, std::size_t> ranks_map;
+
+  ranks_map   ranks;
+  std::size_t rank = 0;
+  for (std::size_t i = 0; i < ids.size(); i++) {
+    if (i > 0 && compare_texts(ids[i - 1], ids[i]))
+      rank++;
+    ranks.insert(ranks_map::value_type(ids[i], rank));
+  }
+
+  std::vector<ranked_xact_t> ranked;
+  ranked.reserve(xacts.size());
+  for (std::size_t i = 0; i < xacts.size(); i++)
+    ranked.push_back(ranked_xact_t(ranks[keys[i]], xacts[i]));
+
+  std::stable_sort(ranked.begin(), ranked.end(), compare_ranks);
+
+  for (std::size_t i = 0; i < ranked.size(); i++)
+    xacts[i] = ranked[i].second;
+
+  return true;
+}
+
 void sort_xacts::post_accumulated_xacts()
 {
-  std::stable_sort(xacts.begin(), xacts.end(),
-		   compare_items<xact_t>(sort_order));
+  if (! sort_by_interned())
+    std::stable_sort(xacts.begin(), xacts.end(),
+		     compare_items<xact_t>(sort_order));
 
   foreach (xact_t * xact, xacts) {
     xact->xdata().drop_flags(XACT_EXT_SORT_CALC);
@@ -233,7 +295,12 @@ void handle_value(const value_t&	value,
   if (flags)
     xdata.add_flags(flags);
 
-  handler(xact);
+  if (profiling_enabled) {
+    profile_scope_t scope(handler.profile());
+    handler(xact);
+  } else {
+    handler(xact);
+  }
 }
 
 void collapse_xacts::report_subtotal()
@@ -360,7 +427,7 @@ void component_xacts::operator()(xact_t& xact)
     ;
 #endif
     else
-      (*handler)(xact);
+      item_handler<xact_t>::operator()(xact);
   }
 }
 
@@ -493,28 +560,41 @@ void by_payee_xacts::flush()
   item_handler<xact_t>::flush();
 
   payee_subtotals.clear();
+  payee_ids.clear();
 }
 
 void by_payee_xacts::operator()(xact_t& xact)
 {
-  payee_subtotals_map::iterator i = payee_subtotals.find(xact.entry->payee);
-  if (i == payee_subtotals.end()) {
-    payee_subtotals_pair
-      temp(xact.entry->payee,
-	   new subtotal_xacts(handler, remember_components));
-    std::pair<payee_subtotals_map::iterator, bool> result
-      = payee_subtotals.insert(temp);
+  const interned_string_t& payee(xact.entry->payee);
 
-    assert(result.second);
-    if (! result.second)
-      return;
-    i = result.first;
+  subtotal_xacts * subtotals;
+
+  payee_ids_map::iterator j = payee_ids.find(payee.id());
+  if (j != payee_ids.end()) {
+    subtotals = (*j).second;
+  } else {
+    // The same payee may have been interned in another table, so the
+    // text decides which subtotal it belongs to.
+    payee_subtotals_map::iterator i = payee_subtotals.find(payee);
+    if (i == payee_subtotals.end()) {
+      payee_subtotals_pair
+	temp(payee, new subtotal_xacts(handler, remember_components));
+      std::pair<payee_subtotals_map::iterator, bool> result
+	= payee_subtotals.insert(temp);
+
+      assert(result.second);
+      if (! result.second)
+	return;
+      i = result.first;
+    }
+    subtotals = (*i).second;
+    payee_ids.insert(payee_ids_map::value_type(payee.id(), subtotals));
   }
 
-  if (xact.date() > (*i).second->start)
-    (*i).second->start = *xact.date();
+  if (xact.date() > subtotals->start)
+    subtotals->start = *xact.date();
 
-  (*(*i).second)(xact);
+  (*subtotals)(xact);
 }
 
 void set_comm_as_payee::operator()(xact_t& xact)
@@ -589,69 +669,132 @@ void generate_xacts::add_xact(const interval_t& period,
   pending_xacts.push_back(pending_xacts_pair(period, &xact));
 }
 
+void budget_xacts::add_xact(const interval_t& period, xact_t& xact)
+{
+  generate_xacts::add_xact(period, xact);
+
+  budget_items.push_back(&pending_xacts.back());
+  budget_ranks.insert(budget_ranks_map::value_type
+		      (xact.reported_account(), budget_items.size() - 1));
+  budget_accounts.clear();
+  scheduled = false;
+}
+
+account_t * budget_xacts::budget_account(account_t * account)
+{
+  budget_accounts_map::iterator i = budget_accounts.find(account);
+  if (i != budget_accounts.end())
+    return (*i).second;
+
+  // The periodic xact listed first wins when several of them budget
+  // different ancestors of this account.
+  account_t * budgeted = NULL;
+  std::size_t rank     = 0;
+
+  for (account_t * acct = account; acct; acct = acct->parent) {
+    budget_ranks_map::iterator j = budget_ranks.find(acct);
+    if (j != budget_ranks.end() && (! budgeted || (*j).second < rank)) {
+      budgeted = acct;
+      rank     = (*j).second;
+    }
+  }
+
+  budget_accounts.insert(budget_accounts_map::value_type(account, budgeted));
+  return budgeted;
+}
+
+void budget_xacts::schedule_budget_items(const date_t& date)
+{
+  schedule.clear();
+
+  for (std::size_t i = 0; i < budget_items.size(); i++) {
+    interval_t& period(budget_items[i]->first);
+    if (! is_valid(period.begin))
+      period.set_start(date);
+
+    if (! is_valid(period.end) || period.begin < period.end)
+      schedule.push_back(i);
+  }
+
+  std::make_heap(schedule.begin(), schedule.end(),
+		 later_budget_item(budget_items));
+  scheduled = true;
+}
+
 void budget_xacts::report_budget_items(const date_t& date)
 {
   if (pending_xacts.size() == 0)
     return;
 
-  bool reported;
-  do {
-    reported = false;
-    foreach (pending_xacts_list::value_type& pair, pending_xacts) {
-      date_t& begin = pair.first.begin;
-      if (! is_valid(begin)) {
-	pair.first.set_start(date);
-	begin = pair.first.begin;
-      }
+  if (! scheduled)
+    schedule_budget_items(date);
 
-      if (begin < date &&
-	  (! is_valid(pair.first.end) || begin < pair.first.end)) {
-	xact_t& xact = *pair.second;
+  later_budget_item order(budget_items);
 
-	DEBUG("ledger.walk.budget", "Reporting budget for "
-	      << xact.reported_account()->fullname());
+  std::vector<std::size_t> due;
+  while (! schedule.empty() &&
+	 budget_items[schedule.front()]->first.begin < date) {
+    std::pop_heap(schedule.begin(), schedule.end(), order);
+    due.push_back(schedule.back());
+    schedule.pop_back();
+  }
 
-	entry_temps.push_back(entry_t());
-	entry_t& entry = entry_temps.back();
-	entry.payee = "Budget entry";
-	entry._date = begin;
+  if (due.empty())
+    return;
 
-	xact_temps.push_back(xact);
-	xact_t& temp = xact_temps.back();
-	temp.entry = &entry;
-	temp.add_flags(XACT_AUTO | ITEM_TEMP);
-	temp.amount.negate();
-	entry.add_xact(&temp);
+  // Due items are reported round by round, one instance of each per
+  // round and in the order they were added, until none is due anymore.
+  std::sort(due.begin(), due.end());
+  std::deque<std::size_t> rounds(due.begin(), due.end());
 
-	begin = pair.first.increment(begin);
+  while (! rounds.empty()) {
+    std::size_t	i = rounds.front();
+    rounds.pop_front();
 
-	item_handler<xact_t>::operator()(temp);
+    interval_t& period(budget_items[i]->first);
+    if (is_valid(period.end) && ! (period.begin < period.end))
+      continue;
 
-	reported = true;
-      }
+    if (! (period.begin < date)) {
+      schedule.push_back(i);
+      std::push_heap(schedule.begin(), schedule.end(), order);
+      continue;
     }
-  } while (reported);
+
+    xact_t& xact = *budget_items[i]->second;
+
+    DEBUG("ledger.walk.budget", "Reporting budget for "
+	  << xact.reported_account()->fullname());
+
+    entry_temps.push_back(entry_t());
+    entry_t& entry = entry_temps.back();
+    entry.payee = "Budget entry";
+    entry._date = period.begin;
+
+    xact_temps.push_back(xact);
+    xact_t& temp = xact_temps.back();
+    temp.entry = &entry;
+    temp.add_flags(XACT_AUTO | ITEM_TEMP);
+    temp.amount.negate();
+    entry.add_xact(&temp);
+
+    period.begin = period.increment(period.begin);
+
+    item_handler<xact_t>::operator()(temp);
+
+    rounds.push_back(i);
+  }
 }
 
 void budget_xacts::operator()(xact_t& xact)
 {
-  bool xact_in_budget = false;
+  account_t * acct	     = budget_account(xact.reported_account());
+  bool	      xact_in_budget = acct != NULL;
 
-  foreach (pending_xacts_list::value_type& pair, pending_xacts)
-    for (account_t * acct = xact.reported_account();
-	 acct;
-	 acct = acct->parent) {
-      if (acct == (*pair.second).reported_account()) {
-	xact_in_budget = true;
-	// Report the xact as if it had occurred in the parent
-	// account.
-	if (xact.reported_account() != acct)
-	  xact.xdata().account = acct;
-	goto handle;
-      }
-    }
+  // Report the xact as if it had occurred in the budgeted parent account.
+  if (acct && xact.reported_account() != acct)
+    xact.xdata().account = acct;
 
- handle:
   if (xact_in_budget && flags & BUDGET_BUDGETED) {
     report_budget_items(*xact.date());
     item_handler<xact_t>::operator()(xact);
@@ -675,64 +818,116 @@ void forecast_xacts::add_xact(const interval_t& period, xact_t& xact)
   }
 }
 
+namespace {
+  // A pending periodic xact as forecast_xacts schedules it.  `spare'
+  // holds the last instance generated for it, if nothing downstream kept
+  // that instance, so that it can be handed out again.
+  struct forecast_slot_t
+  {
+    interval_t * period;
+    xact_t *	 xact;
+    xact_t *	 spare;
+    unsigned int passed;
+
+    forecast_slot_t(interval_t& _period, xact_t& _xact)
+      : period(&_period), xact(&_xact), spare(NULL), passed(0) {}
+  };
+
+  // Orders slot indices so that std::make_heap et al. keep the earliest
+  // next occurrence at the front.  Ties go to the slot added first, just
+  // as they would in a linear scan.
+  struct later_occurrence
+  {
+    const std::vector<forecast_slot_t>& slots;
+
+    later_occurrence(const std::vector<forecast_slot_t>& _slots)
+      : slots(_slots) {}
+
+    bool operator()(const std::size_t left, const std::size_t right) const {
+      const date_t& l(slots[left].period->begin);
+      const date_t& r(slots[right].period->begin);
+      return r < l || (l == r && right < left);
+    }
+  };
+}
+
 void forecast_xacts::flush()
 {
-  xacts_list passed;
-  date_t last;
-
-  while (pending_xacts.size() > 0) {
-    pending_xacts_list::iterator least = pending_xacts.begin();
-    for (pending_xacts_list::iterator i = ++pending_xacts.begin();
-	 i != pending_xacts.end();
-	 i++)
-      if ((*i).first.begin < (*least).first.begin)
-	least = i;
-
-    date_t& begin = (*least).first.begin;
-
-    if (is_valid((*least).first.end) && begin >= (*least).first.end) {
-      pending_xacts.erase(least);
-      passed.remove((*least).second);
+  std::vector<forecast_slot_t> slots;
+  foreach (pending_xacts_list::value_type& pair, pending_xacts)
+    slots.push_back(forecast_slot_t(pair.first, *pair.second));
+
+  std::vector<std::size_t> schedule;
+  for (std::size_t i = 0; i < slots.size(); i++)
+    schedule.push_back(i);
+
+  later_occurrence order(slots);
+  std::make_heap(schedule.begin(), schedule.end(), order);
+
+  // An instance which comes back without XACT_EXT_MATCHES was dropped by
+  // the filter directly below us, and so its storage may be reused.
+  bool recycle = dynamic_cast<filter_xacts *>(handler.get()) != NULL;
+
+  // `passed' counts the slots which have generated an instance since the
+  // last one that matched; a slot belongs to the current round when its
+  // own `passed' equals `round'.
+  unsigned int round  = 1;
+  std::size_t  passed = 0;
+  date_t       last;
+
+  while (! schedule.empty()) {
+    forecast_slot_t& slot(slots[schedule.front()]);
+    date_t& begin = slot.period->begin;
+
+    if (is_valid(slot.period->end) && begin >= slot.period->end) {
+      std::pop_heap(schedule.begin(), schedule.end(), order);
+      schedule.pop_back();
+      if (slot.passed == round)
+	passed--;
       continue;
     }
 
-    xact_t& xact = *(*least).second;
-
-    entry_temps.push_back(entry_t());
-    entry_t& entry = entry_temps.back();
-    entry.payee = "Forecast entry";
-    entry._date = begin;
-
-    xact_temps.push_back(xact);
-    xact_t& temp = xact_temps.back();
-    temp.entry = &entry;
-    temp.add_flags(XACT_AUTO | ITEM_TEMP);
-    entry.add_xact(&temp);
+    xact_t * temp = slot.spare;
+    if (temp) {
+      slot.spare = NULL;
+      temp->clear_xdata();
+    } else {
+      entry_temps.push_back(entry_t());
+      entry_t& entry = entry_temps.back();
+      entry.payee = "Forecast entry";
+
+      xact_temps.push_back(*slot.xact);
+      temp = &xact_temps.back();
+      temp->entry = &entry;
+      temp->add_flags(XACT_AUTO | ITEM_TEMP);
+      entry.add_xact(temp);
+    }
+    temp->entry->_date = begin;
 
-    date_t next = (*least).first.increment(begin);
+    date_t next = slot.period->increment(begin);
     if (next < begin || (is_valid(last) && (next - last).days() > 365 * 5))
       break;
+
+    std::pop_heap(schedule.begin(), schedule.end(), order);
     begin = next;
+    std::push_heap(schedule.begin(), schedule.end(), order);
 
-    item_handler<xact_t>::operator()(temp);
+    item_handler<xact_t>::operator()(*temp);
 
-    if (temp.has_xdata() &&
-	temp.xdata().has_flags(XACT_EXT_MATCHES)) {
-      if (! pred(temp))
+    if (temp->has_xdata() &&
+	temp->xdata().has_flags(XACT_EXT_MATCHES)) {
+      if (! pred(*temp))
 	break;
-      last = *temp.date();
-      passed.clear();
+      last = *temp->date();
+      round++;
+      passed = 0;
     } else {
-      bool found = false;
-      foreach (xact_t * x, passed)
-	if (x == &xact) {
-	  found = true;
-	  break;
-	}
+      if (recycle)
+	slot.spare = temp;
 
-      if (! found) {
-	passed.push_back(&xact);
-	if (passed.size() >= pending_xacts.size())
+      if (slot.passed != round) {
+	slot.passed = round;
+	if (++passed >= schedule.size())
 	  break;
       }
     }
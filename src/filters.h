@@ -137,6 +137,8 @@ class sort_xacts : public item_handler<xact_t>
 
   sort_xacts();
 
+  bool sort_by_interned();
+
 public:
   sort_xacts(xact_handler_ptr handler,
 		    const expr_t&    _sort_order)
@@ -234,7 +236,7 @@ public:
   virtual void operator()(xact_t& xact) {
     if (pred(xact)) {
       xact.xdata().add_flags(XACT_EXT_MATCHES);
-      (*handler)(xact);
+      item_handler<xact_t>::operator()(xact);
     }
   }
 };
@@ -511,7 +513,12 @@ class by_payee_xacts : public item_handler<xact_t>
   typedef std::map<string, subtotal_xacts *>  payee_subtotals_map;
   typedef std::pair<string, subtotal_xacts *> payee_subtotals_pair;
 
+  // The subtotals again, keyed by the ids of the interned payees, so
+  // that most xacts find theirs without comparing any text.
+  typedef std::map<const string *, subtotal_xacts *> payee_ids_map;
+
   payee_subtotals_map payee_subtotals;
+  payee_ids_map	      payee_ids;
   bool		      remember_components;
 
   by_payee_xacts();
@@ -628,12 +635,40 @@ class budget_xacts : public generate_xacts
 
   unsigned short flags;
 
+  // Each budgeted account maps to the position of the first periodic xact
+  // that budgets it, and every account seen so far maps to the nearest
+  // ancestor that is budgeted (or NULL).  Pending budget items are kept in
+  // a heap ordered by when they next fall due.
+  typedef std::map<account_t *, std::size_t> budget_ranks_map;
+  typedef std::map<account_t *, account_t *> budget_accounts_map;
+
+  budget_ranks_map		    budget_ranks;
+  budget_accounts_map		    budget_accounts;
+  std::vector<pending_xacts_pair *> budget_items;
+  std::vector<std::size_t>	    schedule;
+  bool				    scheduled;
+
+  struct later_budget_item
+  {
+    const std::vector<pending_xacts_pair *>& items;
+
+    later_budget_item(const std::vector<pending_xacts_pair *>& _items)
+      : items(_items) {}
+
+    bool operator()(const std::size_t left, const std::size_t right) const {
+      return items[right]->first.begin < items[left]->first.begin;
+    }
+  };
+
   budget_xacts();
 
+  account_t * budget_account(account_t * account);
+  void	      schedule_budget_items(const date_t& date);
+
 public:
   budget_xacts(xact_handler_ptr handler,
 		      unsigned long _flags = BUDGET_BUDGETED)
-    : generate_xacts(handler), flags(_flags) {
+    : generate_xacts(handler), flags(_flags), scheduled(false) {
     TRACE_CTOR(budget_xacts,
 	       "xact_handler_ptr, unsigned long");
   }
@@ -643,6 +678,7 @@ public:
 
   void report_budget_items(const date_t& date);
 
+  virtual void add_xact(const interval_t& period, xact_t& xact);
   virtual void operator()(xact_t& xact);
 };
 
@@ -35,12 +35,12 @@
 
 namespace ledger {
 
-format_t::elision_style_t
-     format_t::elision_style = ABBREVIATE;
-int  format_t::abbrev_length = 2;
+THREAD_LOCAL format_t::elision_style_t
+		  format_t::elision_style = ABBREVIATE;
+THREAD_LOCAL int  format_t::abbrev_length = 2;
 
-bool format_t::ansi_codes    = false;
-bool format_t::ansi_invert   = false;
+THREAD_LOCAL bool format_t::ansi_codes    = false;
+THREAD_LOCAL bool format_t::ansi_invert   = false;
 
 void format_t::element_t::dump(std::ostream& out) const
 {
@@ -87,6 +87,18 @@ namespace {
 
     return name;
   }
+
+  string depth_spacer(account_t& account)
+  {
+    string spacer;
+
+    for (account_t * acct = &account; acct; acct = acct->parent)
+      if (acct->has_xdata() &&
+	  acct->xdata().has_flags(ACCOUNT_EXT_DISPLAYED))
+	spacer += "  ";
+
+    return spacer;
+  }
 }
 
 format_t::element_t * format_t::parse_elements(const string& fmt)
@@ -264,59 +276,278 @@ namespace {
   }
 }
 
-void format_t::format(std::ostream& out_str, scope_t& scope)
+format_t::instr_t::kind_t
+format_t::classify_element(const element_t * elem)
+{
+  assert(elem->type == element_t::EXPR);
+
+  // Single character format codes, such as %D or %t, keep the parsed
+  // character in `chars'.
+  if (elem->chars.length() == 1) {
+    switch (elem->chars[0]) {
+    case 'D': return instr_t::DATE;
+    case 'P': return instr_t::PAYEE;
+    case 'A': return instr_t::ACCOUNT;
+    case 't': return instr_t::AMOUNT;
+    case 'T': return instr_t::TOTAL;
+    case '_': return instr_t::DEPTH_SPACER;
+    default:  return instr_t::EXPR;
+    }
+  }
+
+  // Otherwise, see whether the expression is simply "(name)", where
+  // name is one of the values we know how to access directly.
+  const string text(elem->expr.text());
+  if (text.length() < 3 || text[0] != '(' || text[text.length() - 1] != ')')
+    return instr_t::EXPR;
+
+  string::size_type beg = 1;
+  string::size_type end = text.length() - 1;
+  while (beg < end && std::isspace(text[beg]))
+    beg++;
+  while (end > beg && std::isspace(text[end - 1]))
+    end--;
+
+  const string name(text, beg, end - beg);
+
+  if (name == "date")
+    return instr_t::DATE;
+  else if (name == "payee")
+    return instr_t::PAYEE;
+  else if (name == "account")
+    return instr_t::ACCOUNT;
+  else if (name == "amount")
+    return instr_t::AMOUNT;
+  else if (name == "total")
+    return instr_t::TOTAL;
+  else if (name == "partial_account")
+    return instr_t::PARTIAL_ACCOUNT;
+  else if (name == "depth_spacer")
+    return instr_t::DEPTH_SPACER;
+
+  return instr_t::EXPR;
+}
+
+void format_t::compile()
 {
+  program.clear();
+  has_accessors = false;
+
   for (element_t * elem = elements.get(); elem; elem = elem->next.get()) {
-    std::ostringstream out;
-    string name;
+    if (elem->type == element_t::STRING) {
+      // Literal text never changes, so render it now, padding and all,
+      // and append it to any literal text immediately preceding it.
+      std::ostringstream out;
+      if (elem->has_flags(ELEMENT_ALIGN_LEFT))
+	out << std::left;
+      else
+	out << std::right;
+      if (elem->min_width > 0)
+	out.width(elem->min_width);
+      out << elem->chars;
+
+      string text = out.str();
+      if (! elem->has_flags(ELEMENT_FORMATTED) &&
+	  elem->max_width > 0 && elem->max_width < text.length())
+	text = truncate(text, elem->max_width);
+
+      if (! program.empty() && program.back().kind == instr_t::LITERAL)
+	program.back().chars += text;
+      else
+	program.push_back(instr_t(text));
+    } else {
+      instr_t::kind_t kind = classify_element(elem);
+      if (kind != instr_t::EXPR)
+	has_accessors = true;
+      program.push_back(instr_t(kind, elem));
+    }
+  }
+
+  DEBUG("format.compile", "Compiled '" << format_string << "' into "
+	<< program.size() << " instructions");
+}
 
-    if (elem->has_flags(ELEMENT_ALIGN_LEFT))
-      out << std::left;
+void format_t::write_string(std::ostream& out, const instr_t& instr,
+			    const string& str)
+{
+  // The common case needs neither padding nor truncation, so avoid
+  // copying the string at all.
+  if (instr.min_width <= str.length() &&
+      ! (instr.truncate && instr.max_width < str.length())) {
+    out << str;
+    return;
+  }
+
+  string text(str);
+  if (instr.min_width > text.length()) {
+    if (instr.align_left)
+      text.append(instr.min_width - text.length(), ' ');
     else
-      out << std::right;
+      text.insert(string::size_type(0), instr.min_width - text.length(), ' ');
+  }
+  if (instr.truncate && instr.max_width < text.length())
+    text = truncate(text, instr.max_width);
 
-    if (elem->min_width > 0)
-      out.width(elem->min_width);
+  out << text;
+}
 
-    switch (elem->type) {
-    case element_t::STRING:
-      out << elem->chars;
-      break;
+void format_t::write_value(std::ostream& out, const instr_t& instr,
+			   const value_t& value)
+{
+  scratch.str("");
+  scratch.clear();
 
-    case element_t::EXPR:
-      try {
-	elem->expr.compile(scope);
+  if (instr.align_left)
+    scratch << std::left;
+  else
+    scratch << std::right;
 
-	value_t value;
-	if (elem->expr.is_function()) {
-	  call_scope_t args(scope);
-	  args.push_back(long(elem->max_width));
-	  value = elem->expr.get_function()(args);
-	} else {
-	  value = elem->expr.calc(scope);
-	}
-	DEBUG("format.expr", "value = (" << value << ")");
-	value.strip_annotations().dump(out, elem->min_width);
-      }
-      catch (const calc_error&) {
-	out << (string("%") + elem->chars);
+  if (instr.min_width > 0)
+    scratch.width(instr.min_width);
+
+  value.strip_annotations().dump(scratch, instr.min_width);
+
+  const string& temp(scratch.str());
+
+  DEBUG("format.expr", "output = \"" << temp << "\"");
+
+  if (instr.truncate && instr.max_width < temp.length())
+    out << truncate(temp, instr.max_width);
+  else
+    out << temp;
+}
+
+bool format_t::format_accessor(std::ostream& out, const instr_t& instr,
+			       xact_t * xact, account_t * account)
+{
+  if (xact) {
+    switch (instr.kind) {
+    case instr_t::DATE:
+      if (optional<date_t> date = xact->date())
+	write_string(out, instr, format_date(*date));
+      else
+	write_value(out, instr, 0L);
+      return true;
+
+    case instr_t::PAYEE:
+      if (! xact->entry)
+	return false;
+      write_string(out, instr, xact->entry->payee);
+      return true;
+
+    case instr_t::ACCOUNT: {
+      // Like get_account, abbreviate the name to fit before adding the
+      // brackets of a virtual account.
+      string name = xact->reported_account()->fullname();
+      if (instr.max_width > 2)
+	name = truncate(name, instr.max_width - 2, true);
+      if (xact->has_flags(XACT_VIRTUAL)) {
+	if (xact->must_balance())
+	  name = string("[") + name + "]";
+	else
+	  name = string("(") + name + ")";
       }
+      write_string(out, instr, name);
+      return true;
+    }
+
+    case instr_t::AMOUNT:
+      if (xact->has_xdata() &&
+	  xact->xdata().has_flags(XACT_EXT_COMPOUND))
+	write_value(out, instr, xact->xdata().value);
+      else
+	write_value(out, instr, xact->amount);
+      return true;
+
+    case instr_t::TOTAL:
+      if (xact->has_xdata())
+	write_value(out, instr, xact->xdata().total);
+      else
+	write_value(out, instr, xact->amount);
+      return true;
+
+    default:
       break;
+    }
+  }
+  else if (account && account->has_xdata()) {
+    switch (instr.kind) {
+    case instr_t::AMOUNT:
+      write_value(out, instr, account->xdata().value);
+      return true;
+
+    case instr_t::TOTAL:
+      write_value(out, instr, account->xdata().total);
+      return true;
+
+    case instr_t::PARTIAL_ACCOUNT:
+      write_string(out, instr, partial_account_name(*account));
+      return true;
+
+    case instr_t::DEPTH_SPACER:
+      write_string(out, instr, depth_spacer(*account));
+      return true;
 
     default:
-      assert(false);
       break;
     }
+  }
+  return false;
+}
 
-    string temp = out.str();
+void format_t::format_expr(std::ostream& out, const instr_t& instr,
+			   scope_t& scope)
+{
+  element_t * elem = instr.elem;
+  assert(elem);
 
-    DEBUG("format.expr", "output = \"" << temp << "\"");
+  try {
+    elem->expr.compile(scope);
 
-    if (! elem->has_flags(ELEMENT_FORMATTED) &&
-	elem->max_width > 0 && elem->max_width < temp.length())
-      out_str << truncate(temp, elem->max_width);
-    else
-      out_str << temp;
+    value_t value;
+    if (elem->expr.is_function()) {
+      call_scope_t args(scope);
+      args.push_back(long(elem->max_width));
+      value = elem->expr.get_function()(args);
+    } else {
+      value = elem->expr.calc(scope);
+    }
+    DEBUG("format.expr", "value = (" << value << ")");
+
+    write_value(out, instr, value);
+  }
+  catch (const calc_error&) {
+    write_string(out, instr, string("%") + elem->chars);
+  }
+}
+
+void format_t::format(std::ostream& out_str, scope_t& scope)
+{
+  // Determine the kind of object being formatted only once, rather than
+  // once per element.
+  xact_t *    xact    = NULL;
+  account_t * account = NULL;
+  if (has_accessors) {
+    xact = dynamic_cast<xact_t *>(&scope);
+    if (! xact)
+      account = dynamic_cast<account_t *>(&scope);
+  }
+
+  foreach (const instr_t& instr, program) {
+    switch (instr.kind) {
+    case instr_t::LITERAL:
+      out_str << instr.chars;
+      break;
+
+    case instr_t::EXPR:
+      format_expr(out_str, instr, scope);
+      break;
+
+    default:
+      if (! format_accessor(out_str, instr, xact, account))
+	format_expr(out_str, instr, scope);
+      break;
+    }
   }
 }
 
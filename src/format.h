@@ -84,8 +84,70 @@ class format_t : public noncopyable
     void dump(std::ostream& out) const;
   };
 
+  /**
+   * After parsing, the element list is compiled once into a flat
+   * program.  Adjacent literal elements are rendered (with their
+   * padding) and coalesced into a single string, and the most common
+   * format codes are bound to direct accessors on the transaction or
+   * account being formatted, so that they bypass expression evaluation
+   * entirely.  Anything else falls back to evaluating the element's
+   * expression.
+   */
+  struct instr_t
+  {
+    enum kind_t {
+      LITERAL,
+      EXPR,
+      DATE,			// %D, %(date)
+      PAYEE,			// %P, %(payee)
+      ACCOUNT,			// %A, %(account)
+      AMOUNT,			// %t, %(amount)
+      TOTAL,			// %T, %(total)
+      PARTIAL_ACCOUNT,		// %(partial_account)
+      DEPTH_SPACER		// %_, %(depth_spacer)
+    };
+
+    kind_t	  kind;
+    bool	  align_left;
+    bool	  truncate;
+    unsigned char min_width;
+    unsigned char max_width;
+    string	  chars;
+    element_t *	  elem;
+
+    instr_t(const string& _chars)
+      : kind(LITERAL), align_left(false), truncate(false),
+	min_width(0), max_width(0), chars(_chars), elem(NULL) {
+      TRACE_CTOR(instr_t, "const string&");
+    }
+    instr_t(kind_t _kind, element_t * _elem)
+      : kind(_kind),
+	align_left(_elem->has_flags(ELEMENT_ALIGN_LEFT)),
+	truncate(! _elem->has_flags(ELEMENT_FORMATTED) &&
+		 _elem->max_width > 0),
+	min_width(_elem->min_width), max_width(_elem->max_width),
+	chars(_elem->chars), elem(_elem) {
+      TRACE_CTOR(instr_t, "kind_t, element_t *");
+    }
+    instr_t(const instr_t& other)
+      : kind(other.kind), align_left(other.align_left),
+	truncate(other.truncate), min_width(other.min_width),
+	max_width(other.max_width), chars(other.chars),
+	elem(other.elem) {
+      TRACE_CTOR(instr_t, "copy");
+    }
+    ~instr_t() throw() {
+      TRACE_DTOR(instr_t);
+    }
+  };
+
+  typedef std::vector<instr_t> program_t;
+
   string		 format_string;
   scoped_ptr<element_t>	 elements;
+  program_t		 program;
+  bool			 has_accessors;
+  std::ostringstream	 scratch;
 
 public:
   enum elision_style_t {
@@ -97,19 +159,31 @@ public:
 
 private:
   // jww (2008-08-02): Should these four be here, or in session_t?
-  static elision_style_t elision_style;
-  static int		 abbrev_length;
+  static THREAD_LOCAL elision_style_t elision_style;
+  static THREAD_LOCAL int	      abbrev_length;
 
-  static bool		 ansi_codes;
-  static bool		 ansi_invert;
+  static THREAD_LOCAL bool	      ansi_codes;
+  static THREAD_LOCAL bool	      ansi_invert;
 
   static element_t * parse_elements(const string& fmt);
+  static instr_t::kind_t classify_element(const element_t * elem);
+
+  void compile();
+
+  void format_expr(std::ostream& out, const instr_t& instr, scope_t& scope);
+  bool format_accessor(std::ostream& out, const instr_t& instr,
+		       xact_t * xact, account_t * account);
+
+  void write_string(std::ostream& out, const instr_t& instr,
+		    const string& str);
+  void write_value(std::ostream& out, const instr_t& instr,
+		   const value_t& value);
 
 public:
-  format_t() {
+  format_t() : has_accessors(false) {
     TRACE_CTOR(format_t, "");
   }
-  format_t(const string& _format) {
+  format_t(const string& _format) : has_accessors(false) {
     TRACE_CTOR(format_t, "const string&");
     parse(_format);
   }
@@ -120,6 +194,7 @@ public:
   void parse(const string& _format) {
     elements.reset(parse_elements(_format));
     format_string = _format;
+    compile();
   }
 
   void format(std::ostream& out, scope_t& scope);
@@ -42,25 +42,47 @@ template <typename T>
 struct item_handler : public noncopyable
 {
   shared_ptr<item_handler> handler;
+  profile_site_t *	   site;
 
 public:
-  item_handler() {
+  item_handler() : site(NULL) {
     TRACE_CTOR(item_handler, "");
   }
-  item_handler(shared_ptr<item_handler> _handler) : handler(_handler) {
+  item_handler(shared_ptr<item_handler> _handler)
+    : handler(_handler), site(NULL) {
     TRACE_CTOR(item_handler, "shared_ptr<item_handler>");
   }
   virtual ~item_handler() {
     TRACE_DTOR(item_handler);
   }
 
+  // All handlers of the same type share one profile site, so that
+  // --profile reports the cost of each stage of the chain.
+  profile_site_t& profile() {
+    if (! site)
+      site = &profile_site(typeid(*this));
+    return *site;
+  }
+
   virtual void flush() {
-    if (handler.get())
-      handler->flush();
+    if (handler.get()) {
+      if (profiling_enabled) {
+	profile_scope_t scope(handler->profile(), 0);
+	handler->flush();
+      } else {
+	handler->flush();
+      }
+    }
   }
   virtual void operator()(T& item) {
-    if (handler.get())
-      (*handler.get())(item);
+    if (handler.get()) {
+      if (profiling_enabled) {
+	profile_scope_t scope(handler->profile());
+	(*handler.get())(item);
+      } else {
+	(*handler.get())(item);
+      }
+    }
   }
 };
 
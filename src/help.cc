@@ -48,12 +48,17 @@ Basic options:\n\
   -i, --init-file FILE   initialize ledger using FILE (default: ~/.ledgerrc)\n\
       --cache FILE       use FILE as a binary cache when --file is not used\n\
       --no-cache         don't use a cache, even if it would be appropriate\n\
+      --finalize-jobs N  balance entries on N threads while reading data\n\
+      --checkpoints FILE keep monthly account totals in FILE for balance\n\
   -a, --account NAME     use NAME for the default account (useful with QIF)\n\n\
 Commands:\n\
   balance  [REGEXP]...   show balance totals for matching accounts\n\
   register [REGEXP]...   show register of matching transactions\n\
   print    [REGEXP]...   print all matching entries\n\
   xml      [REGEXP]...   print matching entries in XML format\n\
+  csv      [REGEXP]...   print matching transactions as comma-separated values\n\
+  tsv      [REGEXP]...   print matching transactions as tab-separated values\n\
+  export   [REGEXP]...   write matching transactions as a binary column table\n\
   equity   [REGEXP]...   output equity entries for matching accounts\n\
   prices   [REGEXP]...   display price history for matching commodities\n\
   entry DATE PAYEE AMT   output a derived entry, based on the arguments\n";
@@ -109,7 +114,10 @@ void disp_help(std::ostream& out)
   -F, --format STR       use STR as the format; for each report type, use:\n\
       --balance-format      --register-format       --print-format\n\
       --plot-amount-format  --plot-total-format     --equity-format\n\
-      --prices-format       --wide-register-format\n";
+      --prices-format       --wide-register-format\n\
+      --csv-columns LIST columns for csv and tsv; default: date,payee,account,\n\
+                         amount,total,state,code,note; also: effective_date,\n\
+                         quantity,commodity,cost\n";
 }
 
 void comm_help(std::ostream& out)
@@ -137,6 +145,8 @@ Basic options:\n\
   -i, --init-file FILE   initialize ledger using FILE (default: ~/.ledgerrc)\n\
       --cache FILE       use FILE as a binary cache when --file is not used\n\
       --no-cache         don't use a cache, even if it would be appropriate\n\
+      --finalize-jobs N  balance entries on N threads while reading data\n\
+      --checkpoints FILE keep monthly account totals in FILE for balance\n\
   -a, --account NAME     use NAME for the default account (useful with QIF)\n\n\
 Report filtering:\n\
   -c, --current          show only current and past entries (not future)\n\
@@ -182,7 +192,10 @@ Output customization:\n\
   -F, --format STR       use STR as the format; for each report type, use:\n\
       --balance-format      --register-format       --print-format\n\
       --plot-amount-format  --plot-total-format     --equity-format\n\
-      --prices-format       --wide-register-format\n\n\
+      --prices-format       --wide-register-format\n\
+      --csv-columns LIST columns for csv and tsv; default: date,payee,account,\n\
+                         amount,total,state,code,note; also: effective_date,\n\
+                         quantity,commodity,cost\n\n\
 Commodity reporting:\n\
       --price-db FILE    sets the price database to FILE (def: ~/.pricedb)\n\
   -L, --price-exp MINS   download quotes only if newer than MINS (def: 1440)\n\
@@ -197,6 +210,9 @@ Commands:\n\
   register [REGEXP]...   show register of matching transactions\n\
   print    [REGEXP]...   print all matching entries\n\
   xml      [REGEXP]...   print matching entries in XML format\n\
+  csv      [REGEXP]...   print matching transactions as comma-separated values\n\
+  tsv      [REGEXP]...   print matching transactions as tab-separated values\n\
+  export   [REGEXP]...   write matching transactions as a binary column table\n\
   equity   [REGEXP]...   output equity entries for matching accounts\n\
   prices   [REGEXP]...   display price history for matching commodities\n\
   entry DATE PAYEE AMT   output a derived entry, based on the arguments\n";
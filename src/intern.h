@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2003-2008, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _INTERN_H
+#define _INTERN_H
+
+#include "utils.h"
+
+namespace ledger {
+
+// Payees, codes and notes repeat heavily: a large journal may name the
+// same few thousand payees millions of times.  Each distinct text is
+// therefore kept once, in a string_table_t owned by the session, and
+// the items which use it hold only a pointer to the table's copy.
+//
+// The table's strings never move and are never freed before the table
+// is, so a pointer serves as the string's id: two strings interned in
+// the same table are equal exactly when their pointers are.
+
+class string_table_t : public noncopyable
+{
+  std::set<string>    strings;
+#if defined(HAVE_BOOST_THREAD)
+  boost::mutex	      lock;	// threads reporting on a frozen session
+#endif				// may intern strings of their own
+  const unsigned long serial_;
+
+  static unsigned long next_serial;
+
+public:
+  string_table_t() : serial_(COUNT_ADD(next_serial, 1)) {
+    TRACE_CTOR(string_table_t, "");
+  }
+  ~string_table_t() throw() {
+    TRACE_DTOR(string_table_t);
+  }
+
+  const string * intern(const string& str);
+
+  std::size_t size() const {
+    return strings.size();
+  }
+
+  // Unlike the table's address, which a later table may be given, no two
+  // tables ever share a serial number.
+  unsigned long serial() const {
+    return serial_;
+  }
+};
+
+// interned_string_t is a string held by its table, and is either null
+// or refers to one string.  Used for an optional field, like a note, it
+// reads much like optional<string>; used for a plain string, like a
+// payee, a null value reads as the empty string.
+
+class interned_string_t
+{
+  const string * str;
+
+  typedef const string * interned_string_t::*unspecified_bool_type;
+
+public:
+  // The table new strings go into: the current session's, or a shared
+  // default table when no session is active.  See set_session_context.
+  static THREAD_LOCAL string_table_t * table;
+
+  static string_table_t * current_table();
+  static const string *	  intern(const string& str);
+
+  interned_string_t() : str(NULL) {
+    TRACE_CTOR(interned_string_t, "");
+  }
+  explicit interned_string_t(const string& other) : str(intern(other)) {
+    TRACE_CTOR(interned_string_t, "const string&");
+  }
+  interned_string_t(const interned_string_t& other) : str(other.str) {
+    TRACE_CTOR(interned_string_t, "copy");
+  }
+  ~interned_string_t() throw() {
+    TRACE_DTOR(interned_string_t);
+  }
+
+  interned_string_t& operator=(const interned_string_t& other) {
+    str = other.str;
+    return *this;
+  }
+  interned_string_t& operator=(const string& other) {
+    str = intern(other);
+    return *this;
+  }
+  interned_string_t& operator=(const char * other) {
+    str = intern(other);
+    return *this;
+  }
+  interned_string_t& operator=(const optional<string>& other) {
+    str = other ? intern(*other) : NULL;
+    return *this;
+  }
+  interned_string_t& operator=(const none_t&) {
+    str = NULL;
+    return *this;
+  }
+
+  // Strings from the same table compare by pointer; the text is only
+  // consulted when they come from different tables.
+  bool operator==(const interned_string_t& other) const {
+    return str == other.str || (str && other.str && *str == *other.str);
+  }
+  bool operator!=(const interned_string_t& other) const {
+    return ! (*this == other);
+  }
+
+  operator unspecified_bool_type() const {
+    return str ? &interned_string_t::str : NULL;
+  }
+  bool operator!() const {
+    return str == NULL;
+  }
+
+  operator const string&() const {
+    return str ? *str : empty_string;
+  }
+  const string& operator*() const {
+    assert(str);
+    return *str;
+  }
+  const string * operator->() const {
+    assert(str);
+    return str;
+  }
+
+  // The id of the string: the same for every copy of the same text
+  // interned in the same table, and NULL for a null string.
+  const string * id() const {
+    return str;
+  }
+
+  bool empty() const {
+    return ! str || str->empty();
+  }
+  const char * c_str() const {
+    return str ? str->c_str() : "";
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& out,
+				const interned_string_t& str) {
+  out << static_cast<const string&>(str);
+  return out;
+}
+
+} // namespace ledger
+
+#endif // _INTERN_H
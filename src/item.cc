@@ -35,7 +35,7 @@
 
 namespace ledger {
 
-bool item_t::use_effective_date = false;
+THREAD_LOCAL bool item_t::use_effective_date = false;
 
 namespace {
   value_t get_status(item_t& item) {
@@ -125,7 +125,14 @@ expr_t::ptr_op_t item_t::lookup(const string& name)
     break;
   }
 
-  return session_t::current->current_report->lookup(name);
+  return current_report().lookup(name);
+}
+
+const interned_string_t * item_t::lookup_interned(const string& name)
+{
+  if (name == "note")
+    return &note;
+  return NULL;
 }
 
 bool item_t::valid() const
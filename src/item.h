@@ -33,6 +33,7 @@
 #define _ITEM_H
 
 #include "utils.h"
+#include "intern.h"
 #include "scope.h"
 
 namespace ledger {
@@ -44,28 +45,33 @@ public:
 #define ITEM_IN_CACHE   0x01  // transaction allocated by the binary cache
 #define ITEM_GENERATED  0x02  // transaction was not found in a journal
 #define ITEM_TEMP       0x04  // transaction is a temporary object
+#define ITEM_IN_ARENA   0x08  // transaction allocated by its journal's arena
 
   enum state_t { UNCLEARED = 0, CLEARED, PENDING };
 
+  // The members are ordered so that the small ones pack in beside the
+  // flags.  Source positions are kept as plain offsets rather than as
+  // istream_pos_type, which also carries the stream's conversion state.
+  unsigned short     src_idx;
   state_t	     _state;
 
   optional<date_t>   _date;
   optional<date_t>   _date_eff;
-  optional<string>   note;
+  interned_string_t  note;
 
-  unsigned short     src_idx;
-  istream_pos_type   beg_pos;
-  unsigned long	     beg_line;
-  istream_pos_type   end_pos;
-  unsigned long	     end_line;
+  std::streamoff     beg_pos;
+  std::streamoff     end_pos;
+  unsigned int	     beg_line;
+  unsigned int	     end_line;
 
-  static  bool	     use_effective_date;
+  static THREAD_LOCAL bool use_effective_date;
 
   item_t(flags_t _flags = ITEM_NORMAL, const optional<string>& _note = none)
-    : supports_flags<>(_flags), _state(UNCLEARED), note(_note),
-      beg_pos(0), beg_line(0), end_pos(0), end_line(0)
+    : supports_flags<>(_flags), src_idx(0), _state(UNCLEARED),
+      beg_pos(0), end_pos(0), beg_line(0), end_line(0)
   {
     TRACE_CTOR(item_t, "flags_t, const string&");
+    note = _note;
   }
   item_t(const item_t& item) : supports_flags<>(), scope_t()
   {
@@ -79,6 +85,8 @@ public:
   void copy_details(const item_t& item)
   {
     set_flags(item.flags());
+    // A copy is never in the arena its original came from.
+    drop_flags(ITEM_IN_ARENA);
     set_state(item.state());
 
     _date     = item._date;
@@ -120,6 +128,7 @@ public:
   }
 
   virtual expr_t::ptr_op_t lookup(const string& name);
+  virtual const interned_string_t * lookup_interned(const string& name);
 
   bool valid() const;
 };
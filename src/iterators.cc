@@ -31,7 +31,6 @@
 
 #include "iterators.h"
 #include "session.h"
-#include "compare.h"
 
 namespace ledger {
 
@@ -106,14 +105,51 @@ account_t * basic_accounts_iterator::operator()()
   return account;
 }
 
+namespace {
+  typedef std::pair<value_t, account_t *> account_sort_key_t;
+
+  struct compare_account_sort_keys
+  {
+    bool operator()(const account_sort_key_t& left,
+		    const account_sort_key_t& right) const {
+      return left.first < right.first;
+    }
+  };
+}
+
+void sorted_accounts_iterator::set_sort_order(const string& sort_order)
+{
+  sort_cmp = expr_t(sort_order);
+
+  // Children are held in a map keyed by name, so sorting siblings by their
+  // partial name gives back the order they are already stored in.
+  expr_t::ptr_op_t op(sort_cmp.get_op());
+  sort_by_name = (op && op->kind == expr_t::op_t::IDENT &&
+		  op->as_ident() == "partial_account");
+}
+
 void sorted_accounts_iterator::sort_accounts(account_t& account,
 					     accounts_deque_t& deque)
 {
+  if (sort_by_name) {
+    foreach (accounts_map::value_type& pair, account.accounts)
+      deque.push_back(pair.second);
+    return;
+  }
+
+  // Compute every child's sort key once up front, rather than looking it
+  // up again through the account's xdata for each comparison.
+  std::vector<account_sort_key_t> keys;
+  keys.reserve(account.accounts.size());
+
   foreach (accounts_map::value_type& pair, account.accounts)
-    deque.push_back(pair.second);
+    keys.push_back(account_sort_key_t(sort_cmp.calc(*pair.second),
+				      pair.second));
+
+  std::stable_sort(keys.begin(), keys.end(), compare_account_sort_keys());
 
-  std::stable_sort(deque.begin(), deque.end(),
-		   compare_items<account_t>(sort_cmp));
+  foreach (account_sort_key_t& key, keys)
+    deque.push_back(key.second);
 }
 
 account_t * sorted_accounts_iterator::operator()()
@@ -135,7 +171,6 @@ account_t * sorted_accounts_iterator::operator()()
   if (! account->accounts.empty())
     push_back(*account);
 
-  account->xdata().drop_flags(ACCOUNT_EXT_SORT_CALC);
   return account;
 }
 
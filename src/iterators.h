@@ -167,6 +167,7 @@ public:
 class sorted_accounts_iterator : public accounts_iterator
 {
   expr_t sort_cmp;
+  bool   sort_by_name;
 
   typedef std::deque<account_t *> accounts_deque_t;
 
@@ -177,17 +178,18 @@ class sorted_accounts_iterator : public accounts_iterator
 public:
   sorted_accounts_iterator(const string& sort_order) {
     TRACE_CTOR(sorted_accounts_iterator, "const string&");
-    sort_cmp = expr_t(sort_order);
+    set_sort_order(sort_order);
   }
   sorted_accounts_iterator(account_t& account, const string& sort_order) {
     TRACE_CTOR(sorted_accounts_iterator, "account_t&, const string&");
-    sort_cmp = expr_t(sort_order);
+    set_sort_order(sort_order);
     push_back(account);
   }
   virtual ~sorted_accounts_iterator() throw() {
     TRACE_DTOR(sorted_accounts_iterator);
   }
 
+  void set_sort_order(const string& sort_order);
   void sort_accounts(account_t& account, accounts_deque_t& deque);
 
   void push_back(account_t& account) {
@@ -90,6 +90,13 @@ account_t * journal_t::find_account_re(const string& regexp)
 
 bool journal_t::add_entry(entry_t * entry)
 {
+  PROFILE_SCOPE("journal.add_entry");
+
+  // No memory phase is entered here, since switching phases walks every
+  // object counter and this runs once per entry.  Entries finalized one
+  // at a time as they are read count toward the caller's phase; only
+  // add_entries marks a batch as finalizing.
+
   entry->journal = this;
 
   if (! entry_finalize_hooks.run_hooks(*entry, false) ||
@@ -104,6 +111,156 @@ bool journal_t::add_entry(entry_t * entry)
   return true;
 }
 
+namespace {
+  /**
+   * Balances a contiguous share of a batch of entries.  Each worker
+   * thread binds the session for itself, and keeps any error message
+   * for the merge in journal_t::add_entries to report.
+   */
+  class balance_worker_t
+  {
+    session_t *		     session;
+    std::vector<entry_t *> * batch;
+    std::vector<value_t> *   balances;
+    std::vector<string> *    errors;
+    std::size_t		     begin;
+    std::size_t		     end;
+
+  public:
+    balance_worker_t(session_t *	      _session,
+		     std::vector<entry_t *>& _batch,
+		     std::vector<value_t>&   _balances,
+		     std::vector<string>&    _errors,
+		     std::size_t	      _begin,
+		     std::size_t	      _end)
+      : session(_session), batch(&_batch), balances(&_balances),
+	errors(&_errors), begin(_begin), end(_end) {}
+
+    void operator()() {
+      bool bind = session_t::current != session;
+      if (bind)
+	set_session_context(session);
+
+      for (std::size_t i = begin; i < end; i++) {
+	if (! (*batch)[i] || ! (*errors)[i].empty())
+	  continue;
+	try {
+	  (*batch)[i]->balance_xacts((*balances)[i]);
+	}
+	catch (const std::exception& err) {
+	  (*errors)[i] = err.what();
+	}
+	catch (...) {
+	  (*errors)[i] = "Failed to balance entry";
+	}
+      }
+
+      if (bind)
+	set_session_context();
+    }
+  };
+}
+
+unsigned int journal_t::add_entries(std::vector<entry_t *>& batch,
+				    unsigned int jobs,
+				    const entry_error_handler_t& on_error)
+{
+  PROFILE_SCOPE("journal.add_entries");
+  memory_phase_scope_t phase(PHASE_FINALIZE);
+
+  std::vector<value_t> balances(batch.size());
+  std::vector<string>  errors(batch.size());
+
+  // Automated entries evaluate shared expressions and update the shared
+  // auto_entry_index, so they are applied one entry at a time.
+  for (std::size_t i = 0; i < batch.size(); i++) {
+    entry_t * entry = batch[i];
+    entry->journal = this;
+    try {
+      if (! entry_finalize_hooks.run_hooks(*entry, false)) {
+	checked_delete(entry);
+	batch[i] = NULL;
+      }
+    }
+    catch (const std::exception& err) {
+      errors[i] = err.what();
+    }
+  }
+
+#if ! defined(HAVE_BOOST_THREAD) || defined(VERIFY_ON)
+  // Without threads there is nothing to spread the work over; and in
+  // verify mode every object made is recorded in a shared map.
+  jobs = 1;
+#endif
+
+  // A thread is not worth starting for only a handful of entries.
+  const std::size_t min_share = 64;
+  if (jobs > batch.size() / min_share)
+    jobs = std::max<std::size_t>(batch.size() / min_share, 1);
+
+  {
+#if defined(HAVE_BOOST_THREAD)
+    boost::thread_group workers;
+#endif
+    for (unsigned int job = 1; job < jobs; job++) {
+      balance_worker_t worker(session_t::current, batch, balances, errors,
+			      batch.size() * job / jobs,
+			      batch.size() * (job + 1) / jobs);
+#if defined(HAVE_BOOST_THREAD)
+      workers.create_thread(worker);
+#else
+      worker();
+#endif
+    }
+
+    // The calling thread takes the first share itself.
+    balance_worker_t(session_t::current, batch, balances, errors,
+		     0, batch.size() / jobs)();
+
+#if defined(HAVE_BOOST_THREAD)
+    workers.join_all();
+#endif
+  }
+
+  // Everything else is done in the original order, so that price
+  // history, account totals and the order of the journal's entries come
+  // out exactly as if each entry had been added by add_entry.
+  unsigned int count = 0;
+
+  for (std::size_t i = 0; i < batch.size(); i++) {
+    entry_t * entry = batch[i];
+    if (! entry)
+      continue;
+
+    bool added = false;
+    if (! errors[i].empty()) {
+      on_error(*entry, errors[i]);
+    } else {
+      try {
+	if (entry->settle(balances[i]) &&
+	    entry_finalize_hooks.run_hooks(*entry, true)) {
+	  entries.push_back(entry);
+	  added = true;
+	  count++;
+	}
+      }
+      catch (const std::exception& err) {
+	on_error(*entry, err.what());
+      }
+    }
+
+    if (! added) {
+      entry->journal = NULL;
+      checked_delete(entry);
+    }
+    batch[i] = NULL;
+  }
+
+  batch.clear();
+
+  return count;
+}
+
 bool journal_t::remove_entry(entry_t * entry)
 {
   bool found = false;
@@ -122,6 +279,55 @@ bool journal_t::remove_entry(entry_t * entry)
   return true;
 }
 
+xact_t * journal_t::make_xact()
+{
+  void * slot = xact_arena.allocate();
+  xact_t * xact;
+  try {
+    xact = new (slot) xact_t;
+  }
+  catch (...) {
+    xact_arena.deallocate(slot);
+    throw;
+  }
+  xact->add_flags(ITEM_IN_ARENA);
+  return xact;
+}
+
+void journal_t::discard_xact(xact_t * xact)
+{
+  assert(xact->has_flags(ITEM_IN_ARENA));
+  xact->~xact_t();
+  xact_arena.deallocate(xact);
+}
+
+xact_arena_t::~xact_arena_t() throw()
+{
+  TRACE_DTOR(xact_arena_t);
+
+  foreach (char * chunk, chunks)
+    ::operator delete(chunk);
+}
+
+void * xact_arena_t::allocate()
+{
+  if (! unused.empty()) {
+    void * slot = unused.back();
+    unused.pop_back();
+    return slot;
+  }
+
+  if (used == chunk_size) {
+    // Make room for the chunk first, so that it can't be lost if the
+    // vector fails to grow.
+    chunks.push_back(NULL);
+    chunks.back() =
+      static_cast<char *>(::operator new(chunk_size * sizeof(xact_t)));
+    used = 0;
+  }
+  return chunks.back() + sizeof(xact_t) * used++;
+}
+
 bool journal_t::valid() const
 {
   if (! master->valid()) {
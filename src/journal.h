@@ -43,6 +43,36 @@ typedef std::list<path>	paths_list;
 class session_t;
 class account_t;
 
+/**
+ * @brief Hands out storage for the transactions of a journal's entries.
+ *
+ * Transactions are carved, in the order they are parsed, out of chunks
+ * holding many of them at once.  Walking the transactions of an entry,
+ * or of every entry in turn, then reads memory that lies close together
+ * instead of wherever the heap happened to put each one.  Chunks are only
+ * freed along with the arena, so a transaction taken from it (which
+ * carries ITEM_IN_ARENA) is destructed in place by its entry.
+ */
+class xact_arena_t : public noncopyable
+{
+  std::vector<char *> chunks;
+  std::size_t	      used;	// slots handed out from the last chunk
+  std::vector<void *> unused;	// slots given back by deallocate()
+
+public:
+  enum { chunk_size = 1024 };
+
+  xact_arena_t() : used(chunk_size) {
+    TRACE_CTOR(xact_arena_t, "");
+  }
+  ~xact_arena_t() throw();
+
+  void * allocate();
+  void	 deallocate(void * slot) {
+    unused.push_back(slot);
+  }
+};
+
 class journal_t : public noncopyable
 {
 public:
@@ -54,6 +84,8 @@ public:
 
   auto_entries_list    auto_entries;
   period_entries_list  period_entries;
+  auto_entry_index_t   auto_entry_index;
+  xact_arena_t	       xact_arena;
 
   hooks_t<entry_finalizer_t, entry_t> entry_finalize_hooks;
 
@@ -67,9 +99,20 @@ public:
   account_t * find_account(const string& name, bool auto_create = true);
   account_t * find_account_re(const string& regexp);
 
+  typedef function<void (entry_t& entry, const string& message)>
+    entry_error_handler_t;
+
   bool add_entry(entry_t * entry);
+  unsigned int add_entries(std::vector<entry_t *>& batch, unsigned int jobs,
+			   const entry_error_handler_t& on_error);
   bool remove_entry(entry_t * entry);
 
+  // Transactions for this journal's entries come from its arena.  One
+  // that is abandoned before its entry takes it must be given back with
+  // discard_xact, rather than deleted.
+  xact_t * make_xact();
+  void	   discard_xact(xact_t * xact);
+
   void add_entry_finalizer(entry_finalizer_t * finalizer) {
     entry_finalize_hooks.add_hook(finalizer);
   }
@@ -58,10 +58,12 @@
 
 #include <textual.h>
 #include <cache.h>
+#include <checkpoint.h>
 #include <emacs.h>
 #include <qif.h>
 #include <xml.h>
 #include <csv.h>
+#include <columnar.h>
 #include <gnucash.h>
 #include <ofx.h>
 
@@ -347,8 +347,12 @@ namespace ledger {
 
     INFO_START(command, "Did user command '" << verb << "'");
 
+    ledger::set_memory_phase(ledger::PHASE_REPORT);
+
     command(command_args);
 
+    ledger::set_memory_phase(ledger::PHASE_TEARDOWN);
+
     INFO_FINISH(command);
 
 #if 0
@@ -396,6 +400,12 @@ int main(int argc, char * argv[], char * envp[])
 	ledger::verify_enabled = true;
 #endif
       }
+      else if (std::strcmp(argv[i], "--profile") == 0) {
+	ledger::profiling_enabled = true;
+      }
+      else if (std::strcmp(argv[i], "--memory-stats") == 0) {
+	ledger::memory_stats_enabled = true;
+      }
       else if (std::strcmp(argv[i], "--verbose") == 0 ||
 	       std::strcmp(argv[i], "-v") == 0) {
 #if defined(LOGGING_ON)
@@ -469,6 +479,17 @@ int main(int argc, char * argv[], char * envp[])
     status = _status;
   }
 
+  if (ledger::profiling_enabled) {
+    std::cout.flush();
+    ledger::report_profile(std::cerr);
+  }
+  ledger::shutdown_profiling();
+
+  if (ledger::memory_stats_enabled) {
+    std::cout.flush();
+    ledger::report_memory_stats(std::cerr);
+  }
+
   IF_VERIFY() {
     INFO("Ledger ended (Boost/libstdc++ may still hold memory)");
     ledger::set_session_context();
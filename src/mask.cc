@@ -34,7 +34,7 @@
 
 namespace ledger {
 
-mask_t::mask_t(const string& pat) : expr()
+mask_t::mask_t(const string& pat) : matches_table(0), expr()
 {
   TRACE_CTOR(mask_t, "const string&");
   *this = pat;
@@ -43,9 +43,28 @@ mask_t::mask_t(const string& pat) : expr()
 mask_t& mask_t::operator=(const string& pat)
 {
   expr.assign(pat.c_str(), regex::perl | regex::icase);
+  matches.clear();
   return *this;
 }
 
+bool mask_t::match(const interned_string_t& str) const
+{
+  if (! str.id())
+    return match(empty_string);
+
+  // Table serials start at one, so a new mask always begins afresh.
+  unsigned long table = interned_string_t::current_table()->serial();
+  if (table != matches_table || matches.size() >= max_matches) {
+    matches.clear();
+    matches_table = table;
+  }
+
+  matches_map::iterator i = matches.find(str.id());
+  if (i == matches.end())
+    i = matches.insert(matches_map::value_type(str.id(), match(*str))).first;
+  return (*i).second;
+}
+
 void mask_t::read(const char *& data)
 {
   *this = binary::read_string(data);
@@ -33,20 +33,33 @@
 #define _MASK_H
 
 #include "utils.h"
+#include "intern.h"
 
 namespace ledger {
 
 class mask_t
 {
+  // Results of matching interned strings, keyed by their ids.  An id is
+  // only unique while its table lives, so the results are kept only for
+  // the table they were found in (see string_table_t::serial), and are
+  // dropped whenever there are more than max_matches of them.
+  typedef std::map<const string *, bool> matches_map;
+
+  enum { max_matches = 4096 };
+
+  mutable matches_map	matches;
+  mutable unsigned long matches_table;
+
 public:
   boost::regex expr;
 
   explicit mask_t(const string& pattern);
 
-  mask_t() : expr() {
+  mask_t() : matches_table(0), expr() {
     TRACE_CTOR(mask_t, "");
   }
-  mask_t(const mask_t& m) : expr(m.expr) {
+  mask_t(const mask_t& m)
+    : matches(m.matches), matches_table(m.matches_table), expr(m.expr) {
     TRACE_CTOR(mask_t, "copy");
   }
   ~mask_t() throw() {
@@ -58,6 +71,7 @@ public:
   bool match(const string& str) const {
     return boost::regex_search(str, expr);
   }
+  bool match(const interned_string_t& str) const;
 
   void read(const char *& data);
   void write(std::ostream& out) const;
@@ -41,8 +41,10 @@ expr_t::ptr_op_t expr_t::op_t::compile(scope_t& scope)
   case IDENT:
     if (ptr_op_t def = scope.lookup(as_ident())) {
       // Definitions are compiled at the point of definition, not the
-      // point of use.
-      return copy(def);
+      // point of use.  The name is kept, for printing and for O_MATCH.
+      ptr_op_t ident(copy(def));
+      ident->set_ident(as_ident());
+      return ident;
     }
     return this;
 
@@ -106,6 +108,10 @@ value_t expr_t::op_t::calc(scope_t& scope)
 
   case O_MATCH:
     assert(right()->is_mask());
+    if (left()->is_ident())
+      if (const interned_string_t * str =
+	  scope.lookup_interned(left()->as_ident()))
+	return right()->as_mask().match(*str);
     return right()->as_mask().match(left()->calc(scope).to_string());
 
   case INDEX: {
@@ -37,18 +37,35 @@ namespace ledger {
 
 #define MAX_LINE 1024
 
-static char         line[MAX_LINE + 1];
-static path         pathname;
-static unsigned int src_idx;
-static unsigned int linenum;
-
-static inline char * get_line(std::istream& in) {
-  in.getline(line, MAX_LINE);
-  int len = std::strlen(line);
-  if (line[len - 1] == '\r')
-    line[len - 1] = '\0';
-  linenum++;
-  return line;
+namespace {
+  /**
+   * The state of one qif_parser_t::parse call.  It is kept on the stack
+   * rather than in statics, so that several journals may be parsed at
+   * once on different threads.
+   */
+  struct qif_context_t : public noncopyable
+  {
+    char	 line[MAX_LINE + 1];
+    unsigned int src_idx;
+    unsigned int linenum;
+
+    qif_context_t() : src_idx(0), linenum(0) {
+      TRACE_CTOR(qif_context_t, "");
+      line[0] = '\0';
+    }
+    ~qif_context_t() throw() {
+      TRACE_DTOR(qif_context_t);
+    }
+
+    char * get_line(std::istream& in) {
+      in.getline(line, MAX_LINE);
+      int len = std::strlen(line);
+      if (len > 0 && line[len - 1] == '\r')
+	line[len - 1] = '\0';
+      linenum++;
+      return line;
+    }
+  };
 }
 
 bool qif_parser_t::test(std::istream& in) const
@@ -85,9 +102,11 @@ unsigned int qif_parser_t::parse(std::istream& in,
   xact = new xact_t(master);
   entry->add_xact(xact);
 
-  pathname = journal.sources.back();
-  src_idx  = journal.sources.size() - 1;
-  linenum  = 1;
+  qif_context_t context;
+  char *	line = context.line;
+
+  context.src_idx = journal.sources.size() - 1;
+  context.linenum = 1;
 
   istream_pos_type beg_pos  = 0;
   unsigned long    beg_line = 0;
@@ -95,7 +114,7 @@ unsigned int qif_parser_t::parse(std::istream& in,
 #define SET_BEG_POS_AND_LINE()			\
   if (! beg_line) {				\
     beg_pos  = in.tellg();			\
-    beg_line = linenum;				\
+    beg_line = context.linenum;			\
   }
 
   while (in.good() && ! in.eof()) {
@@ -105,18 +124,18 @@ unsigned int qif_parser_t::parse(std::istream& in,
     case ' ':
     case '\t':
       if (peek_next_nonws(in) != '\n') {
-	get_line(in);
+	context.get_line(in);
 	throw parse_error("Line begins with whitespace");
       }
       // fall through...
 
     case '\n':
-      linenum++;
+      context.linenum++;
     case '\r':                  // skip blank lines
       break;
 
     case '!':
-      get_line(in);
+      context.get_line(in);
 
       if (std::strcmp(line, "Type:Invst") == 0 ||
 	  std::strcmp(line, "Account") == 0 ||
@@ -128,7 +147,7 @@ unsigned int qif_parser_t::parse(std::istream& in,
 
     case 'D':
       SET_BEG_POS_AND_LINE();
-      get_line(in);
+      context.get_line(in);
       // jww (2008-08-01): Is this just a date?
       entry->_date = parse_date(line);
       break;
@@ -136,7 +155,7 @@ unsigned int qif_parser_t::parse(std::istream& in,
     case 'T':
     case '$': {
       SET_BEG_POS_AND_LINE();
-      get_line(in);
+      context.get_line(in);
       xact->amount.parse(line);
 
       unsigned char flags = xact->amount.commodity().flags();
@@ -172,7 +191,7 @@ unsigned int qif_parser_t::parse(std::istream& in,
 
     case 'N':
       SET_BEG_POS_AND_LINE();
-      get_line(in);
+      context.get_line(in);
       entry->code = line;
       break;
 
@@ -182,7 +201,7 @@ unsigned int qif_parser_t::parse(std::istream& in,
     case 'S':
     case 'E': {
       SET_BEG_POS_AND_LINE();
-      get_line(in);
+      context.get_line(in);
 
       switch (c) {
       case 'P':
@@ -215,7 +234,7 @@ unsigned int qif_parser_t::parse(std::istream& in,
     case 'A':
       SET_BEG_POS_AND_LINE();
       // jww (2004-08-19): these are ignored right now
-      get_line(in);
+      context.get_line(in);
       break;
 
     case '^': {
@@ -243,11 +262,11 @@ unsigned int qif_parser_t::parse(std::istream& in,
       }
 
       if (journal.add_entry(entry.get())) {
-	entry->src_idx  = src_idx;
+	entry->src_idx  = context.src_idx;
 	entry->beg_pos  = beg_pos;
 	entry->beg_line = beg_line;
 	entry->end_pos  = in.tellg();
-	entry->end_line = linenum;
+	entry->end_line = context.linenum;
 	entry.release();
 	count++;
       }
@@ -265,7 +284,7 @@ unsigned int qif_parser_t::parse(std::istream& in,
     }
 
     default:
-      get_line(in);
+      context.get_line(in);
       break;
     }
   }
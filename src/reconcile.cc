@@ -33,31 +33,191 @@
 
 namespace ledger {
 
-#define xact_next(x)     reinterpret_cast<xact_t *>(x->xdata().ptr)
-#define xact_next_ptr(x) reinterpret_cast<xact_t **>(&x->xdata().ptr)
+namespace {
+  // The search works on whole multiples of the smallest unit used by any
+  // of the amounts involved, so that its inner loop never has to touch
+  // amount_t.  Each candidate sum remembers the value which produced it
+  // and the sum it was produced from, which lets the matching subset be
+  // read back once the target has been reached.
 
-static bool search_for_balance(amount_t& amount,
-			       xact_t ** prev, xact_t * next)
-{
-  for (; next; next = xact_next(next)) {
-    xact_t * temp = *prev;
-    *prev = next;
+  class balance_search
+  {
+    struct node_t
+    {
+      long	  sum;
+      std::size_t value;
+      std::size_t parent;
+
+      node_t(long _sum, std::size_t _value, std::size_t _parent)
+	: sum(_sum), value(_value), parent(_parent) {}
+    };
+
+    typedef std::map<long, std::size_t> frontier_map;
+
+    const std::vector<long>& values;
+    const long		     target;
+
+    std::vector<node_t> nodes;
+    std::size_t		closest;
+    std::vector<bool>	best;
+    long		best_sum;
+
+    void settle(const std::vector<std::pair<long, std::size_t> >& order,
+		std::size_t next);
+
+  public:
+    // The number of candidate sums the search may create before it gives
+    // up and settles for the closest one found so far.
+    static const std::size_t max_nodes = 1 << 19;
+
+    bool exhausted;
+
+    balance_search(const std::vector<long>& _values, const long _target)
+      : values(_values), target(_target), closest(0),
+	best(_values.size(), false), best_sum(0), exhausted(false) {
+      TRACE_CTOR(balance_search, "const std::vector<long>&, const long");
+    }
+    ~balance_search() throw() {
+      TRACE_DTOR(balance_search);
+    }
+
+    bool search();
+
+    long distance() const {
+      return target - best_sum;
+    }
+    const std::vector<bool>& matched() const {
+      return best;
+    }
+  };
+
+  // Read back the subset belonging to the closest sum found, and if the
+  // search was cut short, greedily extend it with those values it never
+  // got to, so that the partial match reported is as near as possible.
+  void balance_search::settle
+    (const std::vector<std::pair<long, std::size_t> >& order,
+     std::size_t next)
+  {
+    best.assign(values.size(), false);
+    for (std::size_t i = closest; i != 0; i = nodes[i].parent)
+      best[nodes[i].value] = true;
+    best_sum = nodes[closest].sum;
+
+    for (; next < order.size(); next++) {
+      std::size_t index = order[next].second;
+      if (! best[index] &&
+	  std::labs(target - (best_sum + values[index])) <
+	  std::labs(target - best_sum)) {
+	best[index] = true;
+	best_sum += values[index];
+      }
+    }
+  }
+
+  bool balance_search::search()
+  {
+    // Larger magnitudes are tried first, since they are the ones which
+    // let the most candidates be pruned early on.
+
+    std::vector<std::pair<long, std::size_t> > order;
+    for (std::size_t i = 0; i < values.size(); i++)
+      order.push_back(std::pair<long, std::size_t>
+		      (- std::labs(values[i]), i));
+    std::stable_sort(order.begin(), order.end());
+
+    // above[k] and below[k] are the most and least that the values from
+    // position k onward can still add to a sum.
+
+    std::vector<long> above(order.size() + 1, 0);
+    std::vector<long> below(order.size() + 1, 0);
+    for (std::size_t k = order.size(); k > 0; k--) {
+      long value = values[order[k - 1].second];
+      above[k - 1] = above[k] + (value > 0 ? value : 0);
+      below[k - 1] = below[k] + (value < 0 ? value : 0);
+    }
+
+    nodes.clear();
+    nodes.push_back(node_t(0, values.size(), 0));
+    closest = 0;
+
+    if (target == 0 || target > above[0] || target < below[0]) {
+      settle(order, 0);
+      return target == 0;
+    }
+
+    frontier_map frontier;
+    frontier.insert(frontier_map::value_type(0, 0));
+
+    std::vector<std::pair<long, std::size_t> > fresh;
+
+    for (std::size_t k = 0; k < order.size(); k++) {
+      const long value = values[order[k].second];
 
-    amount -= next->amount;
-    if (! amount ||
-	search_for_balance(amount, xact_next_ptr(next), xact_next(next)))
-      return true;
-    amount += next->amount;
+      fresh.clear();
+      foreach (const frontier_map::value_type& pair, frontier) {
+	long sum = pair.first + value;
+	long remaining = target - sum;
+	if (remaining > above[k + 1] || remaining < below[k + 1] ||
+	    frontier.find(sum) != frontier.end())
+	  continue;
+	fresh.push_back(std::pair<long, std::size_t>(sum, pair.second));
+      }
+
+      for (std::size_t i = 0; i < fresh.size(); i++) {
+	if (nodes.size() >= max_nodes) {
+	  exhausted = true;
+	  settle(order, k);
+	  return false;
+	}
+
+	nodes.push_back(node_t(fresh[i].first, order[k].second,
+			       fresh[i].second));
+	frontier.insert(frontier_map::value_type(fresh[i].first,
+						 nodes.size() - 1));
+
+	if (std::labs(target - fresh[i].first) <
+	    std::labs(target - nodes[closest].sum))
+	  closest = nodes.size() - 1;
+
+	if (fresh[i].first == target) {
+	  settle(order, order.size());
+	  return true;
+	}
+      }
+
+      // Forget every sum which the remaining values can no longer carry
+      // to the target.
+      for (frontier_map::iterator i = frontier.begin();
+	   i != frontier.end(); ) {
+	long remaining = target - (*i).first;
+	if (remaining > above[k + 1] || remaining < below[k + 1])
+	  frontier.erase(i++);
+	else
+	  i++;
+      }
 
-    *prev = temp;
+      DEBUG("ledger.reconcile", "after " << k + 1 << " of " << order.size()
+	    << " values, " << frontier.size() << " sums remain");
+    }
+
+    settle(order, order.size());
+    return false;
+  }
+
+  long to_units(const amount_t& amt, const amount_t& scale)
+  {
+    amount_t units(amt.number() * scale);
+    if (! units.fits_in_long())
+      throw_(std::runtime_error,
+	     "Amount is too large to reconcile: " << amt);
+    return units.to_long();
   }
-  return false;
 }
 
-void reconcile_xacts::push_to_handler(xact_t * first)
+void reconcile_xacts::push_to_handler(const std::vector<xact_t *>& matched)
 {
-  for (; first; first = xact_next(first))
-    item_handler<xact_t>::operator()(*first);
+  foreach (xact_t * xact, matched)
+    item_handler<xact_t>::operator()(*xact);
 
   item_handler<xact_t>::flush();
 }
@@ -67,20 +227,18 @@ void reconcile_xacts::flush()
   value_t cleared_balance;
   value_t pending_balance;
 
-  xact_t *  first    = NULL;
-  xact_t ** last_ptr = &first;
+  std::vector<xact_t *> pending;
 
   foreach (xact_t * xact, xacts) {
     if (! is_valid(cutoff) || xact->date() < cutoff) {
       switch (xact->state()) {
       case item_t::CLEARED:
-	cleared_balance += xact->amount;
+	add_or_set_value(cleared_balance, xact->amount);
 	break;
       case item_t::UNCLEARED:
       case item_t::PENDING:
-	pending_balance += xact->amount;
-	*last_ptr = xact;
-	last_ptr = xact_next_ptr(xact);
+	add_or_set_value(pending_balance, xact->amount);
+	pending.push_back(xact);
 	break;
       }
     }
@@ -89,28 +247,104 @@ void reconcile_xacts::flush()
   if (cleared_balance.type() >= value_t::BALANCE)
     throw std::runtime_error("Cannot reconcile accounts with multiple commodities");
 
-  cleared_balance.cast(value_t::AMOUNT);
-  balance.cast(value_t::AMOUNT);
+  balance.in_place_cast(value_t::AMOUNT);
 
-  commodity_t& cb_comm = cleared_balance.as_amount().commodity();
-  commodity_t& b_comm  = balance.as_amount().commodity();
+  if (! cleared_balance.is_null()) {
+    cleared_balance.in_place_cast(value_t::AMOUNT);
 
-  balance -= cleared_balance;
-  if (balance.type() >= value_t::BALANCE)
-    throw_(std::runtime_error,
-	   "Reconcile balance is not of the same commodity ('"
-	   << b_comm.symbol() << "' != '" << cb_comm.symbol() << "')");
+    commodity_t& cb_comm = cleared_balance.as_amount().commodity();
+    commodity_t& b_comm  = balance.as_amount().commodity();
+
+    balance -= cleared_balance;
+    if (balance.type() >= value_t::BALANCE)
+      throw_(std::runtime_error,
+	     "Reconcile balance is not of the same commodity ('"
+	     << b_comm.symbol() << "' != '" << cb_comm.symbol() << "')");
+    balance.in_place_cast(value_t::AMOUNT);
+  }
 
   // If the amount to reconcile is the same as the pending balance,
   // then assume an exact match and return the results right away.
   amount_t& to_reconcile(balance.as_amount_lval());
-  pending_balance.cast(value_t::AMOUNT);
-  if (to_reconcile == pending_balance.as_amount() ||
-      search_for_balance(to_reconcile, &first, first)) {
-    push_to_handler(first);
-  } else {
-    throw std::runtime_error("Could not reconcile account!");
+  if (pending_balance.is_null()) {
+    if (! to_reconcile)
+      push_to_handler(pending);
+    else
+      throw std::runtime_error("Could not reconcile account!");
+    return;
+  }
+  if (pending_balance.type() >= value_t::BALANCE)
+    throw std::runtime_error("Cannot reconcile accounts with multiple commodities");
+  pending_balance.in_place_cast(value_t::AMOUNT);
+  if (to_reconcile == pending_balance.as_amount()) {
+    push_to_handler(pending);
+    return;
   }
+
+  // Otherwise, scale every amount to the finest precision among them,
+  // and look for the subset of pending xacts which sums to the amount
+  // still to be reconciled.  If that amount is nearer the pending total
+  // than to zero, it is cheaper to search for the xacts to leave out.
+
+  amount_t::precision_t precision = to_reconcile.precision();
+  foreach (xact_t * xact, pending)
+    if (xact->amount.precision() > precision)
+      precision = xact->amount.precision();
+
+  amount_t scale(1L);
+  for (amount_t::precision_t i = 0; i < precision; i++)
+    scale *= 10L;
+
+  std::vector<long> values;
+  foreach (xact_t * xact, pending)
+    values.push_back(to_units(xact->amount, scale));
+
+  long target = to_units(to_reconcile, scale);
+
+  // The search freely adds the values together and subtracts partial
+  // sums from the target, so all of them at once must leave room in a
+  // long to spare.
+  const long limit     = std::numeric_limits<long>::max() / 2;
+  long	     magnitude = 0;
+  values.push_back(target);
+  foreach (long value, values) {
+    if (value > limit - magnitude || value < magnitude - limit)
+      throw_(std::runtime_error,
+	     "Amounts are too large to reconcile together");
+    magnitude += std::labs(value);
+  }
+  values.pop_back();
+
+  long total = to_units(pending_balance.as_amount(), scale);
+
+  bool complement = std::labs(total - target) < std::labs(target);
+
+  balance_search finder(values, complement ? total - target : target);
+  if (! finder.search()) {
+    amount_t off(complement ? - finder.distance() : finder.distance());
+    off /= scale;
+    if (to_reconcile.has_commodity())
+      off.set_commodity(to_reconcile.commodity());
+
+    if (finder.exhausted)
+      throw_(std::runtime_error,
+	     "Could not reconcile account! Gave up after "
+	     << balance_search::max_nodes
+	     << " candidate sums; the closest match was off by " << off);
+    else
+      throw_(std::runtime_error,
+	     "Could not reconcile account! The closest match was off by "
+	     << off);
+  }
+
+  const std::vector<bool>& chosen(finder.matched());
+
+  std::vector<xact_t *> matched;
+  for (std::size_t i = 0; i < pending.size(); i++)
+    if (chosen[i] != complement)
+      matched.push_back(pending[i]);
+
+  push_to_handler(matched);
 }
 
 } // namespace ledger
@@ -59,7 +59,7 @@ public:
     TRACE_DTOR(reconcile_xacts);
   }
 
-  void push_to_handler(xact_t * first);
+  void push_to_handler(const std::vector<xact_t *>& matched);
 
   virtual void flush();
   virtual void operator()(xact_t& xact) {
@@ -32,6 +32,9 @@
 #include "report.h"
 #include "output.h"
 #include "reconcile.h"
+#include "checkpoint.h"
+#include "csv.h"
+#include "columnar.h"
 
 namespace ledger {
 
@@ -215,33 +218,50 @@ report_t::chain_xact_handlers(xact_handler_ptr base_handler,
 
 void report_t::xacts_report(xact_handler_ptr handler)
 {
+  PROFILE_SCOPE("report.xacts_report");
+
   session_xacts_iterator walker(session);
   pass_down_xacts(chain_xact_handlers(handler), walker);
 
-  if (DO_VERIFY())
-    session.clean_xacts();
+  session.clean_xacts();
 }
 
 void report_t::entry_report(xact_handler_ptr handler, entry_t& entry)
 {
+  PROFILE_SCOPE("report.entry_report");
+
   entry_xacts_iterator walker(entry);
   pass_down_xacts(chain_xact_handlers(handler), walker);
 
-  if (DO_VERIFY())
-    session.clean_xacts(entry);
+  session.clean_xacts();
 }
 
 void report_t::sum_all_accounts()
 {
-  session_xacts_iterator walker(session);
-  pass_down_xacts
-    (chain_xact_handlers(xact_handler_ptr(new set_account_value), false),
-     walker);
+  PROFILE_SCOPE("report.sum_all_accounts");
+
+  xact_handler_ptr handler
+    (chain_xact_handlers(xact_handler_ptr(new set_account_value), false));
+
+  // If the only restriction on the report is a date range, most of the
+  // work can be skipped by adding up the session's monthly checkpoints.
+  balance_checkpoints_t * checkpoints =
+    (predicate == date_predicate && ! show_inverted && ! show_related) ?
+    session.balance_checkpoints() : NULL;
+
+  if (! checkpoints ||
+      ! checkpoints->sum_accounts(handler, begin_date, end_date)) {
+    session_xacts_iterator walker(session);
+    pass_down_xacts(handler, walker);
+  }
+
   session.master->calculate_sums();
 }
 
 void report_t::accounts_report(acct_handler_ptr handler)
 {
+  PROFILE_SCOPE("report.accounts_report");
+
   sum_all_accounts();
 
   if (sort_string.empty()) {
@@ -252,10 +272,8 @@ void report_t::accounts_report(acct_handler_ptr handler)
     pass_down_accounts(handler, walker, expr_t("total"));
   }
     
-  if (DO_VERIFY()) {
-    session.clean_xacts();
-    session.clean_accounts();
-  }
+  session.clean_xacts();
+  session.clean_accounts();
 }
 
 void report_t::commodities_report(const string& format)
@@ -435,7 +453,6 @@ expr_t::ptr_op_t report_t::lookup(const string& name)
       // output
       // prices
       // pricesdb
-      // csv
       // emacs | lisp
       // xml
 #endif
@@ -450,7 +467,16 @@ expr_t::ptr_op_t report_t::lookup(const string& name)
 	    (reporter<account_t, acct_handler_ptr, &report_t::accounts_report>
 	     (new format_accounts(*this, FORMAT(balance_format))));
 
+      case 'c':
+	if (std::strcmp(p, "csv") == 0)
+	  return WRAP_FUNCTOR
+	    (reporter<>(new format_csv_xacts(*output_stream, csv_columns)));
+	break;
+
       case 'e':
+	if (std::strcmp(p, "export") == 0)
+	  return WRAP_FUNCTOR
+	    (reporter<>(new format_columnar_xacts(*output_stream)));
 	if (std::strcmp(p, "equity") == 0)
 	  return expr_t::op_t::wrap_functor
 	    (reporter<account_t, acct_handler_ptr, &report_t::accounts_report>
@@ -470,6 +496,13 @@ expr_t::ptr_op_t report_t::lookup(const string& name)
 	  return WRAP_FUNCTOR
 	    (reporter<>(new format_xacts(*this, FORMAT(register_format))));
 	break;
+
+      case 't':
+	if (std::strcmp(p, "tsv") == 0)
+	  return WRAP_FUNCTOR
+	    (reporter<>(new format_csv_xacts(*output_stream, csv_columns,
+					     '\t')));
+	break;
       }
     }
     break;
@@ -502,6 +535,8 @@ expr_t::ptr_op_t report_t::lookup(const string& name)
 	  return MAKE_FUNCTOR(report_t::option_comm_as_payee);
 	else if (std::strcmp(p, "code-as-payee") == 0)
 	  return MAKE_FUNCTOR(report_t::option_code_as_payee);
+	else if (std::strcmp(p, "csv_columns_") == 0)
+	  return MAKE_FUNCTOR(report_t::option_csv_columns_);
 	break;
 
       case 'd':
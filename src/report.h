@@ -90,6 +90,7 @@ public:
   std::ostream * output_stream;
 
   string	 format_string;
+  string	 csv_columns;
   string	 date_output_format;
   string	 predicate;
   string	 secondary_predicate;
@@ -102,6 +103,13 @@ public:
   string	 reconcile_balance;
   string	 reconcile_date;
 
+  // The bounds given by --begin, --end and --period.  When these are the
+  // only terms in `predicate', account totals may be computed from the
+  // session's balance checkpoints.
+  optional<date_t> begin_date;
+  optional<date_t> end_date;
+  string	 date_predicate;
+
   expr_t	 amount_expr;
   expr_t	 total_expr;
 
@@ -187,6 +195,28 @@ public:
   chain_xact_handlers(xact_handler_ptr handler,
 		      const bool handle_individual_transactions = true);
 
+  void limit_by_date(const date_t& when, const bool is_begin) {
+    string term(is_begin ? "date>=[" : "date<[");
+    term += to_iso_extended_string(when);
+    term += "]";
+
+    if (! predicate.empty())
+      predicate += "&";
+    predicate += term;
+
+    if (! date_predicate.empty())
+      date_predicate += "&";
+    date_predicate += term;
+
+    if (is_begin) {
+      if (! begin_date || when > *begin_date)
+	begin_date = when;
+    } else {
+      if (! end_date || when < *end_date)
+	end_date = when;
+    }
+  }
+
 #if 0
   //////////////////////////////////////////////////////////////////////
   //
@@ -266,12 +296,7 @@ public:
 	     "Could not determine beginning of period '"
 	     << args[0].to_string() << "'");
 
-    if (! predicate.empty())
-      predicate += "&";
-    predicate += "date>=[";
-    predicate += to_iso_extended_string(interval.begin);
-    predicate += "]";
-
+    limit_by_date(interval.begin, true);
     return true;
   }
 
@@ -282,11 +307,7 @@ public:
 	     "Could not determine end of period '"
 	     << args[0].to_string() << "'");
 
-    if (! predicate.empty())
-      predicate += "&";
-    predicate += "date<[";
-    predicate += to_iso_extended_string(interval.begin);
-    predicate += "]";
+    limit_by_date(interval.begin, false);
 
 #if 0
     terminus = interval.begin;
@@ -356,6 +377,11 @@ public:
     return true;
   }
 
+  value_t option_csv_columns_(call_scope_t& args) { // :
+    csv_columns = args[0].as_string();
+    return true;
+  }
+
   value_t option_date_format_(call_scope_t& args) { // y:
     ledger::output_date_format = args[0].as_string();
     return true;
@@ -526,20 +552,11 @@ public:
 
     interval_t interval(report_period);
 
-    if (is_valid(interval.begin)) {
-      if (! predicate.empty())
-	predicate += "&";
-      predicate += "date>=[";
-      predicate += to_iso_extended_string(interval.begin);
-      predicate += "]";
-    }
+    if (is_valid(interval.begin))
+      limit_by_date(interval.begin, true);
 
     if (is_valid(interval.end)) {
-      if (! predicate.empty())
-	predicate += "&";
-      predicate += "date<[";
-      predicate += to_iso_extended_string(interval.end);
-      predicate += "]";
+      limit_by_date(interval.end, false);
 
 #if 0
       terminus = interval.end;
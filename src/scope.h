@@ -49,6 +49,14 @@ public:
 
   virtual expr_t::ptr_op_t lookup(const string& name) = 0;
 
+  // If NAME stands for an interned string in this scope, such as the
+  // payee of an entry, return it.  Regular expressions match such
+  // strings by id, so that a payee shared by many entries is matched
+  // only once.
+  virtual const interned_string_t * lookup_interned(const string&) {
+    return NULL;
+  }
+
   value_t resolve(const string& name) {
     expr_t::ptr_op_t definition = lookup(name);
     if (definition)
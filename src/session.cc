@@ -34,39 +34,65 @@
 #include "handler.h"
 #include "iterators.h"
 #include "filters.h"
+#include "checkpoint.h"
 
 namespace ledger {
 
-session_t * session_t::current = NULL;
+THREAD_LOCAL session_t * session_t::current = NULL;
 
-#if 0
-boost::mutex session_t::session_mutex;
-#endif
+namespace {
+  THREAD_LOCAL report_t * bound_report = NULL;
+}
 
 void set_session_context(session_t * session)
 {
-#if 0
-  session_t::session_mutex.lock();
-#endif
-
   if (session && ! session_t::current) {
     session_t::initialize();
   }
   else if (! session && session_t::current) {
     session_t::shutdown();
-#if 0
-    session_t::session_mutex.unlock();
-#endif
   }
 
   session_t::current = session;
+
+  if (session) {
+    amount_t::current_pool = session->commodity_pool.get();
+    interned_string_t::table = &session->strings;
+    set_report_context();
+
+    if (! amount_t::current_pool) {
+      session->commodity_pool.reset(new commodity_pool_t);
+      amount_t::current_pool = session->commodity_pool.get();
+      amount_t::add_builtin_commodities();
+    }
+  } else {
+    amount_t::current_pool = NULL;
+    interned_string_t::table = NULL;
+    xact_t::xdata_pool	   = NULL;
+    account_t::xdata_pool  = NULL;
+    bound_report	   = NULL;
+  }
 }
 
-void release_session_context()
+void set_report_context(report_t * report, report_xdata_t * xdata)
 {
-#if 0
-  session_t::session_mutex.unlock();
-#endif
+  assert(session_t::current);
+
+  bound_report = report;
+
+  if (! xdata)
+    xdata = &session_t::current->xdata;
+  xact_t::xdata_pool	= &xdata->xacts;
+  account_t::xdata_pool = &xdata->accounts;
+}
+
+report_t& current_report()
+{
+  if (bound_report)
+    return *bound_report;
+
+  assert(session_t::current && session_t::current->current_report);
+  return *session_t::current->current_report;
 }
 
 session_t::session_t()
@@ -103,6 +129,8 @@ session_t::session_t()
     use_cache(true),
     cache_dirty(false),
 
+    finalize_jobs(1),
+
     now(now),
 
 #if 0
@@ -113,7 +141,9 @@ session_t::session_t()
     ansi_codes(false),
     ansi_invert(false),
 
-    master(new account_t(NULL, ""))
+    master(new account_t(NULL, "")),
+
+    frozen(false)
 {
   TRACE_CTOR(session_t, "");
 }
@@ -175,6 +205,9 @@ std::size_t session_t::read_data(journal_t&    journal,
   if (data_file.empty())
     throw_(parse_error, "No journal file was specified (please use -f)");
 
+  PROFILE_SCOPE("session.read_data");
+  memory_phase_scope_t phase(PHASE_PARSE);
+
   TRACE_START(parser, 1, "Parsing journal file");
 
   std::size_t entry_count = 0;
@@ -233,6 +266,18 @@ std::size_t session_t::read_data(journal_t&    journal,
   return entry_count;
 }
 
+balance_checkpoints_t * session_t::balance_checkpoints()
+{
+  // The checkpoints are only kept in the file named by --checkpoints,
+  // and not at all when the journal is read from standard input.  They
+  // are read and extended lazily, so a frozen session goes without them.
+  if (frozen)
+    return NULL;
+  if (! checkpoints && checkpoint_file && data_file != "-")
+    checkpoints.reset(new balance_checkpoints_t(*this, *checkpoint_file));
+  return checkpoints.get();
+}
+
 namespace {
   account_t * find_account_re_(account_t * account, const mask_t& regexp)
   {
@@ -254,9 +299,7 @@ account_t * session_t::find_account_re(const string& regexp)
 
 void session_t::clean_xacts()
 {
-  session_xacts_iterator walker(*this);
-  pass_down_xacts
-    (xact_handler_ptr(new clear_xact_xdata), walker);
+  xact_t::xdata_pool->reset();
 }
 
 void session_t::clean_xacts(entry_t& entry)
@@ -267,9 +310,57 @@ void session_t::clean_xacts(entry_t& entry)
 
 void session_t::clean_accounts()
 {
-  basic_accounts_iterator acct_walker(*master);
-  pass_down_accounts(acct_handler_ptr(new clear_account_xdata),
-		     acct_walker);
+  account_t::xdata_pool->reset();
+}
+
+namespace {
+  void mark_shared(xact_t& xact)
+  {
+    xact.amount.mark_shared();
+    if (xact.cost)
+      xact.cost->mark_shared();
+  }
+
+  void freeze_accounts(account_t& account, unsigned int& next_id)
+  {
+    xdata_pool_t<account_t::xdata_t>::freeze(account.xdata_, next_id++);
+    account.fullname();		// cached in account._fullname
+
+    foreach (accounts_map::value_type& pair, account.accounts)
+      freeze_accounts(*pair.second, next_id);
+  }
+}
+
+void session_t::freeze()
+{
+  if (frozen)
+    return;
+
+  assert(session_t::current == this);
+
+  unsigned int next_id = 0;
+  foreach (journal_t& journal, journals) {
+    foreach (entry_t * entry, journal.entries)
+      foreach (xact_t * xact, entry->xacts) {
+	xdata_pool_t<xact_t::xdata_t>::freeze(xact->xdata_, next_id++);
+	mark_shared(*xact);
+      }
+
+    // Automated and periodic entries are only ever copied from.
+    foreach (auto_entry_t * entry, journal.auto_entries)
+      foreach (xact_t * xact, entry->xacts)
+	mark_shared(*xact);
+    foreach (period_entry_t * entry, journal.period_entries)
+      foreach (xact_t * xact, entry->xacts)
+	mark_shared(*xact);
+  }
+
+  next_id = 0;
+  freeze_accounts(*master, next_id);
+
+  commodity_pool->freeze();
+
+  frozen = true;
 }
 
 #if 0
@@ -349,6 +440,11 @@ expr_t::ptr_op_t session_t::lookup(const string& name)
     if (std::strncmp(p, "opt_", 4) == 0) {
       p = p + 4;
       switch (*p) {
+      case 'c':
+	if (std::strcmp(p, "checkpoints_") == 0)
+	  return MAKE_FUNCTOR(session_t::option_checkpoints_);
+	break;
+
       case 'd':
 	if (std::strcmp(p, "debug_") == 0)
 	  return MAKE_FUNCTOR(session_t::option_debug_);
@@ -358,6 +454,18 @@ expr_t::ptr_op_t session_t::lookup(const string& name)
 	if ((*(p + 1) == '_' && ! *(p + 2)) ||
 	    std::strcmp(p, "file_") == 0)
 	  return MAKE_FUNCTOR(session_t::option_file_);
+	else if (std::strcmp(p, "finalize_jobs_") == 0)
+	  return MAKE_FUNCTOR(session_t::option_finalize_jobs_);
+	break;
+
+      case 'm':
+	if (std::strcmp(p, "memory_stats") == 0)
+	  return MAKE_FUNCTOR(session_t::option_memory_stats);
+	break;
+
+      case 'p':
+	if (std::strcmp(p, "profile") == 0)
+	  return MAKE_FUNCTOR(session_t::option_profile);
 	break;
 
       case 't':
@@ -395,6 +503,7 @@ void session_t::shutdown()
   expr_t::shutdown();
   value_t::shutdown();
   amount_t::shutdown();
+  release_error_buffers();
 }
 
 } // namespace ledger
@@ -40,6 +40,19 @@
 namespace ledger {
 
 class report_t;
+class balance_checkpoints_t;
+
+/**
+ * A report_xdata_t holds the extended data a report attaches to
+ * transactions and accounts.  Every session has one, which is what
+ * reports use by default; a thread reporting on a frozen session
+ * alongside others binds its own with `set_report_context'.
+ */
+struct report_xdata_t : public noncopyable
+{
+  xdata_pool_t<xact_t::xdata_t>	   xacts;
+  xdata_pool_t<account_t::xdata_t> accounts;
+};
 
 class session_t : public noncopyable, public scope_t
 {
@@ -47,16 +60,16 @@ class session_t : public noncopyable, public scope_t
   static void shutdown();
 
   friend void set_session_context(session_t * session);
-  friend void release_session_context();
 
 public:
-  static session_t * current;
+  static THREAD_LOCAL session_t * current;
 
   scoped_ptr<report_t> current_report;
 
   path		 data_file;
   optional<path> init_file;
   optional<path> cache_file;
+  optional<path> checkpoint_file;
   optional<path> price_db;
 
   string register_format;
@@ -77,6 +90,8 @@ public:
   bool use_cache;
   bool cache_dirty;
 
+  unsigned int finalize_jobs;
+
   datetime_t now;
   date_t today;
 
@@ -86,12 +101,20 @@ public:
   bool ansi_codes;
   bool ansi_invert;
 
+  string_table_t		strings; // must outlive the journals
+
   ptr_list<journal_t>		journals;
   ptr_list<journal_t::parser_t> parsers;
-  scoped_ptr<commodity_pool_t>	commdity_pool;
+  scoped_ptr<commodity_pool_t>	commodity_pool;
   scoped_ptr<account_t>		master;
   mutable accounts_map		accounts_cache;
 
+  scoped_ptr<balance_checkpoints_t> checkpoints;
+
+  report_xdata_t		xdata;
+
+  bool				frozen;
+
   session_t();
   virtual ~session_t();
 
@@ -125,6 +148,8 @@ public:
   std::size_t read_data(journal_t&    journal,
 			const string& master_account = "");
 
+  balance_checkpoints_t * balance_checkpoints();
+
   void register_parser(journal_t::parser_t * parser) {
     parsers.push_back(parser);
   }
@@ -152,6 +177,9 @@ public:
   }
 
   account_t * find_account(const string& name, bool auto_create = true) {
+    if (frozen)
+      return master->find_account(name, false);
+
     accounts_map::iterator c = accounts_cache.find(name);
     if (c != accounts_cache.end())
       return (*c).second;
@@ -172,6 +200,19 @@ public:
     clean_accounts();
   }
 
+  /**
+   * freeze turns the session's journals into a read-only snapshot,
+   * which any number of threads may then report on at once, each
+   * with its own report_xdata_t.  Transactions and accounts are given
+   * fixed ids into those side tables, account names are computed
+   * ahead of time, and shared amounts are marked so that copying them
+   * leaves their reference counts alone.  After this the journals,
+   * accounts and commodity pool must not be changed: new commodities
+   * may not be created, and find_account will no longer create
+   * accounts.
+   */
+  void freeze();
+
   //
   // Scope members
   //
@@ -211,6 +252,12 @@ See LICENSE file included with the distribution for details and disclaimer.\n";
   value_t option_verify(scope_t&) {
     return NULL_VALUE;
   }
+  value_t option_profile(scope_t&) {
+    return NULL_VALUE;
+  }
+  value_t option_memory_stats(scope_t&) {
+    return NULL_VALUE;
+  }
 
   value_t option_verbose(scope_t&) {
 #if defined(LOGGING_ON)
@@ -224,6 +271,20 @@ See LICENSE file included with the distribution for details and disclaimer.\n";
   // Option handlers
   //
 
+  value_t option_checkpoints_(call_scope_t& args) {
+    checkpoint_file = args[0].as_string();
+    return true;
+  }
+
+  value_t option_finalize_jobs_(call_scope_t& args) {
+    long jobs = lexical_cast<long>(args[0].as_string());
+    if (jobs < 1)
+      throw_(std::invalid_argument,
+	     "The number of finalize jobs must be at least one");
+    finalize_jobs = static_cast<unsigned int>(jobs);
+    return true;
+  }
+
   value_t option_file_(call_scope_t& args) {
     assert(args.size() == 1);
     // jww (2008-08-13): Add support for multiple files, but not between
@@ -251,16 +312,41 @@ See LICENSE file included with the distribution for details and disclaimer.\n";
 };
 
 /**
- * This sets the current session context, transferring all static
- * globals to point at the data structures related to this session.
- * Although Ledger itself is not thread-safe, by locking, switching
- * session context, then unlocking after the operation is done,
- * multiple threads can sequentially make use of the library.  Thus, a
- * session_t maintains all of the information relating to a single
- * usage of the Ledger library.
+ * This sets the current session context for the calling thread,
+ * transferring all static globals to point at the data structures
+ * related to this session: its commodity pool and the pools of
+ * transaction and account xdata.  Each thread has its own context,
+ * so different threads may work on different sessions at once.
+ * Thus, a session_t maintains all of the information relating to a
+ * single usage of the Ledger library.  Passing NULL releases the
+ * thread's per-thread scratch state.
+ *
+ * A session is otherwise used by one thread at a time, with two
+ * exceptions.  While journal_t::add_entries runs, its workers are
+ * bound to the same session, but each only calls balance_xacts on the
+ * entries of its own share of the batch, whose amounts are either
+ * unshared or marked shared; nothing else in the session may be
+ * touched until they are joined.  And once session_t::freeze has been
+ * called, reports may run on several threads, as described below.
  */
 void set_session_context(session_t * session = NULL);
 
+/**
+ * set_report_context makes the calling thread report with `report'
+ * and keep report data in `xdata', rather than using its session's
+ * current_report and tables, until it is called again.  Passing NULL
+ * for either goes back to the session's own.  Reports run at the same
+ * time over a frozen session each need their own pair.
+ */
+void set_report_context(report_t *	 report = NULL,
+			report_xdata_t * xdata	= NULL);
+
+/**
+ * current_report returns the report the calling thread is producing,
+ * which expressions evaluated against items refer to.
+ */
+report_t& current_report();
+
 } // namespace ledger
 
 #endif // _SESSION_H
@@ -60,10 +60,13 @@
 #include <fstream>
 #include <sstream>
 #include <iterator>
+#include <deque>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
 #include <new>
+#include <set>
 #include <stack>
 #include <string>
 #include <vector>
@@ -106,6 +109,14 @@ typedef std::ostream::pos_type ostream_pos_type;
 
 #include <sys/stat.h>
 
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef WIN32
 #include <io.h>
 #else
@@ -162,6 +173,13 @@ extern "C" {
 #include <boost/ptr_container/ptr_list.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/regex.hpp>
+#include <boost/static_assert.hpp>
 #include <boost/variant.hpp>
 
+#if defined(HAVE_BOOST_THREAD)
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
 #endif // _SYSTEM_HH
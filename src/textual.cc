@@ -46,13 +46,6 @@ namespace ledger {
 
 #define MAX_LINE 1024
 
-static path         pathname;
-static unsigned int linenum;
-static unsigned int src_idx;
-static accounts_map account_aliases;
-
-static std::list<std::pair<path, int> > include_stack;
-
 #ifdef TIMELOG_SUPPORT
 struct time_entry_t
 {
@@ -81,14 +74,127 @@ struct time_entry_t
 #endif
 
 namespace {
-  optional<expr_t> parse_amount_expr(std::istream&  in,
-				     amount_t&      amount,
-				     xact_t *	    xact,
-				     unsigned short flags = 0)
+  /**
+   * Read the next line into buf, returning its length less any trailing
+   * carriage return.  The length is taken from the stream's own count of
+   * what it extracted, rather than by scanning the line again.
+   */
+  std::size_t read_line(std::istream& in, char * buf)
+  {
+    in.getline(buf, MAX_LINE);
+
+    std::size_t len = in.gcount();
+    if (len > 0 && buf[len - 1] == '\0') // the newline was consumed
+      len--;
+    if (len > 0 && buf[len - 1] == '\r')
+      buf[--len] = '\0';
+    return len;
+  }
+
+  /**
+   * The state of one textual_parser_t::parse call, passed explicitly
+   * to the helpers below rather than kept in statics, so that several
+   * journals may be parsed at once on different threads.
+   */
+  struct pending_entries_t;
+
+  struct parse_context_t : public noncopyable
+  {
+    path	 pathname;
+    unsigned int linenum;
+    unsigned int src_idx;
+    accounts_map account_aliases;
+
+    std::list<std::pair<path, int> > include_stack;
+
+    journal_t *         journal;
+    pending_entries_t * pending;
+
+    parse_context_t() : linenum(0), src_idx(0), journal(NULL), pending(NULL) {
+      TRACE_CTOR(parse_context_t, "");
+    }
+    ~parse_context_t() throw() {
+      TRACE_DTOR(parse_context_t);
+    }
+  };
+
+  void report_parse_error(parse_context_t& context, std::size_t linenum,
+			  const string& message)
+  {
+    for (std::list<std::pair<path, int> >::reverse_iterator i =
+	   context.include_stack.rbegin();
+	 i != context.include_stack.rend();
+	 i++) {
+      add_error_context("In file included from ");
+#if 0
+      add_error_context(include_context((*i).first, (*i).second));
+#endif
+    }
+    add_error_context(file_context(context.pathname, linenum));
+
+    std::cout.flush();
+    std::cerr << "Error: " << error_context() << message << std::endl;
+  }
+
+  // Reports an entry which failed to finalize in a batch at its last
+  // line, as if it had failed there while being parsed.
+  struct pending_error_reporter_t
+  {
+    parse_context_t * context;
+    unsigned int *    errors;
+
+    void operator()(entry_t& entry, const string& message) const {
+      report_parse_error(*context, entry.end_line - 1, message);
+      (*errors)++;
+    }
+  };
+
+  /**
+   * Entries parsed while session_t::finalize_jobs is above one are held
+   * here, and finalized together by journal_t::add_entries whenever a
+   * directive that might change the outcome comes along, when a balance
+   * assignment needs the accounts' running totals, or at the end of the
+   * file.
+   */
+  struct pending_entries_t : public noncopyable
+  {
+    journal_t&		     journal;
+    unsigned int	     jobs;
+    pending_error_reporter_t on_error;
+    std::vector<entry_t *>   entries;
+    unsigned int	     count;
+
+    pending_entries_t(journal_t& _journal, unsigned int _jobs,
+		      const pending_error_reporter_t& _on_error)
+      : journal(_journal), jobs(_jobs), on_error(_on_error), count(0) {}
+    ~pending_entries_t() {
+      foreach (entry_t * entry, entries)
+	checked_delete(entry);
+    }
+
+    void finalize() {
+      if (! entries.empty())
+	count += journal.add_entries(entries, jobs, on_error);
+    }
+  };
+
+  // Automated and period entries, default accounts, prices, timelog
+  // events and the like all affect how later entries finalize, so any
+  // pending ones are finalized before such a line is processed.
+  bool ends_entry_batch(const char c)
+  {
+    return c != '\0' && std::strchr("iIoODACPNY-=~@!", c) != NULL;
+  }
+
+  optional<expr_t> parse_amount_expr(parse_context_t& context,
+				     std::istream&    in,
+				     amount_t&	      amount,
+				     xact_t *	      xact,
+				     unsigned short   flags = 0)
   {
     expr_t expr(in, flags | EXPR_PARSE_PARTIAL);
 
-    DEBUG("textual.parse", "line " << linenum << ": " <<
+    DEBUG("textual.parse", "line " << context.linenum << ": " <<
 	  "Parsed an amount expression");
 
 #ifdef DEBUG_ENABLED
@@ -102,15 +208,44 @@ namespace {
 
     if (expr) {
       amount = expr.calc(*xact).as_amount();
-      DEBUG("textual.parse", "line " << linenum << ": " <<
+      DEBUG("textual.parse", "line " << context.linenum << ": " <<
 	    "The transaction amount is " << amount);
       return expr;
     }
     return none;
   }
+
+  // Holds a transaction from the journal's arena until parse_xact hands
+  // it over, and gives it back to the journal if parsing fails.
+  class arena_xact_ptr : public noncopyable
+  {
+    journal_t& journal;
+    xact_t *   xact;
+
+  public:
+    arena_xact_ptr(journal_t& _journal)
+      : journal(_journal), xact(journal.make_xact()) {}
+    ~arena_xact_ptr() {
+      if (xact)
+	journal.discard_xact(xact);
+    }
+
+    xact_t * get() const {
+      return xact;
+    }
+    xact_t * operator->() const {
+      return xact;
+    }
+    xact_t * release() {
+      xact_t * temp = xact;
+      xact = NULL;
+      return temp;
+    }
+  };
 }
 
-xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
+xact_t * parse_xact(parse_context_t& context, char * line,
+		    account_t * account, entry_t * entry = NULL)
 {
   std::istringstream in(line);
 
@@ -118,7 +253,7 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
   try {
 
   // The account will be determined later...
-  std::auto_ptr<xact_t> xact(new xact_t);
+  arena_xact_ptr xact(*context.journal);
   if (entry)
     xact->entry = entry;
 
@@ -130,14 +265,14 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
     xact->set_state(item_t::CLEARED);
     in.get(p);
     p = peek_next_nonws(in);
-    DEBUG("textual.parse", "line " << linenum << ": " <<
+    DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		"Parsed the CLEARED flag");
     break;
   case '!':
     xact->set_state(item_t::PENDING);
     in.get(p);
     p = peek_next_nonws(in);
-    DEBUG("textual.parse", "line " << linenum << ": " <<
+    DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		"Parsed the PENDING flag");
     break;
   }
@@ -165,22 +300,22 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
       (*b == '(' && *(e - 1) == ')')) {
     xact->add_flags(XACT_VIRTUAL);
     DEBUG("textual.parse",
-	  "line " << linenum << ": " << "Parsed a virtual account name");
+	  "line " << context.linenum << ": " << "Parsed a virtual account name");
 
     if (*b == '[') {
       xact->add_flags(XACT_MUST_BALANCE);
       DEBUG("textual.parse",
-	    "line " << linenum << ": " << "Transaction must balance");
+	    "line " << context.linenum << ": " << "Transaction must balance");
     }
     b++; e--;
   }
 
   string name(b, e - b);
-  DEBUG("textual.parse", "line " << linenum << ": " <<
+  DEBUG("textual.parse", "line " << context.linenum << ": " <<
 	      "Parsed account name " << name);
-  if (account_aliases.size() > 0) {
-    accounts_map::const_iterator i = account_aliases.find(name);
-    if (i != account_aliases.end())
+  if (context.account_aliases.size() > 0) {
+    accounts_map::const_iterator i = context.account_aliases.find(name);
+    if (i != context.account_aliases.end())
       xact->account = (*i).second;
   }
   if (! xact->account)
@@ -202,25 +337,24 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
     try {
       istream_pos_type beg = in.tellg();
 
-      xact->amount_expr =
-	parse_amount_expr(in, xact->amount, xact.get(),
+      optional<expr_t> amount_expr =
+	parse_amount_expr(context, in, xact->amount, xact.get(),
 			  EXPR_PARSE_NO_REDUCE | EXPR_PARSE_NO_ASSIGN);
       saw_amount = true;
 
       if (! xact->amount.is_null()) {
 	xact->amount.reduce();
-	DEBUG("textual.parse", "line " << linenum << ": " <<
+	DEBUG("textual.parse", "line " << context.linenum << ": " <<
 	      "Reduced amount is " << xact->amount);
       }
 
-      // We don't need to store the actual expression that resulted in the
-      // amount if it's constant
-      if (xact->amount_expr) {
-	if (xact->amount_expr->is_constant())
-	  xact->amount_expr = expr_t();
-
+      // We don't need to store the expression that resulted in the amount
+      // if it's constant; its text can always be found again through the
+      // transaction's source position.
+      if (amount_expr && ! amount_expr->is_constant()) {
 	istream_pos_type end = in.tellg();
-	xact->amount_expr->set_text(string(line, long(beg), long(end - beg)));
+	amount_expr->set_text(string(line, long(beg), long(end - beg)));
+	xact->details().amount_expr = amount_expr;
       }
     }
     catch (const std::exception& err) {
@@ -238,14 +372,14 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
 	throw parse_error
 	  ("Transaction cannot have a cost expression with an amount");
 	
-      DEBUG("textual.parse", "line " << linenum << ": " <<
+      DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		  "Found a price indicator");
       bool per_unit = true;
       in.get(p);
       if (in.peek() == '@') {
 	in.get(p);
 	per_unit = false;
-	DEBUG("textual.parse", "line " << linenum << ": " <<
+	DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		    "And it's for a total price");
       }
 
@@ -255,19 +389,20 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
 	try {
 	  istream_pos_type beg = in.tellg();
 
-	  xact->cost_expr =
-	    parse_amount_expr(in, *xact->cost, xact.get(),
+	  optional<expr_t> cost_expr =
+	    parse_amount_expr(context, in, *xact->cost, xact.get(),
 			      EXPR_PARSE_NO_MIGRATE |
 			      EXPR_PARSE_NO_ASSIGN);
 
-	  if (xact->cost_expr) {
+	  if (cost_expr) {
 	    istream_pos_type end = in.tellg();
 	    if (per_unit)
-	      xact->cost_expr->set_text(string("@") +
-					string(line, long(beg), long(end - beg)));
+	      cost_expr->set_text(string("@") +
+				  string(line, long(beg), long(end - beg)));
 	    else
-	      xact->cost_expr->set_text(string("@@") +
-					string(line, long(beg), long(end - beg)));
+	      cost_expr->set_text(string("@@") +
+				  string(line, long(beg), long(end - beg)));
+	    xact->details().cost_expr = cost_expr;
 	  }
 	}
 	catch (const std::exception& err) {
@@ -288,11 +423,11 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
 	    ! xact->amount.commodity().annotated)
 	  xact->amount.annotate(annotation_t(per_unit_cost));
 
-	DEBUG("textual.parse", "line " << linenum << ": " <<
+	DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		    "Total cost is " << *xact->cost);
-	DEBUG("textual.parse", "line " << linenum << ": " <<
+	DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		    "Per-unit cost is " << per_unit_cost);
-	DEBUG("textual.parse", "line " << linenum << ": " <<
+	DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		    "Annotated amount is " << xact->amount);
       }
     }
@@ -306,33 +441,39 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
       p = peek_next_nonws(in);
       if (p == '=') {
 	in.get(p);
-	DEBUG("textual.parse", "line " << linenum << ": " <<
+	DEBUG("textual.parse", "line " << context.linenum << ": " <<
 	      "Found a balance assignment indicator");
 	if (in.good() && ! in.eof()) {
-	  xact->assigned_amount = amount_t();
+	  xact_t::details_t& details(xact->details());
+	  details.assigned_amount = amount_t();
 
 	  try {
 	    istream_pos_type beg = in.tellg();
 
-	    xact->assigned_amount_expr =
-	      parse_amount_expr(in, *xact->assigned_amount, xact.get(),
-				EXPR_PARSE_NO_MIGRATE);
+	    details.assigned_amount_expr =
+	      parse_amount_expr(context, in, *details.assigned_amount,
+				xact.get(), EXPR_PARSE_NO_MIGRATE);
 
-	    if (xact->assigned_amount->is_null())
+	    if (details.assigned_amount->is_null())
 	      throw parse_error
 		("An assigned balance must evaluate to a constant value");
 
-	    DEBUG("textual.parse", "line " << linenum << ": " <<
-		  "XACT assign: parsed amt = " << *xact->assigned_amount);
+	    DEBUG("textual.parse", "line " << context.linenum << ": " <<
+		  "XACT assign: parsed amt = " << *details.assigned_amount);
 
-	    if (xact->assigned_amount_expr) {
+	    if (details.assigned_amount_expr) {
 	      istream_pos_type end = in.tellg();
-	      xact->assigned_amount_expr->set_text
+	      details.assigned_amount_expr->set_text
 		(string("=") + string(line, long(beg), long(end - beg)));
 	    }
 
+	    // An account's running total only includes entries which have
+	    // settled, so any still waiting in a batch are added first.
+	    if (context.pending)
+	      context.pending->finalize();
+
 	    account_t::xdata_t& xdata(xact->account->xdata());
-	    amount_t& amt(*xact->assigned_amount);
+	    amount_t& amt(*details.assigned_amount);
 
 	    DEBUG("xact.assign",
 		  "account balance = " << xdata.value.strip_annotations());
@@ -362,7 +503,7 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
 	    }
 
 	    DEBUG("xact.assign", "diff = " << diff.strip_annotations());
-	    DEBUG("textual.parse", "line " << linenum << ": " <<
+	    DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		  "XACT assign: diff = " << diff.strip_annotations());
 
 	    if (! diff.is_zero()) {
@@ -373,12 +514,12 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
 					     ITEM_GENERATED | XACT_CALCULATED);
 		  entry->add_xact(temp);
 
-		  DEBUG("textual.parse", "line " << linenum << ": " <<
+		  DEBUG("textual.parse", "line " << context.linenum << ": " <<
 			"Created balancing transaction");
 		}
 	      } else {
 		xact->amount = diff;
-		DEBUG("textual.parse", "line " << linenum << ": " <<
+		DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		      "Overwrite null transaction");
 	      }
 	    }
@@ -401,7 +542,7 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
       in.get(p);
       p = peek_next_nonws(in);
       xact->note = &line[long(in.tellg())];
-      DEBUG("textual.parse", "line " << linenum << ": " <<
+      DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		  "Parsed a note '" << *xact->note << "'");
 
       if (char * b = std::strchr(xact->note->c_str(), '['))
@@ -410,7 +551,7 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
 	  std::strncpy(buf, b + 1, e - b - 1);
 	  buf[e - b - 1] = '\0';
 
-	  DEBUG("textual.parse", "line " << linenum << ": " <<
+	  DEBUG("textual.parse", "line " << context.linenum << ": " <<
 		"Parsed a transaction date " << buf);
 
 	  if (char * p = std::strchr(buf, '=')) {
@@ -434,35 +575,34 @@ xact_t * parse_xact(char * line, account_t * account, entry_t * entry = NULL)
   }
 }
 
-bool parse_xacts(std::istream&	  in,
+bool parse_xacts(parse_context_t& context,
+		 std::istream&	  in,
 		 account_t *	  account,
 		 entry_base_t&	  entry,
 		 const string&	  kind,
 		 istream_pos_type beg_pos)
 {
+  PROFILE_SCOPE("textual.parse_xacts");
+
   TRACE_START(entry_xacts, 1, "Time spent parsing transactions:");
 
-  static char line[MAX_LINE + 1];
-  bool	      added = false;
+  char line[MAX_LINE + 1];
+  bool added = false;
 
   while (! in.eof() && (in.peek() == ' ' || in.peek() == '\t')) {
-    in.getline(line, MAX_LINE);
+    std::size_t len = read_line(in, line);
     if (in.eof())
       break;
 
-    int len = std::strlen(line);
-    if (line[len - 1] == '\r')
-      line[--len] = '\0';
-
     beg_pos += len + 1;
-    linenum++;
+    context.linenum++;
 
     if (line[0] == ' ' || line[0] == '\t') {
       char * p = skip_ws(line);
       if (! *p)
 	break;
     }
-    if (xact_t * xact = parse_xact(line, account)) {
+    if (xact_t * xact = parse_xact(context, line, account)) {
       entry.add_xact(xact);
       added = true;
     }
@@ -473,9 +613,12 @@ bool parse_xacts(std::istream&	  in,
   return added;
 }
 
-entry_t * parse_entry(std::istream& in, char * line, account_t * master,
+entry_t * parse_entry(parse_context_t& context,
+		      std::istream& in, char * line, account_t * master,
 		      textual_parser_t& parser, istream_pos_type& pos)
 {
+  PROFILE_SCOPE("textual.parse_entry");
+
   TRACE_START(entry_text, 1, "Time spent preparing entry text:");
 
   std::auto_ptr<entry_t> curr(new entry_t);
@@ -527,23 +670,19 @@ entry_t * parse_entry(std::istream& in, char * line, account_t * master,
   TRACE_START(entry_details, 1, "Time spent parsing entry details:");
 
   istream_pos_type end_pos;
-  unsigned long beg_line = linenum;
+  unsigned long beg_line = context.linenum;
 
   while (! in.eof() && (in.peek() == ' ' || in.peek() == '\t')) {
     istream_pos_type beg_pos = in.tellg();
 
     line[0] = '\0';
-    in.getline(line, MAX_LINE);
+    std::size_t len = read_line(in, line);
     if (in.eof() && line[0] == '\0')
       break;
 
-    int len = std::strlen(line);
-    if (line[len - 1] == '\r')
-      line[--len] = '\0';
-
     end_pos = beg_pos;
     end_pos += len + 1;
-    linenum++;
+    context.linenum++;
 
     if (line[0] == ' ' || line[0] == '\t') {
       char * p = skip_ws(line);
@@ -551,13 +690,13 @@ entry_t * parse_entry(std::istream& in, char * line, account_t * master,
 	break;
     }
 
-    if (xact_t * xact = parse_xact(line, master, curr.get())) {
+    if (xact_t * xact = parse_xact(context, line, master, curr.get())) {
       xact->set_state(state);
 
       xact->beg_pos  = beg_pos;
       xact->beg_line = beg_line;
       xact->end_pos  = end_pos;
-      xact->end_line = linenum;
+      xact->end_line = context.linenum;
 
       pos = end_pos;
 
@@ -685,45 +824,54 @@ unsigned int textual_parser_t::parse(std::istream& in,
 				     account_t *   master,
 				     const path *  original_file)
 {
+  PROFILE_SCOPE("textual.parse");
+
   TRACE_START(parsing_total, 1, "Total time spent parsing text:");
 
-  static bool  added_auto_entry_hook = false;
-  static char  line[MAX_LINE + 1];
-  unsigned int count  = 0;
-  unsigned int errors = 0;
+  parse_context_t context;
+  bool		  added_auto_entry_hook = false;
+  char		  line[MAX_LINE + 1];
+  unsigned int	  count	 = 0;
+  unsigned int	  errors = 0;
 
   std::list<account_t *>  account_stack;
   auto_entry_finalizer_t  auto_entry_finalizer(&journal);
   std::list<time_entry_t> time_entries;
 
+  pending_error_reporter_t pending_errors = { &context, &errors };
+  pending_entries_t	   pending(journal, session.finalize_jobs,
+				   pending_errors);
+
+  context.journal = &journal;
+  context.pending = &pending;
+
   if (! master)
     master = journal.master;
 
   account_stack.push_front(master);
 
-  pathname = journal.sources.back();
-  src_idx  = journal.sources.size() - 1;
-  linenum  = 1;
+  context.pathname = journal.sources.back();
+  context.src_idx  = journal.sources.size() - 1;
+  context.linenum  = 1;
 
-  INFO("Parsing file '" << pathname.string() << "'");
+  INFO("Parsing file '" << context.pathname.string() << "'");
 
   istream_pos_type beg_pos  = in.tellg();
   istream_pos_type end_pos;
-  unsigned long	   beg_line = linenum;
+  unsigned long	   beg_line = context.linenum;
 
   while (in.good() && ! in.eof()) {
     try {
-      in.getline(line, MAX_LINE);
+      std::size_t len = read_line(in, line);
       if (in.eof())
 	break;
 
-      int len = std::strlen(line);
-      if (line[len - 1] == '\r')
-	line[--len] = '\0';
-
       end_pos = beg_pos;
       end_pos += len + 1;
-      linenum++;
+      context.linenum++;
+
+      if (ends_entry_batch(line[0]))
+	pending.finalize();
 
       switch (line[0]) {
       case '\0':
@@ -867,14 +1015,14 @@ unsigned int textual_parser_t::parse(std::istream& in,
 	}
 
 	auto_entry_t * ae = new auto_entry_t(skip_ws(line + 1));
-	if (parse_xacts(in, account_stack.front(), *ae, "automated",
+	if (parse_xacts(context, in, account_stack.front(), *ae, "automated",
 			end_pos)) {
 	  journal.auto_entries.push_back(ae);
-	  ae->src_idx  = src_idx;
+	  ae->src_idx  = context.src_idx;
 	  ae->beg_pos  = beg_pos;
 	  ae->beg_line = beg_line;
 	  ae->end_pos  = end_pos;
-	  ae->end_line = linenum;
+	  ae->end_line = context.linenum;
 	}
 	break;
       }
@@ -884,16 +1032,16 @@ unsigned int textual_parser_t::parse(std::istream& in,
 	if (! pe->period)
 	  throw_(parse_error, "Parsing time period '" << line << "'");
 
-	if (parse_xacts(in, account_stack.front(), *pe,
+	if (parse_xacts(context, in, account_stack.front(), *pe,
 			       "period", end_pos)) {
 	  if (pe->finalize()) {
 	    extend_entry_base(&journal, *pe, true);
 	    journal.period_entries.push_back(pe);
-	    pe->src_idx	 = src_idx;
+	    pe->src_idx	 = context.src_idx;
 	    pe->beg_pos	 = beg_pos;
 	    pe->beg_line = beg_line;
 	    pe->end_pos	 = end_pos;
-	    pe->end_line = linenum;
+	    pe->end_line = context.linenum;
 	  } else {
 	    throw parse_error("Period entry failed to balance");
 	  }
@@ -906,31 +1054,33 @@ unsigned int textual_parser_t::parse(std::istream& in,
 	char * p = next_element(line);
 	string word(line + 1);
 	if (word == "include") {
-	  push_variable<path>		  save_pathname(pathname);
-	  push_variable<unsigned int>	  save_src_idx(src_idx);
+	  push_variable<path>		  save_pathname(context.pathname);
+	  push_variable<unsigned int>	  save_src_idx(context.src_idx);
 	  push_variable<istream_pos_type> save_beg_pos(beg_pos);
 	  push_variable<istream_pos_type> save_end_pos(end_pos);
-	  push_variable<unsigned int>	  save_linenum(linenum);
+	  push_variable<unsigned int>	  save_linenum(context.linenum);
 
-	  pathname = p;
+	  context.pathname = p;
 #if 0
-	  if (pathname[0] != '/' && pathname[0] != '\\' && pathname[0] != '~') {
+	  if (context.pathname[0] != '/' && context.pathname[0] != '\\' &&
+	      context.pathname[0] != '~') {
 	    string::size_type pos = save_pathname.prev.rfind('/');
 	    if (pos == string::npos)
 	      pos = save_pathname.prev.rfind('\\');
 	    if (pos != string::npos)
-	      pathname = string(save_pathname.prev, 0, pos + 1) + pathname;
+	      context.pathname =
+		string(save_pathname.prev, 0, pos + 1) + context.pathname;
 	  }
-	  pathname = resolve_path(pathname);
+	  context.pathname = resolve_path(context.pathname);
 
-	  DEBUG("ledger.textual.include", "line " << linenum << ": " <<
-		      "Including path '" << pathname << "'");
+	  DEBUG("ledger.textual.include", "line " << context.linenum << ": " <<
+		      "Including path '" << context.pathname << "'");
 
-	  include_stack.push_back(std::pair<path, int>
-				  (journal.sources.back(), linenum - 1));
-	  count += parse_journal_file(pathname, config, journal,
+	  context.include_stack.push_back(std::pair<path, int>
+				  (journal.sources.back(), context.linenum - 1));
+	  count += parse_journal_file(context.pathname, config, journal,
 				      account_stack.front());
-	  include_stack.pop_back();
+	  context.include_stack.pop_back();
 #endif
 	}
 	else if (word == "account") {
@@ -952,11 +1102,11 @@ unsigned int textual_parser_t::parse(std::istream& in,
 
 	    // Once we have an alias name (b) and the target account
 	    // name (e), add a reference to the account in the
-	    // `account_aliases' map, which is used by the xact
+	    // context's `account_aliases' map, which is used by the xact
 	    // parser to resolve alias references.
 	    account_t * acct = account_stack.front()->find_account(e);
 	    std::pair<accounts_map::iterator, bool> result
-	      = account_aliases.insert(accounts_map::value_type(b, acct));
+	      = context.account_aliases.insert(accounts_map::value_type(b, acct));
 	    assert(result.second);
 	  }
 	}
@@ -971,18 +1121,23 @@ unsigned int textual_parser_t::parse(std::istream& in,
 	istream_pos_type pos = beg_pos;
 	TRACE_START(entries, 1, "Time spent handling entries:");
 	if (entry_t * entry =
-	    parse_entry(in, line, account_stack.front(), *this, pos)) {
+	    parse_entry(context, in, line, account_stack.front(), *this, pos)) {
 	  // The entry pointer is unowned at the minute, and there is a
 	  // possibility that add_entry ma throw an exception, which
 	  // would cause us to leak without this guard.
 	  std::auto_ptr<entry_t> entry_ptr(entry);
-	  if (journal.add_entry(entry)) {
+	  entry->src_idx  = context.src_idx;
+	  entry->beg_pos  = beg_pos;
+	  entry->beg_line = beg_line;
+	  entry->end_pos  = pos;
+	  entry->end_line = context.linenum;
+
+	  if (session.finalize_jobs > 1) {
+	    pending.entries.push_back(entry);
+	    entry_ptr.release(); // it's owned by the pending batch now
+	  }
+	  else if (journal.add_entry(entry)) {
 	    entry_ptr.release(); // it's owned by the journal now
-	    entry->src_idx  = src_idx;
-	    entry->beg_pos  = beg_pos;
-	    entry->beg_line = beg_line;
-	    entry->end_pos  = pos;
-	    entry->end_line = linenum;
 	    count++;
 	  }
 	  // It's perfectly valid for the journal to reject the entry,
@@ -999,25 +1154,15 @@ unsigned int textual_parser_t::parse(std::istream& in,
       }
     }
     catch (const std::exception& err) {
-      for (std::list<std::pair<path, int> >::reverse_iterator i =
-	     include_stack.rbegin();
-	   i != include_stack.rend();
-	   i++) {
-	add_error_context("In file included from ");
-#if 0
-	add_error_context(include_context((*i).first, (*i).second));
-#endif
-      }
-      add_error_context(file_context(pathname, linenum - 1));
-
-      std::cout.flush();
-      std::cerr << "Error: " << error_context() << err.what()
-		<< std::endl;
+      report_parse_error(context, context.linenum - 1, err.what());
       errors++;
     }
     beg_pos = end_pos;
   }
 
+  pending.finalize();
+  count += pending.count;
+
   if (! time_entries.empty()) {
     std::list<account_t *> accounts;
 
@@ -81,6 +81,8 @@ static object_count_map * total_memory_count = NULL;
 
 static bool memory_tracing_active = false;
 
+std::size_t allocation_count = 0;
+
 static live_objects_map * live_objects	     = NULL;
 static object_count_map * live_object_count  = NULL;
 static object_count_map * total_object_count = NULL;
@@ -200,24 +202,28 @@ static void trace_delete_func(void * ptr, const char * which)
 
 void * operator new(std::size_t size) throw (std::bad_alloc) {
   void * ptr = std::malloc(size);
+  ++ledger::allocation_count;
   if (DO_VERIFY() && ledger::memory_tracing_active)
     ledger::trace_new_func(ptr, "new", size);
   return ptr;
 }
 void * operator new(std::size_t size, const std::nothrow_t&) throw() {
   void * ptr = std::malloc(size);
+  ++ledger::allocation_count;
   if (DO_VERIFY() && ledger::memory_tracing_active)
     ledger::trace_new_func(ptr, "new", size);
   return ptr;
 }
 void * operator new[](std::size_t size) throw (std::bad_alloc) {
   void * ptr = std::malloc(size);
+  ++ledger::allocation_count;
   if (DO_VERIFY() && ledger::memory_tracing_active)
     ledger::trace_new_func(ptr, "new[]", size);
   return ptr;
 }
 void * operator new[](std::size_t size, const std::nothrow_t&) throw() {
   void * ptr = std::malloc(size);
+  ++ledger::allocation_count;
   if (DO_VERIFY() && ledger::memory_tracing_active)
     ledger::trace_new_func(ptr, "new[]", size);
   return ptr;
@@ -548,7 +554,17 @@ struct timer_t
       description(_description), active(true) {}
 };
 
-typedef std::map<std::string, timer_t> timer_map;
+// Timer names are always string literals (see the *_START macros), so
+// they can be compared in place rather than copied into a string key
+// on every lookup.
+struct timer_name_less
+{
+  bool operator()(const char * left, const char * right) const {
+    return std::strcmp(left, right) < 0;
+  }
+};
+
+typedef std::map<const char *, timer_t, timer_name_less> timer_map;
 
 static timer_map timers;
 
@@ -632,6 +648,311 @@ void finish_timer(const char * name)
 
 #endif // LOGGING_ON && TIMERS_ON
 
+/**********************************************************************
+ *
+ * Profiling
+ */
+
+namespace ledger {
+
+bool profiling_enabled = false;
+
+THREAD_LOCAL profile_scope_t * profile_scope_t::current = NULL;
+
+static profile_site_t *		     profile_sites = NULL;
+static std::vector<profile_site_t *> profile_owned_sites;
+
+#if defined(HAVE_BOOST_THREAD)
+// Guards the list of sites.  It is recursive because profile_site
+// holds it while constructing a site, which links itself in.
+static boost::recursive_mutex& profile_sites_lock()
+{
+  static boost::recursive_mutex lock;
+  return lock;
+}
+#define PROFILE_SITES_GUARD() \
+  boost::recursive_mutex::scoped_lock guard(profile_sites_lock())
+#else
+#define PROFILE_SITES_GUARD()
+#endif
+
+profile_ticks_t profile_clock()
+{
+#if defined(CLOCK_MONOTONIC)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (profile_ticks_t(now.tv_sec) * 1000000000ULL +
+	  profile_ticks_t(now.tv_nsec));
+#else
+  static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+  return profile_ticks_t((posix_time::microsec_clock::universal_time() -
+			  epoch).total_microseconds()) * 1000ULL;
+#endif
+}
+
+profile_site_t::profile_site_t(const std::string& _name)
+  : name(_name), calls(0), total(0), self(0), next(NULL)
+{
+  PROFILE_SITES_GUARD();
+  next = profile_sites;
+  profile_sites = this;
+}
+
+profile_site_t& profile_site(const std::string& name)
+{
+  PROFILE_SITES_GUARD();
+
+  for (profile_site_t * site = profile_sites; site; site = site->next)
+    if (site->name == name)
+      return *site;
+
+#if defined(VERIFY_ON)
+  memory_tracing_active = false;
+#endif
+
+  profile_site_t * site = new profile_site_t(name);
+  profile_owned_sites.push_back(site);
+
+#if defined(VERIFY_ON)
+  memory_tracing_active = true;
+#endif
+
+  return *site;
+}
+
+profile_site_t& profile_site(const std::type_info& type)
+{
+  std::string name(type.name());
+
+#if defined(__GNUC__)
+  int	 status;
+  char * demangled = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+  if (demangled) {
+    if (status == 0)
+      name = demangled;
+    std::free(demangled);
+  }
+#endif
+
+  if (name.compare(0, 8, "ledger::") == 0)
+    name.erase(0, 8);
+
+  return profile_site(name);
+}
+
+void profile_scope_t::enter(std::size_t count)
+{
+  parent  = current;
+  current = this;
+  nested  = 0;
+
+  // A recursive site only counts its outermost scope on this thread
+  // toward its total, otherwise the same time would be counted more
+  // than once.
+  outermost = true;
+  for (profile_scope_t * scope = parent; scope; scope = scope->parent)
+    if (scope->site == site) {
+      outermost = false;
+      break;
+    }
+
+  COUNT_ADD(site->calls, count);
+
+  begin = profile_clock();
+}
+
+void profile_scope_t::leave()
+{
+  profile_ticks_t elapsed = profile_clock() - begin;
+
+  if (outermost)
+    COUNT_ADD(site->total, elapsed);
+  COUNT_ADD(site->self, elapsed - nested);
+
+  assert(current == this);
+  current = parent;
+  if (parent)
+    parent->nested += elapsed;
+}
+
+namespace {
+  bool profile_site_total_greater(const profile_site_t * left,
+				  const profile_site_t * right) {
+    return left->total > right->total;
+  }
+}
+
+void report_profile(std::ostream& out)
+{
+  PROFILE_SITES_GUARD();
+
+  std::vector<profile_site_t *> sites;
+  for (profile_site_t * site = profile_sites; site; site = site->next)
+    if (site->calls > 0)
+      sites.push_back(site);
+
+  std::stable_sort(sites.begin(), sites.end(), profile_site_total_greater);
+
+  out << std::right
+      << std::setw(10) << "total ms" << ' '
+      << std::setw(10) << "self ms"  << ' '
+      << std::setw(10) << "calls"    << ' '
+      << std::setw(12) << "items/sec" << "  "
+      << "site" << std::endl;
+
+  foreach (profile_site_t * site, sites) {
+    double total_ms = double(site->total) / 1000000.0;
+    double self_ms  = double(site->self)  / 1000000.0;
+
+    out << std::right << std::fixed << std::setprecision(2)
+	<< std::setw(10) << total_ms << ' '
+	<< std::setw(10) << self_ms  << ' '
+	<< std::setw(10) << site->calls << ' '
+	<< std::setw(12) << std::setprecision(0)
+	<< (site->total > 0 ?
+	    double(site->calls) * 1000000000.0 / double(site->total) : 0.0)
+	<< "  " << site->name << std::endl;
+  }
+  out.unsetf(std::ios::fixed);
+}
+
+void shutdown_profiling()
+{
+  PROFILE_SITES_GUARD();
+
+  profile_site_t ** link = &profile_sites;
+  while (*link) {
+    if (std::find(profile_owned_sites.begin(), profile_owned_sites.end(),
+		  *link) != profile_owned_sites.end())
+      *link = (*link)->next;
+    else
+      link = &(*link)->next;
+  }
+
+  foreach (profile_site_t * site, profile_owned_sites)
+    checked_delete(site);
+  profile_owned_sites.clear();
+}
+
+} // namespace ledger
+
+/**********************************************************************
+ *
+ * Object counting
+ */
+
+namespace ledger {
+
+memory_phase_t memory_phase = PHASE_STARTUP;
+
+std::size_t live_object_bytes = 0;
+std::size_t peak_object_bytes[MEMORY_PHASES];
+std::size_t last_object_bytes[MEMORY_PHASES];
+
+bool memory_stats_enabled = false;
+
+static object_count_t * object_counts = NULL;
+static bool		phase_entered[MEMORY_PHASES] = { true };
+
+void object_count_t::register_object_count(const char * cls_name,
+					   std::size_t  cls_size)
+{
+#if defined(__GNUC__)
+  // Only the first thread to claim this counter links it into the list;
+  // the size is written first, so that any counter found on the list is
+  // complete.
+  if (! __sync_bool_compare_and_swap(&name, static_cast<const char *>(NULL),
+				     cls_name))
+    return;
+
+  size = cls_size;
+  __sync_synchronize();
+  do {
+    next = object_counts;
+  } while (! __sync_bool_compare_and_swap(&object_counts, next, this));
+#else
+  name = cls_name;
+  size = cls_size;
+  next = object_counts;
+  object_counts = this;
+#endif
+}
+
+void set_memory_phase(memory_phase_t phase)
+{
+  if (phase == memory_phase)
+    return;
+
+  // Record what is still alive as the phase ends, and start the new
+  // phase's peak at the current level.
+  for (object_count_t * count = object_counts; count; count = count->next) {
+    count->last[memory_phase] = count->live;
+    if (count->live > count->peak[phase])
+      count->peak[phase] = count->live;
+  }
+  last_object_bytes[memory_phase] = live_object_bytes;
+  if (live_object_bytes > peak_object_bytes[phase])
+    peak_object_bytes[phase] = live_object_bytes;
+
+  memory_phase	       = phase;
+  phase_entered[phase] = true;
+}
+
+namespace {
+  const char * memory_phase_name(memory_phase_t phase) {
+    switch (phase) {
+    case PHASE_STARTUP:	 return "startup";
+    case PHASE_PARSE:	 return "parse";
+    case PHASE_FINALIZE: return "finalize";
+    case PHASE_REPORT:	 return "report";
+    case PHASE_TEARDOWN: return "teardown";
+    case MEMORY_PHASES:
+      assert(false);
+      break;
+    }
+    return "";
+  }
+}
+
+void report_memory_stats(std::ostream& out)
+{
+  // Close off the current phase, so that its "current" column is valid.
+  for (object_count_t * count = object_counts; count; count = count->next)
+    count->last[memory_phase] = count->live;
+  last_object_bytes[memory_phase] = live_object_bytes;
+
+  out << std::left  << std::setw(10) << "phase"
+      << std::setw(24) << "type"
+      << std::right << std::setw(10) << "current"
+      << std::setw(10) << "peak"
+      << std::setw(14) << "current bytes"
+      << std::setw(14) << "peak bytes" << std::endl;
+
+  for (int i = 0; i < MEMORY_PHASES; i++) {
+    if (! phase_entered[i])
+      continue;
+
+    const char * phase = memory_phase_name(memory_phase_t(i));
+
+    for (object_count_t * count = object_counts; count; count = count->next)
+      out << std::left  << std::setw(10) << phase
+	  << std::setw(24) << count->name
+	  << std::right << std::setw(10) << count->last[i]
+	  << std::setw(10) << count->peak[i]
+	  << std::setw(14) << count->last[i] * count->size
+	  << std::setw(14) << count->peak[i] * count->size << std::endl;
+
+    out << std::left  << std::setw(10) << phase
+	<< std::setw(24) << "<Total>"
+	<< std::right << std::setw(10) << ""
+	<< std::setw(10) << ""
+	<< std::setw(14) << last_object_bytes[i]
+	<< std::setw(14) << peak_object_bytes[i] << std::endl;
+  }
+}
+
+} // namespace ledger
+
 /**********************************************************************
  *
  * Exception handling
@@ -639,8 +960,32 @@ void finish_timer(const char * name)
 
 namespace ledger {
 
-std::ostringstream _desc_buffer;
-std::ostringstream _ctxt_buffer;
+namespace {
+  THREAD_LOCAL std::ostringstream * desc_buffer = NULL;
+  THREAD_LOCAL std::ostringstream * ctxt_buffer = NULL;
+}
+
+std::ostringstream& error_desc_buffer()
+{
+  if (! desc_buffer)
+    desc_buffer = new std::ostringstream;
+  return *desc_buffer;
+}
+
+std::ostringstream& error_ctxt_buffer()
+{
+  if (! ctxt_buffer)
+    ctxt_buffer = new std::ostringstream;
+  return *ctxt_buffer;
+}
+
+void release_error_buffers()
+{
+  checked_delete(desc_buffer);
+  desc_buffer = NULL;
+  checked_delete(ctxt_buffer);
+  ctxt_buffer = NULL;
+}
 
 } // namespace ledger
 
@@ -81,6 +81,20 @@
 #define TIMERS_ON   1
 #endif
 
+/**
+ * THREAD_LOCAL marks plain-data statics (pointers, integers, mpz_t
+ * scratch) which each thread must have a copy of, so that separate
+ * sessions can run at the same time.  It cannot be used on objects
+ * with constructors; keep those in the session and point at them.
+ */
+#if defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL
+#endif
+
 /**********************************************************************
  *
  * Forward declarations
@@ -155,6 +169,11 @@ extern bool verify_enabled;
 void initialize_memory_tracing();
 void shutdown_memory_tracing();
 
+// Incremented by every call to operator new, whether or not --verify
+// is in effect, so that benchmarks can report allocations per item
+// without paying for full memory tracing.
+extern std::size_t allocation_count;
+
 std::size_t current_memory_size();
 std::size_t current_objects_size();
 
@@ -250,6 +269,133 @@ extern ledger::string empty_string;
 
 #define IF_VERIFY() if (DO_VERIFY())
 
+/**********************************************************************
+ *
+ * Object counting (always compiled in, use --memory-stats to report)
+ *
+ * The memory tracing above records every allocation in a map, and so
+ * is only usable in verify mode.  Object counts are far cheaper: each
+ * counted class has one static counter per type, which its
+ * constructors and destructors bump with COUNT_CTOR and COUNT_DTOR.
+ * Peaks are kept separately for each phase of a run.
+ */
+
+namespace ledger {
+
+enum memory_phase_t {
+  PHASE_STARTUP,
+  PHASE_PARSE,
+  PHASE_FINALIZE,
+  PHASE_REPORT,
+  PHASE_TEARDOWN,
+  MEMORY_PHASES
+};
+
+extern memory_phase_t memory_phase;
+
+#if defined(__GNUC__)
+#define COUNT_ADD(var, n) __sync_add_and_fetch(&(var), (n))
+#define COUNT_SUB(var, n) __sync_sub_and_fetch(&(var), (n))
+#else
+#define COUNT_ADD(var, n) ((var) += (n))
+#define COUNT_SUB(var, n) ((var) -= (n))
+#endif
+
+// Raise a peak to the given level, unless another thread has already
+// raised it further.
+inline void count_peak(std::size_t& peak, std::size_t now)
+{
+#if defined(__GNUC__)
+  std::size_t prev = peak;
+  while (now > prev) {
+    std::size_t seen = __sync_val_compare_and_swap(&peak, prev, now);
+    if (seen == prev)
+      break;
+    prev = seen;
+  }
+#else
+  if (now > peak)
+    peak = now;
+#endif
+}
+
+extern std::size_t live_object_bytes;
+extern std::size_t peak_object_bytes[MEMORY_PHASES];
+
+struct object_count_t
+{
+  const char *	   name;
+  std::size_t	   size;
+  std::size_t	   live;
+  std::size_t	   peak[MEMORY_PHASES];
+  std::size_t	   last[MEMORY_PHASES];
+  object_count_t * next;
+
+  // Objects may be made on several threads at once (see
+  // journal_t::add_entries), so counts and peaks are updated atomically
+  // where the compiler allows it.  The size is passed in each time,
+  // since a thread which loses the race to register the counter cannot
+  // rely on `size' having been set yet.
+  void add_object(const char * cls_name, std::size_t cls_size) {
+    if (! name)
+      register_object_count(cls_name, cls_size);
+
+    count_peak(peak[memory_phase], COUNT_ADD(live, 1));
+    count_peak(peak_object_bytes[memory_phase],
+	       COUNT_ADD(live_object_bytes, cls_size));
+  }
+  void remove_object(std::size_t cls_size) {
+    assert(live > 0);
+    COUNT_SUB(live, 1);
+    COUNT_SUB(live_object_bytes, cls_size);
+  }
+
+  void register_object_count(const char * cls_name, std::size_t cls_size);
+};
+
+// The counter is constant-initialized, so it is valid even for objects
+// constructed during static initialization.
+template <typename T>
+struct object_counter
+{
+  static object_count_t count;
+};
+
+template <typename T>
+object_count_t object_counter<T>::count = {
+  NULL, 0, 0, { 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0 }, NULL
+};
+
+#define COUNT_CTOR(cls) \
+  (ledger::object_counter<cls>::count.add_object(#cls, sizeof(cls)))
+#define COUNT_DTOR(cls) \
+  (ledger::object_counter<cls>::count.remove_object(sizeof(cls)))
+
+extern bool memory_stats_enabled;
+
+void set_memory_phase(memory_phase_t phase);
+void report_memory_stats(std::ostream& out);
+
+/**
+ * Switch to the given phase for the lifetime of this object, returning
+ * to the previous phase afterward.
+ */
+class memory_phase_scope_t : public noncopyable
+{
+  memory_phase_t prev_phase;
+
+public:
+  explicit memory_phase_scope_t(memory_phase_t phase)
+    : prev_phase(memory_phase) {
+    set_memory_phase(phase);
+  }
+  ~memory_phase_scope_t() {
+    set_memory_phase(prev_phase);
+  }
+};
+
+} // namespace ledger
+
 /**********************************************************************
  *
  * Logging
@@ -461,6 +607,90 @@ void finish_timer(const char * name);
 
 #endif // TIMERS_ON
 
+/**********************************************************************
+ *
+ * Profiling (always compiled in, use --profile to enable)
+ *
+ * Unlike the timers above, which are keyed by name and only active
+ * when logging, a profile site is a static object at the point of
+ * instrumentation, so entering a scope costs one branch when
+ * profiling is off, and two clock reads when it is on.  Scopes nest:
+ * each site records its total time, plus its self time excluding any
+ * nested scopes.  Scopes nest per thread, and a site's counters are
+ * updated atomically, so sites may be entered on several threads at
+ * once; their times are then summed over all of them.
+ */
+
+namespace ledger {
+
+typedef boost::uint64_t profile_ticks_t; // nanoseconds
+
+extern bool profiling_enabled;
+
+profile_ticks_t profile_clock();
+
+struct profile_site_t : public noncopyable
+{
+  std::string	   name;
+  std::size_t	   calls;
+  profile_ticks_t  total;
+  profile_ticks_t  self;
+  profile_site_t * next;
+
+  explicit profile_site_t(const std::string& _name);
+};
+
+/**
+ * Return the site registered under `name', creating it if need be.
+ * This is for sites whose names are only known at runtime, such as
+ * one per item_handler type; the lookup is linear, so callers should
+ * hold on to the result.
+ */
+profile_site_t& profile_site(const std::string& name);
+profile_site_t& profile_site(const std::type_info& type);
+
+void report_profile(std::ostream& out);
+void shutdown_profiling();
+
+class profile_scope_t : public noncopyable
+{
+  profile_site_t *  site;
+  profile_scope_t * parent;
+  profile_ticks_t   begin;
+  profile_ticks_t   nested;
+  bool		    outermost;
+
+  static THREAD_LOCAL profile_scope_t * current;
+
+  void enter(std::size_t count);
+  void leave();
+
+public:
+  explicit profile_scope_t(profile_site_t& _site, std::size_t count = 1)
+    : site(NULL) {
+    if (profiling_enabled) {
+      site = &_site;
+      enter(count);
+    }
+  }
+  ~profile_scope_t() {
+    if (site)
+      leave();
+  }
+};
+
+} // namespace ledger
+
+#define PROFILE_CAT_(a, b) a ## b
+#define PROFILE_CAT(a, b)  PROFILE_CAT_(a, b)
+
+#define PROFILE_SCOPE(name)						\
+  static ledger::profile_site_t						\
+    PROFILE_CAT(_profile_site_, __LINE__)(name);			\
+  ledger::profile_scope_t						\
+    PROFILE_CAT(_profile_scope_, __LINE__)				\
+      (PROFILE_CAT(_profile_site_, __LINE__))
+
 /**********************************************************************
  *
  * - Exception handling helpers
@@ -505,11 +735,65 @@ inline char * skip_ws(char * ptr) {
   return ptr;
 }
 
-inline char * next_element(char * buf, bool variable = false) {
-  for (char * p = buf; *p; p++) {
-    if (! (*p == ' ' || *p == '\t'))
-      continue;
+/**
+ * find_blank reads whole aligned blocks, which may start before ptr and
+ * run past the terminating NUL.  That cannot fault, but AddressSanitizer
+ * and MemorySanitizer would report it, so they leave the function alone.
+ */
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SCAN_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#endif
+#if __has_feature(memory_sanitizer)
+#define SCAN_NO_SANITIZE_MEMORY  __attribute__((no_sanitize_memory))
+#endif
+#elif defined(__SANITIZE_ADDRESS__)
+#define SCAN_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#endif
 
+#if ! defined(SCAN_NO_SANITIZE_ADDRESS)
+#define SCAN_NO_SANITIZE_ADDRESS
+#endif
+#if ! defined(SCAN_NO_SANITIZE_MEMORY)
+#define SCAN_NO_SANITIZE_MEMORY
+#endif
+
+/**
+ * @brief Return the first space, tab or NUL at or after ptr.
+ *
+ * With SSE2 this tests sixteen bytes at a time.  Every load is aligned,
+ * so none of them can reach into a page past the terminating NUL.
+ */
+SCAN_NO_SANITIZE_ADDRESS SCAN_NO_SANITIZE_MEMORY
+inline char * find_blank(char * ptr) {
+#if defined(__SSE2__)
+  const __m128i spaces = _mm_set1_epi8(' ');
+  const __m128i tabs   = _mm_set1_epi8('\t');
+  const __m128i nuls   = _mm_setzero_si128();
+
+  std::size_t	  offset = reinterpret_cast<std::size_t>(ptr) & 15;
+  const __m128i * block  = reinterpret_cast<const __m128i *>(ptr - offset);
+
+  for (unsigned int skip = offset; ; block++, skip = 0) {
+    __m128i bytes = _mm_load_si128(block);
+    __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, spaces),
+					      _mm_cmpeq_epi8(bytes, tabs)),
+				 _mm_cmpeq_epi8(bytes, nuls));
+
+    unsigned int mask = _mm_movemask_epi8(found) >> skip << skip;
+    if (mask)
+      return (const_cast<char *>(reinterpret_cast<const char *>(block)) +
+	      __builtin_ctz(mask));
+  }
+#else
+  while (*ptr && *ptr != ' ' && *ptr != '\t')
+    ptr++;
+  return ptr;
+#endif
+}
+
+inline char * next_element(char * buf, bool variable = false) {
+  for (char * p = find_blank(buf); *p; p = find_blank(p + 1)) {
     if (! variable) {
       *p = '\0';
       return skip_ws(p + 1);
@@ -34,31 +34,11 @@
 
 namespace ledger {
 
-intrusive_ptr<value_t::storage_t> value_t::true_value;
-intrusive_ptr<value_t::storage_t> value_t::false_value;
-
 value_t::storage_t& value_t::storage_t::operator=(const value_t::storage_t& rhs)
 {
   type = rhs.type;
 
   switch (type) {
-  case DATETIME:
-    new(reinterpret_cast<datetime_t *>(data))
-      datetime_t(*reinterpret_cast<datetime_t *>
-		 (const_cast<char *>(rhs.data)));
-    break;
-
-  case DATE:
-    new(reinterpret_cast<date_t *>(data))
-      date_t(*reinterpret_cast<date_t *>(const_cast<char *>(rhs.data)));
-    break;
-
-  case AMOUNT:
-    new(reinterpret_cast<amount_t *>(data))
-      amount_t(*reinterpret_cast<amount_t *>
-	       (const_cast<char *>(rhs.data)));
-    break;
-
   case BALANCE:
     *reinterpret_cast<balance_t **>(data) =
       new balance_t(**reinterpret_cast<balance_t **>
@@ -83,9 +63,8 @@ value_t::storage_t& value_t::storage_t::operator=(const value_t::storage_t& rhs)
     break;
 
   default:
-    // The rest are fundamental types, which can be copied using
-    // std::memcpy
-    std::memcpy(data, rhs.data, sizeof(data));
+    // All other types are kept directly within value_t.
+    assert(false);
     break;
   }
 
@@ -95,9 +74,6 @@ value_t::storage_t& value_t::storage_t::operator=(const value_t::storage_t& rhs)
 void value_t::storage_t::destroy()
 {
   switch (type) {
-  case AMOUNT:
-    reinterpret_cast<amount_t *>(data)->~amount_t();
-    break;
   case BALANCE:
     checked_delete(*reinterpret_cast<balance_t **>(data));
     break;
@@ -110,9 +86,6 @@ void value_t::storage_t::destroy()
   case SEQUENCE:
     checked_delete(*reinterpret_cast<sequence_t **>(data));
     break;
-  case POINTER:
-    reinterpret_cast<boost::any *>(data)->~any();
-    break;
 
   default:
     break;
@@ -126,26 +99,14 @@ void value_t::initialize()
   LOGGER("value.initialize");
 #endif
 
-  true_value = new storage_t;
-  true_value->type = BOOLEAN;
-  *reinterpret_cast<bool *>(true_value->data) = true;
-
-  false_value = new storage_t;
-  false_value->type = BOOLEAN;
-  *reinterpret_cast<bool *>(false_value->data) = false;
-
-#if 0
   BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(bool));
   BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(datetime_t));
   BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(date_t));
   BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(long));
-  BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(amount_t));
-  BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(balance_t *));
-  BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(balance_pair_t *));
-  BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(string));
-  BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(sequence_t *));
   BOOST_STATIC_ASSERT(sizeof(amount_t) >= sizeof(boost::any));
-#endif
+  BOOST_STATIC_ASSERT(sizeof(string) >= sizeof(balance_t *));
+  BOOST_STATIC_ASSERT(sizeof(string) >= sizeof(balance_pair_t *));
+  BOOST_STATIC_ASSERT(sizeof(string) >= sizeof(sequence_t *));
 
   DEBUG_(std::setw(3) << std::right << sizeof(bool)
 	 << "  sizeof(bool)");
@@ -167,19 +128,12 @@ void value_t::initialize()
 	 << "  sizeof(sequence_t *)");
   DEBUG_(std::setw(3) << std::right << sizeof(boost::any)
 	 << "  sizeof(boost::any)");
+  DEBUG_(std::setw(3) << std::right << sizeof(value_t)
+	 << "  sizeof(value_t)");
 }
 
 void value_t::shutdown()
 {
-  true_value  = intrusive_ptr<storage_t>();
-  false_value = intrusive_ptr<storage_t>();
-}
-
-void value_t::_dup()
-{
-  assert(storage);
-  if (storage->refc > 1)
-    storage = new storage_t(*storage.get());
 }
 
 value_t::operator bool() const
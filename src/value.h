@@ -119,6 +119,14 @@ public:
   };
 
 private:
+  /**
+   * Values of type BALANCE, BALANCE_PAIR, STRING and SEQUENCE are
+   * kept in a separately allocated, reference counted storage_t, so
+   * that copying them is cheap.  Everything else -- booleans, dates,
+   * integers, amounts and pointers -- is small enough to live directly
+   * within the value_t itself (see `scalar' below), which saves a heap
+   * allocation every time such a value is created.
+   */
   class storage_t
   {
     friend class value_t;
@@ -133,7 +141,7 @@ private:
      * The `type' member holds the value_t::type_t value representing
      * the type of the object stored.
      */
-    char   data[sizeof(amount_t)];
+    char   data[sizeof(string)];
     type_t type;
 
     /**
@@ -151,6 +159,7 @@ private:
      */
     explicit storage_t() : type(VOID), refc(0) {
       TRACE_CTOR(value_t::storage_t, "");
+      COUNT_CTOR(value_t::storage_t);
     }
 
   public:			// so `checked_delete' can access it
@@ -163,6 +172,7 @@ private:
      */
     ~storage_t() {
       TRACE_DTOR(value_t::storage_t);
+      COUNT_DTOR(value_t::storage_t);
       DEBUG("value.storage.refcount", "Destroying " << this);
       assert(refc == 0);
       destroy();
@@ -178,6 +188,7 @@ private:
     explicit storage_t(const storage_t& rhs)
       : type(rhs.type), refc(0) {
       TRACE_CTOR(value_t::storage_t, "copy");
+      COUNT_CTOR(value_t::storage_t);
       *this = rhs;
     }
     storage_t& operator=(const storage_t& rhs);
@@ -210,22 +221,53 @@ private:
   };
 
   /**
-   * The actual data for each value_t is kept in the `storage' member.
-   * Data is modified using a copy-on-write policy.
+   * `type_' is the type of the value, whether it is held in `scalar'
+   * or in `storage'.
+   */
+  type_t type_;
+
+  /**
+   * Scalar values are kept in `scalar.data'.  The other members of
+   * the union are only there to give it suitable alignment.
+   */
+  union scalar_t {
+    char	   data[sizeof(amount_t)];
+    void *	   align_pointer;
+    boost::int64_t align_int64;
+  } scalar;
+
+  /**
+   * The data for the larger types is kept in the `storage' member,
+   * and is modified using a copy-on-write policy.
    */
   intrusive_ptr<storage_t> storage;
 
+  static bool is_stored_type(type_t _type) {
+    return (_type == BALANCE || _type == BALANCE_PAIR ||
+	    _type == STRING  || _type == SEQUENCE);
+  }
+
   /**
    * _dup() makes a private copy of the current value (if necessary)
-   * so it can subsequently be modified.
+   * so it can subsequently be modified.  Scalar values are never
+   * shared, and so are never copied.
    *
    * _clear() removes our pointer to the current value and initializes
    * a new storage bin for things to be stored in.
    *
    * _reset() makes the current object appear as if it were
    * uninitialized.
+   *
+   * _copy() copies another value into this one, which must be
+   * uninitialized, and _destroy() destroys any scalar value held.
    */
-  void _dup();
+  void _dup() {
+    if (is_stored_type(type_)) {
+      assert(storage);
+      if (storage->refc > 1)
+	storage = new storage_t(*storage.get());
+    }
+  }
   void _clear() {
     if (! storage || storage->refc > 1)
       storage = new storage_t;
@@ -233,17 +275,55 @@ private:
       storage->destroy();
   }
   void _reset() {
+    _destroy();
     if (storage)
       storage = intrusive_ptr<storage_t>();
+    type_ = VOID;
   }
 
-  /**
-   * Because boolean "true" and "false" are so common, a pair of
-   * static references are kept to prevent the creation of throwaway
-   * storage_t objects just to represent these two common values.
-   */
-  static intrusive_ptr<storage_t> true_value;
-  static intrusive_ptr<storage_t> false_value;
+  void _copy(const value_t& val) {
+    assert(type_ == VOID);
+    switch (val.type_) {
+    case DATETIME:
+      new(reinterpret_cast<datetime_t *>(scalar.data))
+	datetime_t(*reinterpret_cast<const datetime_t *>(val.scalar.data));
+      break;
+    case DATE:
+      new(reinterpret_cast<date_t *>(scalar.data))
+	date_t(*reinterpret_cast<const date_t *>(val.scalar.data));
+      break;
+    case AMOUNT:
+      new(reinterpret_cast<amount_t *>(scalar.data))
+	amount_t(*reinterpret_cast<const amount_t *>(val.scalar.data));
+      break;
+    case POINTER:
+      new(reinterpret_cast<boost::any *>(scalar.data))
+	boost::any(*reinterpret_cast<const boost::any *>(val.scalar.data));
+      break;
+    case BALANCE:
+    case BALANCE_PAIR:
+    case STRING:
+    case SEQUENCE:
+      storage = val.storage;
+      break;
+    default:
+      std::memcpy(scalar.data, val.scalar.data, sizeof(scalar.data));
+      break;
+    }
+    type_ = val.type_;
+  }
+  void _destroy() {
+    switch (type_) {
+    case AMOUNT:
+      reinterpret_cast<amount_t *>(scalar.data)->~amount_t();
+      break;
+    case POINTER:
+      reinterpret_cast<boost::any *>(scalar.data)->~any();
+      break;
+    default:
+      break;
+    }
+  }
 
 public:
   static void initialize();
@@ -263,59 +343,59 @@ public:
    * true) is required to represent the literal string "$100", and not
    * the amount "one hundred dollars".
    */
-  value_t() {
+  value_t() : type_(VOID) {
     TRACE_CTOR(value_t, "");
   }
 
-  value_t(const bool val) {
+  value_t(const bool val) : type_(VOID) {
     TRACE_CTOR(value_t, "const bool");
     set_boolean(val);
   }
 
-  value_t(const datetime_t& val) {
+  value_t(const datetime_t& val) : type_(VOID) {
     TRACE_CTOR(value_t, "const datetime_t&");
     set_datetime(val);
   }
-  value_t(const date_t& val) {
+  value_t(const date_t& val) : type_(VOID) {
     TRACE_CTOR(value_t, "const date_t&");
     set_date(val);
   }
 
-  value_t(const long val) {
+  value_t(const long val) : type_(VOID) {
     TRACE_CTOR(value_t, "const long");
     set_long(val);
   }
-  value_t(const unsigned long val) {
+  value_t(const unsigned long val) : type_(VOID) {
     TRACE_CTOR(value_t, "const unsigned long");
     set_amount(val);
   }
 #ifdef HAVE_GDTOA
-  value_t(const double val) {
+  value_t(const double val) : type_(VOID) {
     TRACE_CTOR(value_t, "const double");
     set_amount(val);
   }
 #endif
-  value_t(const amount_t& val) {
+  value_t(const amount_t& val) : type_(VOID) {
     TRACE_CTOR(value_t, "const amount_t&");
     set_amount(val);
   }
-  value_t(const balance_t& val) {
+  value_t(const balance_t& val) : type_(VOID) {
     TRACE_CTOR(value_t, "const balance_t&");
     set_balance(val);
   }
-  value_t(const balance_pair_t& val) {
+  value_t(const balance_pair_t& val) : type_(VOID) {
     TRACE_CTOR(value_t, "const balance_pair_t&");
     set_balance_pair(val);
   }
 
-  explicit value_t(const string& val, bool literal = false) {
+  explicit value_t(const string& val, bool literal = false) : type_(VOID) {
     TRACE_CTOR(value_t, "const string&, bool");
     if (literal)
       set_string(val);
     else
       set_amount(amount_t(val));
   }
-  explicit value_t(const char * val, bool literal = false) {
+  explicit value_t(const char * val, bool literal = false) : type_(VOID) {
     TRACE_CTOR(value_t, "const char *");
     if (literal)
       set_string(val);
@@ -323,38 +403,45 @@ public:
       set_amount(amount_t(val));
   }
 
-  value_t(const sequence_t& val) {
+  value_t(const sequence_t& val) : type_(VOID) {
     TRACE_CTOR(value_t, "const sequence_t&");
     set_sequence(val);
   }
 
   template <typename T>
-  explicit value_t(T * item) {
+  explicit value_t(T * item) : type_(VOID) {
     TRACE_CTOR(value_t, "T *");
     set_pointer(item);
   }
 
   /**
-   * Destructor.  This does not do anything, because the intrusive_ptr
-   * that refers to our storage object will decrease its reference
-   * count itself upon destruction.
+   * Destructor.  Only a scalar value need be destroyed here, since the
+   * intrusive_ptr that refers to our storage object will decrease its
+   * reference count itself upon destruction.
    */
   ~value_t() {
     TRACE_DTOR(value_t);
+    _destroy();
   }
 
   /**
-   * Assignment and copy operators.  Values are cheaply copied by
-   * simply creating another reference to the other value's storage
-   * object.  A true copy is only ever made prior to modification.
+   * Assignment and copy operators.  Scalar values are copied outright;
+   * the other values are cheaply copied by simply creating another
+   * reference to the other value's storage object.  A true copy of
+   * those is only ever made prior to modification.
    */
-  value_t(const value_t& val) {
+  value_t(const value_t& val) : type_(VOID) {
     TRACE_CTOR(value_t, "copy");
-    *this = val;
+    _copy(val);
   }
   value_t& operator=(const value_t& val) {
-    if (! (this == &val || storage == val.storage))
-      storage = val.storage;
+    if (this != &val) {
+      // `val' may live within our own storage (for example, as an
+      // element of a sequence), so copy it before letting go of ours.
+      value_t temp(val);
+      _reset();
+      _copy(temp);
+    }
     return *this;
   }
 
@@ -430,19 +517,13 @@ public:
   bool is_realzero() const;
   bool is_zero() const;
   bool is_null() const {
-    if (! storage) {
-      assert(is_type(VOID));
-      return true;
-    } else {
-      assert(! is_type(VOID));
-      return false;
-    }
+    assert(is_stored_type(type_) ? bool(storage) : ! storage);
+    return type_ == VOID;
   }
 
   type_t type() const {
-    type_t result = storage ? storage->type : VOID;
-    assert(result >= VOID && result <= POINTER);
-    return result;
+    assert(type_ >= VOID && type_ <= POINTER);
+    return type_;
   }
   bool is_type(type_t _type) const {
     return type() == _type;
@@ -451,14 +532,16 @@ public:
 private:
   void set_type(type_t new_type) {
     assert(new_type >= VOID && new_type <= POINTER);
-    if (new_type == VOID) {
-      _reset();
-      assert(is_null());
-    } else {
+    if (is_stored_type(new_type)) {
+      _destroy();
       _clear();
       storage->type = new_type;
-      assert(is_type(new_type));
+      type_	    = new_type;
+    } else {
+      _reset();
+      type_ = new_type;
     }
+    assert(is_type(new_type));
   }
 
 public:
@@ -496,16 +579,15 @@ public:
   }
   bool& as_boolean_lval() {
     assert(is_boolean());
-    _dup();
-    return *reinterpret_cast<bool *>(storage->data);
+    return *reinterpret_cast<bool *>(scalar.data);
   }
   const bool& as_boolean() const {
     assert(is_boolean());
-    return *reinterpret_cast<bool *>(storage->data);
+    return *reinterpret_cast<const bool *>(scalar.data);
   }
   void set_boolean(const bool val) {
     set_type(BOOLEAN);
-    storage = val ? true_value : false_value;
+    *reinterpret_cast<bool *>(scalar.data) = val;
   }
 
   bool is_datetime() const {
@@ -513,16 +595,15 @@ public:
   }
   datetime_t& as_datetime_lval() {
     assert(is_datetime());
-    _dup();
-    return *reinterpret_cast<datetime_t *>(storage->data);
+    return *reinterpret_cast<datetime_t *>(scalar.data);
   }
   const datetime_t& as_datetime() const {
     assert(is_datetime());
-    return *reinterpret_cast<datetime_t *>(storage->data);
+    return *reinterpret_cast<const datetime_t *>(scalar.data);
   }
   void set_datetime(const datetime_t& val) {
     set_type(DATETIME);
-    new(reinterpret_cast<datetime_t *>(storage->data)) datetime_t(val);
+    new(reinterpret_cast<datetime_t *>(scalar.data)) datetime_t(val);
   }
 
   bool is_date() const {
@@ -530,16 +611,15 @@ public:
   }
   date_t& as_date_lval() {
     assert(is_date());
-    _dup();
-    return *reinterpret_cast<date_t *>(storage->data);
+    return *reinterpret_cast<date_t *>(scalar.data);
   }
   const date_t& as_date() const {
     assert(is_date());
-    return *reinterpret_cast<date_t *>(storage->data);
+    return *reinterpret_cast<const date_t *>(scalar.data);
   }
   void set_date(const date_t& val) {
     set_type(DATE);
-    new(reinterpret_cast<date_t *>(storage->data)) date_t(val);
+    new(reinterpret_cast<date_t *>(scalar.data)) date_t(val);
   }
 
   bool is_long() const {
@@ -547,16 +627,15 @@ public:
   }
   long& as_long_lval() {
     assert(is_long());
-    _dup();
-    return *reinterpret_cast<long *>(storage->data);
+    return *reinterpret_cast<long *>(scalar.data);
   }
   const long& as_long() const {
     assert(is_long());
-    return *reinterpret_cast<long *>(storage->data);
+    return *reinterpret_cast<const long *>(scalar.data);
   }
   void set_long(const long val) {
     set_type(INTEGER);
-    *reinterpret_cast<long *>(storage->data) = val;
+    *reinterpret_cast<long *>(scalar.data) = val;
   }
 
   bool is_amount() const {
@@ -564,21 +643,24 @@ public:
   }
   amount_t& as_amount_lval() {
     assert(is_amount());
-    _dup();
-    amount_t& amt(*reinterpret_cast<amount_t *>(storage->data));
+    amount_t& amt(*reinterpret_cast<amount_t *>(scalar.data));
     assert(amt.valid());
     return amt;
   }
   const amount_t& as_amount() const {
     assert(is_amount());
-    amount_t& amt(*reinterpret_cast<amount_t *>(storage->data));
+    const amount_t& amt(*reinterpret_cast<const amount_t *>(scalar.data));
     assert(amt.valid());
     return amt;
   }
   void set_amount(const amount_t& val) {
     assert(val.valid());
-    set_type(AMOUNT);
-    new(reinterpret_cast<amount_t *>(storage->data)) amount_t(val);
+    if (is_amount()) {
+      as_amount_lval() = val;
+    } else {
+      set_type(AMOUNT);
+      new(reinterpret_cast<amount_t *>(scalar.data)) amount_t(val);
+    }
   }
 
   bool is_balance() const {
@@ -676,43 +758,40 @@ public:
   }
   boost::any& as_any_pointer_lval() {
     assert(is_pointer());
-    _dup();
-    return *reinterpret_cast<boost::any *>(storage->data);
+    return *reinterpret_cast<boost::any *>(scalar.data);
   }
   template <typename T>
   T * as_pointer_lval() {
     assert(is_pointer());
-    _dup();
-    return any_cast<T *>(*reinterpret_cast<boost::any *>(storage->data));
+    return any_cast<T *>(*reinterpret_cast<boost::any *>(scalar.data));
   }
   template <typename T>
   T& as_ref_lval() {
     assert(is_pointer());
-    _dup();
-    return *any_cast<T *>(*reinterpret_cast<boost::any *>(storage->data));
+    return *any_cast<T *>(*reinterpret_cast<boost::any *>(scalar.data));
   }
   const boost::any& as_any_pointer() const {
     assert(is_pointer());
-    return *reinterpret_cast<boost::any *>(storage->data);
+    return *reinterpret_cast<const boost::any *>(scalar.data);
   }
   template <typename T>
   T * as_pointer() const {
     assert(is_pointer());
-    return any_cast<T *>(*reinterpret_cast<boost::any *>(storage->data));
+    return any_cast<T *>(*reinterpret_cast<const boost::any *>(scalar.data));
   }
   template <typename T>
   T& as_ref() const {
     assert(is_pointer());
-    return *any_cast<T *>(*reinterpret_cast<boost::any *>(storage->data));
+    return *any_cast<T *>(*reinterpret_cast<const boost::any *>(scalar.data));
   }
   void set_any_pointer(const boost::any& val) {
     set_type(POINTER);
-    new(reinterpret_cast<boost::any *>(storage->data)) boost::any(val);
+    new(reinterpret_cast<boost::any *>(scalar.data)) boost::any(val);
   }
   template <typename T>
   void set_pointer(T * val) {
     set_type(POINTER);
-    new(reinterpret_cast<boost::any *>(storage->data)) boost::any(val);
+    new(reinterpret_cast<boost::any *>(scalar.data)) boost::any(val);
   }
 
   /**
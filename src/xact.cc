@@ -36,6 +36,8 @@
 
 namespace ledger {
 
+THREAD_LOCAL xdata_pool_t<xact_t::xdata_t> * xact_t::xdata_pool = NULL;
+
 optional<date_t> xact_t::actual_date() const
 {
   optional<date_t> date = item_t::actual_date();
@@ -54,6 +56,10 @@ optional<date_t> xact_t::effective_date() const
 
 item_t::state_t xact_t::state() const
 {
+  // The xacts of automated and periodic entries have no entry_t.
+  if (! entry)
+    return _state;
+
   state_t entry_state = entry->state();
   if ((_state == UNCLEARED && entry_state != UNCLEARED) ||
       (_state == PENDING && entry_state == CLEARED))
@@ -83,8 +89,8 @@ namespace {
   }
 
   value_t get_total(xact_t& xact) {
-    if (xact.xdata_)
-      return xact.xdata_->total;
+    if (xact.has_xdata())
+      return xact.xdata().total;
     else
       return xact.amount;
   }
@@ -161,6 +167,17 @@ expr_t::ptr_op_t xact_t::lookup(const string& name)
 #endif
 }
 
+const interned_string_t * xact_t::lookup_interned(const string& name)
+{
+  if (entry) {
+    if (name == "code")
+      return &entry->code;
+    else if (name == "payee")
+      return &entry->payee;
+  }
+  return item_t::lookup_interned(name);
+}
+
 bool xact_t::valid() const
 {
   if (! entry) {
@@ -211,8 +228,8 @@ xact_context::xact_context(const xact_t& _xact, const string& desc) throw()
 
 void xact_t::add_to_value(value_t& value)
 {
-  if (xdata_ && xdata_->has_flags(XACT_EXT_COMPOUND)) {
-    add_or_set_value(value, xdata_->value);
+  if (has_xdata() && xdata().has_flags(XACT_EXT_COMPOUND)) {
+    add_or_set_value(value, xdata().value);
   }
   else if (cost || (! value.is_null() && ! value.is_realzero())) {
     if (value.is_null())
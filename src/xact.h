@@ -33,6 +33,7 @@
 #define _XACT_H
 
 #include "item.h"
+#include "xdata.h"
 
 namespace ledger {
 
@@ -40,7 +41,7 @@ class entry_t;
 class account_t;
 
 class xact_t;
-typedef std::list<xact_t *> xacts_list;
+typedef std::vector<xact_t *> xacts_list;
 
 class xact_t : public item_t
 {
@@ -54,27 +55,57 @@ public:
   account_t *	     account;
 
   amount_t	     amount;	// can be null until finalization
-  optional<expr_t>   amount_expr;
   optional<amount_t> cost;
-  optional<expr_t>   cost_expr;
-  optional<amount_t> assigned_amount;
-  optional<expr_t>   assigned_amount_expr;
+
+  // The members below are used by only a few transactions: those whose
+  // amount or cost was given as an expression, and balance assignments.
+  // They are kept out of line, so that the common transaction carries a
+  // single pointer for all of them.
+  struct details_t
+  {
+    optional<expr_t>   amount_expr;
+    optional<expr_t>   cost_expr;
+    optional<amount_t> assigned_amount;
+    optional<expr_t>   assigned_amount_expr;
+
+    details_t() {
+      TRACE_CTOR(xact_t::details_t, "");
+      COUNT_CTOR(xact_t::details_t);
+    }
+    details_t(const details_t& other)
+      : amount_expr(other.amount_expr),
+	cost_expr(other.cost_expr),
+	assigned_amount(other.assigned_amount),
+	assigned_amount_expr(other.assigned_amount_expr)
+    {
+      TRACE_CTOR(xact_t::details_t, "copy");
+      COUNT_CTOR(xact_t::details_t);
+    }
+    ~details_t() throw() {
+      TRACE_DTOR(xact_t::details_t);
+      COUNT_DTOR(xact_t::details_t);
+    }
+  };
+
+  details_t *	     details_;
 
   xact_t(account_t * _account = NULL,
 	 flags_t     _flags   = ITEM_NORMAL)
     : item_t(_flags),
-      entry(NULL), account(_account)
+      entry(NULL), account(_account), details_(NULL)
   {
     TRACE_CTOR(xact_t, "account_t *, flags_t");
+    COUNT_CTOR(xact_t);
   }
   xact_t(account_t *	         _account,
 	 const amount_t&         _amount,
 	 flags_t                 _flags = ITEM_NORMAL,
 	 const optional<string>& _note = none)
     : item_t(_flags, _note),
-      entry(NULL), account(_account), amount(_amount)
+      entry(NULL), account(_account), amount(_amount), details_(NULL)
   {
     TRACE_CTOR(xact_t, "account_t *, const amount_t&, flags_t, const optional<string>&");
+    COUNT_CTOR(xact_t);
   }
   xact_t(const xact_t& xact)
     : item_t(xact),
@@ -82,12 +113,42 @@ public:
       account(xact.account),
       amount(xact.amount),
       cost(xact.cost),
-      xdata_(xact.xdata_)    // jww (2008-07-19): What are the copy semantics?
+      details_(NULL)
   {
     TRACE_CTOR(xact_t, "copy");
+    COUNT_CTOR(xact_t);
+
+    // jww (2008-07-19): What are the copy semantics?
+    if (xact.has_xdata())
+      xdata() = xdata_t((*xdata_pool)[xact.xdata_]);
   }
   ~xact_t() {
     TRACE_DTOR(xact_t);
+    COUNT_DTOR(xact_t);
+    checked_delete(details_);
+  }
+
+  bool has_details() const {
+    return details_ != NULL;
+  }
+  details_t& details() {
+    if (! details_)
+      details_ = new details_t;
+    return *details_;
+  }
+  const details_t& details() const {
+    assert(details_);
+    return *details_;
+  }
+
+  bool has_amount_expr() const {
+    return details_ && details_->amount_expr;
+  }
+  bool has_cost_expr() const {
+    return details_ && details_->cost_expr;
+  }
+  bool has_assigned_amount() const {
+    return details_ && details_->assigned_amount;
   }
 
   virtual optional<date_t> actual_date() const;
@@ -100,6 +161,7 @@ public:
   }
 
   virtual expr_t::ptr_op_t lookup(const string& name);
+  virtual const interned_string_t * lookup_interned(const string& name);
 
   bool valid() const;
 
@@ -126,6 +188,7 @@ public:
 
     xdata_t() : supports_flags<>(), index(0), account(NULL), ptr(NULL) {
       TRACE_CTOR(xact_t::xdata_t, "");
+      COUNT_CTOR(xact_t::xdata_t);
     }
     xdata_t(const xdata_t& other)
       : supports_flags<>(other.flags()),
@@ -138,9 +201,11 @@ public:
 	ptr(NULL)
     {
       TRACE_CTOR(xact_t::xdata_t, "copy");
+      COUNT_CTOR(xact_t::xdata_t);
     }
     ~xdata_t() throw() {
       TRACE_DTOR(xact_t::xdata_t);
+      COUNT_DTOR(xact_t::xdata_t);
     }
 
     void remember_xact(xact_t& xact) {
@@ -166,35 +231,41 @@ public:
 #endif
   };
 
-  // This variable holds optional "extended data" which is usually produced
-  // only during reporting, and only for the transaction set being reported.
-  // It's a memory-saving measure to delay allocation until the last possible
-  // moment.
-  mutable optional<xdata_t> xdata_;
+  // This variable refers to optional "extended data" which is usually
+  // produced only during reporting, and only for the transaction set being
+  // reported.  The data itself lives in xdata_pool, which is reset once
+  // the report is done (see session_t::clean_xacts).  The pool belongs
+  // to the current session, so this points at a per-thread copy.
+  static THREAD_LOCAL xdata_pool_t<xdata_t> * xdata_pool;
+
+  mutable xdata_pool_t<xdata_t>::handle_t xdata_;
 
   bool has_xdata() const {
-    return xdata_;
+    return xdata_pool->valid(xdata_);
   }
   void clear_xdata() {
-    xdata_ = none;
+    xdata_pool->release(xdata_);
   }
   xdata_t& xdata() {
-    if (! xdata_)
-      xdata_ = xdata_t();
-    return *xdata_;
+    if (! has_xdata())
+      return xdata_pool->acquire(xdata_);
+    return (*xdata_pool)[xdata_];
+  }
+  const xdata_t& xdata() const {
+    return (*xdata_pool)[xdata_];
   }
 
   void add_to_value(value_t& value);
 
   date_t reported_date() const {
-    if (xdata_ && is_valid(xdata_->date))
-      return xdata_->date;
+    if (has_xdata() && is_valid(xdata().date))
+      return xdata().date;
     return *date();
   }
 
   account_t * reported_account() {
-    if (xdata_)
-      if (account_t * acct = xdata_->account)
+    if (has_xdata())
+      if (account_t * acct = xdata().account)
 	return acct;
     return account;
   }
@@ -204,6 +275,9 @@ public:
   }
 
   friend class entry_t;
+
+private:
+  xact_t& operator=(const xact_t&);
 };
 
 } // namespace ledger
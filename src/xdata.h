@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2003-2008, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _XDATA_H
+#define _XDATA_H
+
+#include "utils.h"
+
+namespace ledger {
+
+// Transactions and accounts carry "extended data" -- running totals,
+// sort values, display flags -- only while a report is being produced.
+// Rather than each item owning an optional copy, which then has to be
+// destroyed item by item once the report is done, the data for every
+// item of a kind lives in one pool.  An item refers to its slot by a
+// dense index, tagged with the pool's generation at the time the slot
+// was handed out.  Resetting the pool starts a new generation, which
+// invalidates every outstanding handle at once; the slots themselves
+// are kept, and reused by the next report.
+//
+// Once a journal is frozen (see session_t::freeze), each of its items
+// instead holds a fixed id, and never has its handle written again.
+// The pool then keeps that item's data in a side table indexed by id,
+// stamping each entry with the generation it was made in.  Since the
+// items are left untouched, several pools -- one per thread -- can
+// report on the same frozen journal at once.
+
+template <typename T>
+class xdata_pool_t : public noncopyable
+{
+public:
+  struct handle_t
+  {
+    unsigned int index;
+    unsigned int generation;
+
+    handle_t() : index(0), generation(0) {}
+  };
+
+  // The generation a frozen handle carries; its index is then an id.
+  static const unsigned int frozen = ~0U;
+
+private:
+  std::deque<T> slots;		// a deque, so slots never move
+  std::size_t	used;
+  unsigned int	generation;
+
+  std::deque<T>		    fixed_slots; // indexed by frozen id
+  std::vector<unsigned int> fixed_stamps;
+
+public:
+  xdata_pool_t() : used(0), generation(1) {}
+
+  static void freeze(handle_t& handle, unsigned int id) {
+    handle.index      = id;
+    handle.generation = frozen;
+  }
+
+  bool valid(const handle_t& handle) const {
+    if (handle.generation == frozen)
+      return (handle.index < fixed_stamps.size() &&
+	      fixed_stamps[handle.index] == generation);
+    return handle.generation == generation;
+  }
+
+  T& operator[](const handle_t& handle) {
+    assert(valid(handle));
+    if (handle.generation == frozen)
+      return fixed_slots[handle.index];
+    return slots[handle.index];
+  }
+
+  T& acquire(handle_t& handle) {
+    if (handle.generation == frozen) {
+      if (handle.index >= fixed_slots.size()) {
+	fixed_slots.resize(handle.index + 1);
+	fixed_stamps.resize(handle.index + 1, 0);
+      } else {
+	fixed_slots[handle.index] = T();
+      }
+      fixed_stamps[handle.index] = generation;
+      return fixed_slots[handle.index];
+    }
+
+    if (used < slots.size())
+      slots[used] = T();
+    else
+      slots.push_back(T());
+
+    handle.index      = used++;
+    handle.generation = generation;
+
+    return slots[handle.index];
+  }
+
+  // A released slot is not reused until the pool is next reset.
+  void release(handle_t& handle) {
+    if (handle.generation == frozen) {
+      if (handle.index < fixed_stamps.size())
+	fixed_stamps[handle.index] = 0;
+    } else {
+      handle.generation = 0;
+    }
+  }
+
+  void reset() {
+    used = 0;
+    if (++generation == frozen) {
+      // Wrapping around would revive stale stamps, so forget them.
+      std::fill(fixed_stamps.begin(), fixed_stamps.end(), 0U);
+      generation = 1;
+    }
+  }
+
+  void clear() {
+    reset();
+    slots.clear();
+    fixed_slots.clear();
+    fixed_stamps.clear();
+  }
+
+  std::size_t size() const {
+    return used;
+  }
+  std::size_t capacity() const {
+    return slots.size();
+  }
+};
+
+} // namespace ledger
+
+#endif // _XDATA_H
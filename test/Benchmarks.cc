@@ -0,0 +1,614 @@
+#include "ledger.h"
+
+#include <cstdlib>
+
+using namespace ledger;
+
+// Benchmarks for the parse -> report pipeline.  A synthetic journal is
+// generated first, according to the sizes given on the command-line,
+// and every benchmark is then run against it.  Results are written to
+// stdout as one tab-separated line per benchmark, so that runs can be
+// compared mechanically:
+//
+//   name  items  seconds  items/sec  allocs/item
+//
+// The journal is written to bench-data, or to the directory given with
+// --dir, and removed again when the run is over.
+
+#if defined(VERIFY_ON)
+
+// Ledger's own operator new already counts allocations.
+
+namespace {
+  std::size_t current_allocations()
+  {
+    return allocation_count;
+  }
+}
+
+#else // VERIFY_ON
+
+// Without VERIFY_ON nothing counts allocations, so the benchmark
+// replaces the global operator new for that purpose.
+
+namespace {
+  std::size_t bench_allocation_count = 0;
+
+  std::size_t current_allocations()
+  {
+    return bench_allocation_count;
+  }
+}
+
+void * operator new(std::size_t size) throw (std::bad_alloc) {
+  void * ptr = std::malloc(size ? size : 1);
+  if (! ptr)
+    throw std::bad_alloc();
+  ++bench_allocation_count;
+  return ptr;
+}
+void * operator new(std::size_t size, const std::nothrow_t&) throw() {
+  void * ptr = std::malloc(size ? size : 1);
+  if (ptr)
+    ++bench_allocation_count;
+  return ptr;
+}
+void * operator new[](std::size_t size) throw (std::bad_alloc) {
+  void * ptr = std::malloc(size ? size : 1);
+  if (! ptr)
+    throw std::bad_alloc();
+  ++bench_allocation_count;
+  return ptr;
+}
+void * operator new[](std::size_t size, const std::nothrow_t&) throw() {
+  void * ptr = std::malloc(size ? size : 1);
+  if (ptr)
+    ++bench_allocation_count;
+  return ptr;
+}
+void   operator delete(void * ptr) throw() {
+  std::free(ptr);
+}
+void   operator delete(void * ptr, const std::nothrow_t&) throw() {
+  std::free(ptr);
+}
+void   operator delete[](void * ptr) throw() {
+  std::free(ptr);
+}
+void   operator delete[](void * ptr, const std::nothrow_t&) throw() {
+  std::free(ptr);
+}
+
+#endif // VERIFY_ON
+
+namespace {
+
+  struct bench_config_t
+  {
+    std::size_t entries;
+    std::size_t accounts;
+    std::size_t commodities;
+    std::size_t prices;
+    std::size_t files;
+    std::size_t iterations;
+    unsigned	seed;
+    path	directory;
+    string	only;
+
+    bench_config_t()
+      : entries(5000), accounts(200), commodities(10), prices(1000),
+	files(4), iterations(1), seed(1), directory("bench-data") {}
+  };
+
+  class bench_timer_t
+  {
+    const bench_config_t& config;
+    string		  name;
+    ptime		  begin;
+    std::size_t		  allocs;
+
+  public:
+    bench_timer_t(const bench_config_t& _config, const string& _name)
+      : config(_config), name(_name),
+	begin(posix_time::microsec_clock::universal_time()),
+	allocs(current_allocations()) {}
+
+    void finish(std::size_t items)
+    {
+      time_duration spent =
+	posix_time::microsec_clock::universal_time() - begin;
+      std::size_t   used  = current_allocations() - allocs;
+      double	    secs  = spent.total_microseconds() / 1000000.0;
+
+      std::cout << name << '\t' << items << '\t'
+		<< std::fixed << std::setprecision(6) << secs << '\t'
+		<< std::setprecision(1)
+		<< (secs > 0.0 ? items / secs : 0.0) << '\t'
+		<< std::setprecision(2)
+		<< (items > 0 ? double(used) / items : 0.0) << std::endl;
+    }
+  };
+
+  bool wanted(const bench_config_t& config, const string& name)
+  {
+    return config.only.empty() || name.find(config.only) == 0;
+  }
+
+  // A small linear congruential generator, so that the same seed
+  // produces the same journal on every platform.
+  class bench_random_t
+  {
+    unsigned long state;
+
+  public:
+    bench_random_t(unsigned seed) : state(seed) {}
+
+    std::size_t operator()(std::size_t limit) {
+      state = (state * 1103515245UL + 12345UL) & 0x7fffffffUL;
+      return limit ? (state >> 4) % limit : 0;
+    }
+  };
+
+  string commodity_symbol(std::size_t index)
+  {
+    string symbol("X");
+    do {
+      symbol += char('A' + index % 26);
+      index /= 26;
+    } while (index > 0);
+    return symbol;
+  }
+
+  string account_name(std::size_t index)
+  {
+    std::ostringstream name;
+    name << "Expenses:Category" << (index % 10) << ":Account" << index;
+    return name.str();
+  }
+
+  void write_amount(std::ostream& out, bench_random_t& random)
+  {
+    out << (random(100000) + 1) / 100 << '.'
+	<< std::setw(2) << std::setfill('0') << random(100)
+	<< std::setfill(' ');
+  }
+
+  // Removes the generated journal once the benchmarks are done.  The
+  // directory itself only goes if it was created for them, so that
+  // pointing --dir at an existing directory leaves the rest of it be.
+  struct bench_files_t
+  {
+    path	    directory;
+    bool	    created;
+    std::list<path> files;
+
+    bench_files_t(const path& _directory)
+      : directory(_directory), created(! exists(_directory)) {}
+
+    ~bench_files_t() {
+      try {
+	foreach (const path& pathname, files)
+	  boost::filesystem::remove(pathname);
+	if (created)
+	  boost::filesystem::remove(directory);
+      }
+      catch (...) {}
+    }
+  };
+
+  // Write the synthetic journal.  Prices go into the first file, and
+  // the entries are spread evenly over the remaining ones; since the
+  // textual parser does not yet honor "!include", the fan-out is
+  // exercised by reading each file into the same journal in turn.
+  std::list<path> generate_journal(const bench_config_t& config)
+  {
+    std::list<path> files;
+    bench_random_t  random(config.seed);
+
+    if (! exists(config.directory))
+      boost::filesystem::create_directory(config.directory);
+
+    date_t start(2000, 1, 1);
+
+    files.push_back(config.directory / "prices.dat");
+    if (config.commodities > 0) {
+      ofstream out(files.back());
+      for (std::size_t i = 0; i < config.prices; i++) {
+	date_t when = start + gregorian::days(long(i % 3650));
+	out << "P " << format_date(when, string("%Y/%m/%d")) << ' '
+	    << commodity_symbol(random(config.commodities)) << " $";
+	write_amount(out, random);
+	out << '\n';
+      }
+    }
+
+    std::size_t per_file = config.entries / config.files + 1;
+    std::size_t written  = 0;
+
+    for (std::size_t f = 0; f < config.files; f++) {
+      std::ostringstream name;
+      name << "journal-" << f << ".dat";
+      files.push_back(config.directory / name.str());
+
+      ofstream out(files.back());
+      for (std::size_t i = 0;
+	   i < per_file && written < config.entries;
+	   i++, written++) {
+	date_t when = start + gregorian::days(long(written * 3650 /
+						   (config.entries + 1)));
+	out << format_date(when, string("%Y/%m/%d"))
+	    << " Payee " << random(config.accounts * 4) << '\n';
+
+	std::size_t postings = 1 + random(3);
+	for (std::size_t p = 0; p < postings; p++) {
+	  out << "    " << account_name(random(config.accounts)) << "  ";
+	  if (config.commodities > 0 && random(4) == 0) {
+	    out << (random(50) + 1) << ' '
+		<< commodity_symbol(random(config.commodities)) << " @ $";
+	    write_amount(out, random);
+	  } else {
+	    out << '$';
+	    write_amount(out, random);
+	  }
+	  out << '\n';
+	}
+	out << "    Assets:Checking\n\n";
+      }
+    }
+    return files;
+  }
+
+  std::size_t read_files(session_t& session, journal_t& journal,
+			 const std::list<path>& files)
+  {
+    std::size_t count = 0;
+    foreach (const path& pathname, files)
+      count += session.read_journal(journal, pathname);
+    return count;
+  }
+
+  void collect_xacts(session_t& session, std::vector<xact_t *>& xacts)
+  {
+    session_xacts_iterator walker(session);
+    while (xact_t * xact = walker())
+      xacts.push_back(xact);
+  }
+
+  void bench_parse(session_t& session, const bench_config_t& config,
+		   const std::list<path>& files)
+  {
+    // Every iteration but the last throws its journal away; the final
+    // one is kept for the remaining benchmarks.
+    bench_timer_t timer(config, "parse.textual");
+    std::size_t	  count = 0;
+    for (std::size_t i = 0; i < config.iterations; i++) {
+      journal_t * journal = session.create_journal();
+      count += read_files(session, *journal, files);
+      if (i + 1 < config.iterations)
+	session.close_journal(journal);
+    }
+    timer.finish(count);
+  }
+
+  void bench_amounts(const bench_config_t& config,
+		     const std::vector<xact_t *>& xacts)
+  {
+    amount_t two(2L);
+    amount_t three(3L);
+
+    bench_timer_t timer(config, "amount.arithmetic");
+    std::size_t	  count = 0;
+    for (std::size_t i = 0; i < config.iterations; i++) {
+      foreach (xact_t * xact, xacts) {
+	if (xact->amount.is_null())
+	  continue;
+	amount_t temp(xact->amount);
+	temp *= two;
+	temp += xact->amount;
+	temp /= three;
+	count += 3;
+      }
+    }
+    timer.finish(count);
+  }
+
+  void bench_amount_print(const bench_config_t& config,
+			  const std::vector<xact_t *>& xacts)
+  {
+    bench_timer_t timer(config, "amount.print");
+    std::size_t	  count = 0;
+    for (std::size_t i = 0; i < config.iterations; i++) {
+      std::ostringstream out;
+      foreach (xact_t * xact, xacts) {
+	if (xact->amount.is_null())
+	  continue;
+	xact->amount.print(out);
+	count++;
+      }
+    }
+    timer.finish(count);
+  }
+
+  void bench_balances(const bench_config_t& config,
+		      const std::vector<xact_t *>& xacts)
+  {
+    bench_timer_t timer(config, "balance.accumulate");
+    std::size_t	  count = 0;
+    for (std::size_t i = 0; i < config.iterations; i++) {
+      balance_t total;
+      foreach (xact_t * xact, xacts) {
+	if (xact->amount.is_null())
+	  continue;
+	total += xact->amount;
+	if (xact->cost)
+	  total += *xact->cost;
+	count++;
+      }
+    }
+    timer.finish(count);
+  }
+
+  void bench_expr(const bench_config_t& config,
+		  const std::vector<xact_t *>& xacts)
+  {
+    expr_t expr("amount * 2 + amount");
+
+    bench_timer_t timer(config, "expr.calc");
+    std::size_t	  count = 0;
+    for (std::size_t i = 0; i < config.iterations; i++) {
+      foreach (xact_t * xact, xacts) {
+	expr.calc(*xact);
+	count++;
+      }
+    }
+    timer.finish(count);
+  }
+
+  void bench_format(session_t& session, const bench_config_t& config,
+		    const std::vector<xact_t *>& xacts)
+  {
+    // Only the first line of the register format is used, which is
+    // what format_xacts prints for the first posting of each entry.
+    string    text(session.register_format);
+    format_t  format(string(text, 0, text.find("%/")));
+
+    bench_timer_t timer(config, "format.register_line");
+    std::size_t	  count = 0;
+    for (std::size_t i = 0; i < config.iterations; i++) {
+      std::ostringstream out;
+      foreach (xact_t * xact, xacts) {
+	format.format(out, *xact);
+	count++;
+      }
+    }
+    timer.finish(count);
+    session.clean_xacts();
+  }
+
+  std::size_t walk_xacts(const entries_list& entries)
+  {
+    std::size_t count = 0;
+    foreach (entry_t * entry, entries)
+      foreach (xact_t * xact, entry->xacts)
+	if (xact->account && xact->_state != item_t::PENDING &&
+	    ! xact->amount.is_null())
+	  count++;
+    return count;
+  }
+
+  // Walks every transaction, entry by entry, reading the fields a report
+  // looks at first.  "xacts.walk.arena" does this over the journal as
+  // parsed, whose transactions lie together in its arena;
+  // "xacts.walk.heap" over copies of the same entries, whose transactions
+  // were allocated one at a time among other objects, as the parser used
+  // to leave them.
+  void bench_walk(session_t& session, const bench_config_t& config)
+  {
+    bench_random_t	random(config.seed);
+    entries_list	copies;
+    std::vector<char *> padding;
+
+    foreach (journal_t& journal, session.journals)
+      foreach (entry_t * entry, journal.entries) {
+	entry_t * copy = new entry_t;
+	foreach (xact_t * xact, entry->xacts) {
+	  copy->add_xact(new xact_t(*xact));
+	  padding.push_back(new char[16 + random(96)]);
+	}
+	copies.push_back(copy);
+      }
+
+    std::size_t count = 0;
+    {
+      bench_timer_t timer(config, "xacts.walk.heap");
+      for (std::size_t i = 0; i < config.iterations; i++)
+	count += walk_xacts(copies);
+      timer.finish(count);
+    }
+    count = 0;
+    {
+      bench_timer_t timer(config, "xacts.walk.arena");
+      for (std::size_t i = 0; i < config.iterations; i++)
+	foreach (journal_t& journal, session.journals)
+	  count += walk_xacts(journal.entries);
+      timer.finish(count);
+    }
+
+    foreach (entry_t * copy, copies)
+      checked_delete(copy);
+    foreach (char * bytes, padding)
+      checked_array_delete(bytes);
+  }
+
+  // Report objects compile their expressions against the first scope
+  // they see, so each run gets a fresh one, just as a separate
+  // invocation of ledger would.
+  report_t& fresh_report(session_t& session, std::ostream& out)
+  {
+    session.current_report.reset(new report_t(session));
+    session.current_report->output_stream = &out;
+    return *session.current_report;
+  }
+
+  void bench_reports(session_t& session, const bench_config_t& config,
+		     const std::size_t xacts_count)
+  {
+    if (wanted(config, "report.balance")) {
+      bench_timer_t timer(config, "report.balance");
+      for (std::size_t i = 0; i < config.iterations; i++) {
+	std::ostringstream out;
+	report_t& report(fresh_report(session, out));
+	report.display_predicate = "total&depth<=1";
+	report.accounts_report
+	  (acct_handler_ptr(new format_accounts(report,
+						session.balance_format)));
+	session.clean_xacts();
+	session.clean_accounts();
+      }
+      timer.finish(xacts_count * config.iterations);
+    }
+
+    if (wanted(config, "report.register")) {
+      bench_timer_t timer(config, "report.register");
+      for (std::size_t i = 0; i < config.iterations; i++) {
+	std::ostringstream out;
+	report_t& report(fresh_report(session, out));
+	report.display_predicate = "amount";
+	report.xacts_report
+	  (xact_handler_ptr(new format_xacts(report,
+					     session.register_format)));
+	session.clean_xacts();
+      }
+      timer.finish(xacts_count * config.iterations);
+    }
+
+    if (wanted(config, "report.csv")) {
+      bench_timer_t timer(config, "report.csv");
+      for (std::size_t i = 0; i < config.iterations; i++) {
+	std::ostringstream out;
+	report_t& report(fresh_report(session, out));
+	report.xacts_report
+	  (xact_handler_ptr(new format_csv_xacts(out, "date,payee,account,"
+						 "quantity,commodity")));
+	session.clean_xacts();
+      }
+      timer.finish(xacts_count * config.iterations);
+    }
+
+    if (wanted(config, "report.export")) {
+      bench_timer_t timer(config, "report.export");
+      for (std::size_t i = 0; i < config.iterations; i++) {
+	std::ostringstream out;
+	report_t& report(fresh_report(session, out));
+	report.xacts_report
+	  (xact_handler_ptr(new format_columnar_xacts(out)));
+	session.clean_xacts();
+      }
+      timer.finish(xacts_count * config.iterations);
+    }
+  }
+
+  bool parse_size(int argc, char * argv[], int& i, const char * name,
+		  std::size_t& value)
+  {
+    if (std::strcmp(argv[i], name) != 0)
+      return false;
+    if (i + 1 >= argc)
+      throw_(std::invalid_argument, "Missing argument to " << name);
+    value = lexical_cast<std::size_t>(argv[++i]);
+    return true;
+  }
+
+  void parse_arguments(int argc, char * argv[], bench_config_t& config)
+  {
+    for (int i = 1; i < argc; i++) {
+      std::size_t seed = config.seed;
+      if (parse_size(argc, argv, i, "--entries", config.entries) ||
+	  parse_size(argc, argv, i, "--accounts", config.accounts) ||
+	  parse_size(argc, argv, i, "--commodities", config.commodities) ||
+	  parse_size(argc, argv, i, "--prices", config.prices) ||
+	  parse_size(argc, argv, i, "--files", config.files) ||
+	  parse_size(argc, argv, i, "--iterations", config.iterations))
+	continue;
+      else if (parse_size(argc, argv, i, "--seed", seed))
+	config.seed = seed;
+      else if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+	config.directory = argv[++i];
+      else if (argv[i][0] != '-')
+	config.only = argv[i];
+      else
+	throw_(std::invalid_argument,
+	       "Unrecognized benchmark option '" << argv[i] << "'");
+    }
+
+    if (config.files == 0)
+      config.files = 1;
+    if (config.accounts == 0)
+      config.accounts = 1;
+    if (config.iterations == 0)
+      config.iterations = 1;
+  }
+}
+
+int main(int argc, char * argv[])
+{
+  try {
+    bench_config_t config;
+    parse_arguments(argc, argv, config);
+
+    session_t session;
+    set_session_context(&session);
+
+    session.register_parser(new textual_parser_t);
+    session.current_report.reset(new report_t(session));
+
+    bench_files_t   data(config.directory);
+    std::list<path> files = generate_journal(config);
+    data.files = files;
+
+    std::cout << "# entries=" << config.entries
+	      << " accounts=" << config.accounts
+	      << " commodities=" << config.commodities
+	      << " prices=" << config.prices
+	      << " files=" << config.files
+	      << " iterations=" << config.iterations << std::endl;
+    std::cout << "# name\titems\tseconds\titems/sec\tallocs/item"
+	      << std::endl;
+
+    if (wanted(config, "parse.textual"))
+      bench_parse(session, config, files);
+    else
+      read_files(session, *session.create_journal(), files);
+
+    // The binary cache is not built at present (see cache.cc), so there
+    // is nothing to measure for reading or writing it.
+    std::cout << "# cache.binary skipped: binary cache is disabled"
+	      << std::endl;
+
+    std::vector<xact_t *> xacts;
+    collect_xacts(session, xacts);
+
+    if (wanted(config, "amount.arithmetic"))
+      bench_amounts(config, xacts);
+    if (wanted(config, "amount.print"))
+      bench_amount_print(config, xacts);
+    if (wanted(config, "balance.accumulate"))
+      bench_balances(config, xacts);
+    if (wanted(config, "expr.calc"))
+      bench_expr(config, xacts);
+    if (wanted(config, "format.register_line"))
+      bench_format(session, config, xacts);
+    if (wanted(config, "xacts.walk"))
+      bench_walk(session, config);
+
+    bench_reports(session, config, xacts.size());
+
+    set_session_context();
+  }
+  catch (const std::exception& err) {
+    std::cout.flush();
+    std::cerr << "Error: " << error_context() << err.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -44,7 +44,7 @@ def test_regression(test_file):
     else:
         tempdata = tempfile.mkstemp()
 
-        os.write(tempdata[0], string.join(data))
+        os.write(tempdata[0], string.join(data, ""))
         os.close(tempdata[0])
 
         command = ("%s -f \"%s\" " % (ledger, tempdata[1])) + command
@@ -70,7 +70,7 @@ def test_regression(test_file):
               close_fds=True)
 
     if use_stdin:
-        p.stdin.write(string.join(data))
+        p.stdin.write(string.join(data, ""))
     p.stdin.close()
 
     success = True
@@ -1494,6 +1494,121 @@ void AmountTestCase::testCommodityPrinting()
   assertValid(x2);
 }
 
+void AmountTestCase::testAppendQuantity()
+{
+  amount_t x1("$1,234.50");
+  amount_t x2("-$12.30");
+  amount_t x3(123456789L);
+
+  std::string buf;
+  x1.append_quantity(buf);
+  assertEqual(std::string("1234.50"), buf);
+
+  buf.clear();
+  x2.append_quantity(buf);
+  assertEqual(std::string("-12.30"), buf);
+
+  buf.clear();
+  x3.append_quantity(buf);
+  assertEqual(std::string("123456789"), buf);
+
+  assertValid(x1);
+  assertValid(x2);
+  assertValid(x3);
+}
+
+void AmountTestCase::testAppend()
+{
+  // Thousands grouping, at and around the group boundaries.
+  amount_t x1("$1,234,567.89");
+  amount_t x2("$100.00");
+  amount_t x3("$1000");
+  amount_t x4("-$1,000.5");
+
+  // European marks: '.' groups thousands and ',' is the decimal mark.
+  amount_t x5("EUR 1.234,56");
+  amount_t x6("EUR 12,5");
+
+  // Trailing zeros beyond the commodity's precision are trimmed, but
+  // never below it.
+  amount_t x7("ZAR 1.50");
+  amount_t x8(x7 * amount_t("1.000"));
+  amount_t x9(x7 * amount_t("1.025"));
+
+  // A mantissa which does not fit in 64 bits.
+  amount_t x10("$123,456,789,012,345,678,901.25");
+  amount_t x11("-$123,456,789,012,345,678,901.25");
+
+  std::string buf;
+  x1.append(buf);
+  assertEqual(std::string("$1,234,567.89"), buf);
+
+  buf.clear();
+  x2.append(buf);
+  assertEqual(std::string("$100.00"), buf);
+
+  buf.clear();
+  x3.append(buf);
+  assertEqual(std::string("$1,000.00"), buf);
+
+  buf.clear();
+  x4.append(buf);
+  assertEqual(std::string("$-1,000.50"), buf);
+
+  buf.clear();
+  x5.append(buf);
+  assertEqual(std::string("EUR 1.234,56"), buf);
+
+  buf.clear();
+  x6.append(buf);
+  assertEqual(std::string("EUR 12,50"), buf);
+
+  buf.clear();
+  x8.append(buf, false, true);
+  assertEqual(std::string("ZAR 1.50"), buf);
+
+  buf.clear();
+  x9.append(buf, false, true);
+  assertEqual(std::string("ZAR 1.5375"), buf);
+
+  buf.clear();
+  x9.append(buf);
+  assertEqual(std::string("ZAR 1.54"), buf);
+
+  buf.clear();
+  x10.append(buf);
+  assertEqual(std::string("$123,456,789,012,345,678,901.25"), buf);
+
+  buf.clear();
+  x11.append(buf);
+  assertEqual(std::string("$-123,456,789,012,345,678,901.25"), buf);
+
+  // Omitting the commodity also drops its grouping and marks.
+  buf.clear();
+  x5.append(buf, true);
+  assertEqual(std::string("1234.56"), buf);
+
+  // append() adds to what the buffer already holds, and writes just what
+  // print() does.
+  buf = "total: ";
+  x1.append(buf);
+  assertEqual(std::string("total: $1,234,567.89"), buf);
+
+  {
+    std::ostringstream bufstr;
+    x10.print(bufstr);
+    buf.clear();
+    x10.append(buf);
+    assertEqual(bufstr.str(), buf);
+  }
+
+  assertValid(x1);
+  assertValid(x4);
+  assertValid(x5);
+  assertValid(x9);
+  assertValid(x10);
+}
+
 void AmountTestCase::testSerialization()
 {
   amount_t x0;
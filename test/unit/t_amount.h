@@ -47,6 +47,8 @@ class AmountTestCase : public CPPUNIT_NS::TestCase
   CPPUNIT_TEST(testCommodityConversion);
   CPPUNIT_TEST(testPrinting);
   CPPUNIT_TEST(testCommodityPrinting);
+  CPPUNIT_TEST(testAppendQuantity);
+  CPPUNIT_TEST(testAppend);
   CPPUNIT_TEST(testSerialization);
 
   CPPUNIT_TEST_SUITE_END();
@@ -100,6 +102,8 @@ public:
   void testCommodityConversion();
   void testPrinting();
   void testCommodityPrinting();
+  void testAppendQuantity();
+  void testAppend();
   void testSerialization();
 
 private:
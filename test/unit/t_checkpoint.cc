@@ -0,0 +1,304 @@
+#include "t_checkpoint.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(CheckpointTestCase, "journal");
+
+namespace {
+  const path data_path("checkpoint-test.dat");
+  const path sums_path("checkpoint-test.sums");
+}
+
+void CheckpointTestCase::setUp()
+{
+  ledger::set_session_context(&session);
+  session.register_parser(new textual_parser_t);
+}
+
+void CheckpointTestCase::tearDown()
+{
+  ledger::set_session_context();
+
+  boost::filesystem::remove(data_path);
+  boost::filesystem::remove(sums_path);
+}
+
+namespace {
+  // Entries from December through May, on days at the start, middle and
+  // end of each month, with a cost and a second commodity among them.
+  const char * checkpoint_data =
+    "2007/12/31 Opening\n"
+    "    Assets:Checking             $1,000.00\n"
+    "    Equity:Opening\n"
+    "\n"
+    "2008/01/01 Grocery\n"
+    "    Expenses:Food               $12.50\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/01/15 Broker\n"
+    "    Assets:Brokerage            10 AAPL @ $30.00\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/01/31 Grocery\n"
+    "    Expenses:Food               $20.00\n"
+    "    (Budget:Food)               $-20.00\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/02/01 Landlord\n"
+    "    Expenses:Rent               $500.00\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/02/14 Florist\n"
+    "    Expenses:Gifts              25 EUR\n"
+    "    Assets:Checking             $-37.50\n"
+    "\n"
+    "2008/02/29 Grocery\n"
+    "    Expenses:Food               $8.25\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/03/10 Broker\n"
+    "    Assets:Checking             $165.00\n"
+    "    Assets:Brokerage            -5 AAPL @ $33.00\n"
+    "\n"
+    "2008/03/20 Grocery\n"
+    "    Expenses:Food               $31.75\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/04/01 Landlord\n"
+    "    Expenses:Rent               $500.00\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/05/16 Grocery\n"
+    "    Expenses:Food               $4.00\n"
+    "    Assets:Checking\n";
+
+  void write_data(const char * data)
+  {
+    ofstream out(data_path);
+    out << data;
+  }
+
+  void read_data(session_t& session)
+  {
+    session.read_journal(*session.create_journal(), data_path);
+  }
+
+  // The accounts which were given any xacts, with their amounts and
+  // counts, one per line.
+  void describe_accounts(std::ostream& out, account_t& account)
+  {
+    if (account.has_xdata()) {
+      const account_t::xdata_t& xdata(account.xdata());
+      if (xdata.count > 0)
+	out << account.fullname() << ' ' << xdata.value << ' '
+	    << xdata.count << ' ' << xdata.virtuals << '\n';
+    }
+    foreach (accounts_map::value_type& pair, account.accounts)
+      describe_accounts(out, *pair.second);
+  }
+
+  // The handler chain report_t::sum_all_accounts builds for a report
+  // limited to [begin, end).
+  xact_handler_ptr summing_handler(const optional<date_t>& begin,
+				   const optional<date_t>& end)
+  {
+    string predicate;
+    if (begin)
+      predicate = "date>=[" + to_iso_extended_string(*begin) + "]";
+    if (end) {
+      if (! predicate.empty())
+	predicate += "&";
+      predicate += "date<[" + to_iso_extended_string(*end) + "]";
+    }
+
+    xact_handler_ptr handler(new set_account_value);
+    if (! predicate.empty())
+      handler.reset(new filter_xacts(handler, predicate));
+    return handler;
+  }
+
+  string walked_totals(session_t&		 session,
+		       const optional<date_t>& begin,
+		       const optional<date_t>& end)
+  {
+    session.clean_accounts();
+
+    session_xacts_iterator walker(session);
+    pass_down_xacts(summing_handler(begin, end), walker);
+
+    std::ostringstream out;
+    describe_accounts(out, *session.master);
+    session.clean_accounts();
+    return out.str();
+  }
+
+  string checkpoint_totals(session_t&		  session,
+			   balance_checkpoints_t& checkpoints,
+			   const optional<date_t>& begin,
+			   const optional<date_t>& end)
+  {
+    session.clean_accounts();
+
+    if (! checkpoints.sum_accounts(summing_handler(begin, end), begin, end))
+      return "checkpoints could not be used\n";
+
+    std::ostringstream out;
+    describe_accounts(out, *session.master);
+    session.clean_accounts();
+    return out.str();
+  }
+
+  // Compare the checkpoint totals against a plain walk for ranges
+  // which start and end at, before and after month boundaries, are
+  // open at either end or both, lie within a single month, or are
+  // empty.
+  void compare_ranges(session_t& session, balance_checkpoints_t& checkpoints)
+  {
+    const char * ranges[][2] = {
+      { NULL,	      NULL	   },
+      { "2008/01/15", NULL	   },
+      { "2008/02/01", NULL	   },
+      { NULL,	      "2008/03/10" },
+      { NULL,	      "2008/04/01" },
+      { "2008/01/15", "2008/03/10" },
+      { "2008/01/31", "2008/02/29" },
+      { "2008/02/01", "2008/04/01" },
+      { "2008/02/10", "2008/02/20" },
+      { "2008/03/01", "2008/03/01" },
+      { "2008/04/01", "2008/02/01" }
+    };
+
+    for (std::size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+      optional<date_t> begin;
+      if (ranges[i][0])
+	begin = parse_date(ranges[i][0]);
+      optional<date_t> end;
+      if (ranges[i][1])
+	end = parse_date(ranges[i][1]);
+
+      assertEqual(walked_totals(session, begin, end),
+		  checkpoint_totals(session, checkpoints, begin, end));
+    }
+  }
+}
+
+void CheckpointTestCase::testDateRanges()
+{
+  write_data(checkpoint_data);
+  read_data(session);
+
+  // Once as the months are computed, and again as they are read back
+  // from the file that was written.
+  {
+    balance_checkpoints_t checkpoints(session, sums_path);
+    compare_ranges(session, checkpoints);
+  }
+  assertTrue(exists(sums_path));
+  {
+    balance_checkpoints_t checkpoints(session, sums_path);
+    compare_ranges(session, checkpoints);
+  }
+}
+
+void CheckpointTestCase::testEffectiveDates()
+{
+  // Each of these falls into another month by its effective date.
+  write_data("2008/01/31=2008/02/02 Grocery\n"
+	     "    Expenses:Food               $15.00\n"
+	     "    Assets:Checking\n"
+	     "\n"
+	     "2008/02/14 Grocery\n"
+	     "    Expenses:Food               $5.00\n"
+	     "    Assets:Checking\n"
+	     "\n"
+	     "2008/02/28=2008/03/01 Landlord\n"
+	     "    Expenses:Rent               $500.00\n"
+	     "    Assets:Checking\n"
+	     "\n"
+	     "2008/03/15=2008/01/20 Refund\n"
+	     "    Assets:Checking             $10.00\n"
+	     "    Expenses:Food\n");
+  read_data(session);
+
+  // The table is first written with actual dates, and must not be
+  // reused once effective dates are in force.
+  {
+    balance_checkpoints_t checkpoints(session, sums_path);
+    compare_ranges(session, checkpoints);
+  }
+
+  push_variable<bool> save_use_effective_date(item_t::use_effective_date);
+  item_t::use_effective_date = true;
+
+  {
+    balance_checkpoints_t checkpoints(session, sums_path);
+    compare_ranges(session, checkpoints);
+  }
+  {
+    balance_checkpoints_t checkpoints(session, sums_path);
+    compare_ranges(session, checkpoints);
+  }
+}
+
+void CheckpointTestCase::testAutomatedEntries()
+{
+  string data("= /^Expenses:Food/\n"
+	      "    (Budget:Food)               -1\n"
+	      "    Expenses:Tax                $1.00\n"
+	      "    Liabilities:Tax             $-1.00\n"
+	      "\n");
+  data += checkpoint_data;
+  write_data(data.c_str());
+  read_data(session);
+
+  // The generated xacts must be in the totals either way.
+  assertTrue(walked_totals(session, none, none).find("Budget:Food") !=
+	     string::npos);
+
+  {
+    balance_checkpoints_t checkpoints(session, sums_path);
+    compare_ranges(session, checkpoints);
+  }
+  {
+    balance_checkpoints_t checkpoints(session, sums_path);
+    compare_ranges(session, checkpoints);
+  }
+}
+
+void CheckpointTestCase::testStaleSums()
+{
+  write_data(checkpoint_data);
+  read_data(session);
+
+  string before;
+  {
+    balance_checkpoints_t checkpoints(session, sums_path);
+    before = checkpoint_totals(session, checkpoints, none, none);
+  }
+  assertTrue(exists(sums_path));
+
+  // Change the source, then read it into a session of its own, as a
+  // later run would; the months recorded for it must not be used.
+  string changed(checkpoint_data);
+  changed += ("\n"
+	      "2008/02/15 Grocery\n"
+	      "    Expenses:Food               $99.00\n"
+	      "    Assets:Checking\n");
+  write_data(changed.c_str());
+
+  {
+    session_t later;
+    set_session_context(&later);
+    later.register_parser(new textual_parser_t);
+    read_data(later);
+
+    {
+      balance_checkpoints_t checkpoints(later, sums_path);
+      assertNotEqual(before,
+		     checkpoint_totals(later, checkpoints, none, none));
+      compare_ranges(later, checkpoints);
+    }
+
+    set_session_context();
+  }
+
+  set_session_context(&session);
+}
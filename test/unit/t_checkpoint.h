@@ -0,0 +1,36 @@
+#ifndef _T_CHECKPOINT_H
+#define _T_CHECKPOINT_H
+
+#include "UnitTests.h"
+
+class CheckpointTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(CheckpointTestCase);
+
+  CPPUNIT_TEST(testDateRanges);
+  CPPUNIT_TEST(testEffectiveDates);
+  CPPUNIT_TEST(testAutomatedEntries);
+  CPPUNIT_TEST(testStaleSums);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  ledger::session_t session;
+
+  CheckpointTestCase() {}
+  virtual ~CheckpointTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testDateRanges();
+  void testEffectiveDates();
+  void testAutomatedEntries();
+  void testStaleSums();
+
+private:
+  CheckpointTestCase(const CheckpointTestCase &copy);
+  void operator=(const CheckpointTestCase &copy);
+};
+
+#endif // _T_CHECKPOINT_H
@@ -0,0 +1,404 @@
+#include "t_columnar.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(ColumnarTestCase, "journal");
+
+void ColumnarTestCase::setUp()
+{
+  ledger::set_session_context(&session);
+}
+
+void ColumnarTestCase::tearDown()
+{
+  ledger::set_session_context();
+}
+
+using namespace ledger::columnar;
+
+namespace {
+  // The same bytes on every platform, and with no runs in them to
+  // compress.
+  string noise(std::size_t len, unsigned long seed = 1)
+  {
+    string bytes;
+    for (std::size_t i = 0; i < len; i++) {
+      seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+      bytes += char(seed >> 16);
+    }
+    return bytes;
+  }
+
+  string lz4_round_trip(const string& src)
+  {
+    string packed;
+    string unpacked;
+    lz4_compress(src, packed);
+    lz4_decompress(packed.data(), packed.length(), src.length(), unpacked);
+    return unpacked;
+  }
+
+  // An LZ4 length of len, beyond the four bits held in the token.
+  void put_lz4_length(string& block, std::size_t len)
+  {
+    for (; len >= 255; len -= 255)
+      block += char(255);
+    block += char(len);
+  }
+
+  boost::int32_t days(const date_t& when)
+  {
+    return boost::int32_t((when - date_t(1970, 1, 1)).days());
+  }
+}
+
+void ColumnarTestCase::testVarints()
+{
+  const boost::uint64_t values[] = {
+    0, 1, 127, 128, 16383, 16384, 0xffffffffULL, 0x100000000ULL,
+    0x8000000000000000ULL, 0xffffffffffffffffULL
+  };
+  const std::size_t lengths[] = { 1, 1, 1, 2, 2, 3, 5, 5, 10, 10 };
+
+  string buf;
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    string one;
+    put_varint(one, values[i]);
+    assertEqual(lengths[i], one.length());
+    buf += one;
+  }
+
+  const char * p   = buf.data();
+  const char * end = p + buf.length();
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    assertTrue(values[i] == get_varint(p, end));
+  assertTrue(p == end);
+
+  // A number cut short, or longer than 64 bits, is refused.
+  string cut;
+  put_varint(cut, 16384);
+  p = cut.data();
+  assertThrow(get_varint(p, p + cut.length() - 1), columnar_error);
+
+  string endless(11, char(0x80));
+  p = endless.data();
+  assertThrow(get_varint(p, p + endless.length()), columnar_error);
+}
+
+void ColumnarTestCase::testZigzag()
+{
+  assertTrue(0 == zigzag(0));
+  assertTrue(1 == zigzag(-1));
+  assertTrue(2 == zigzag(1));
+  assertTrue(3 == zigzag(-2));
+  assertTrue(0xfffffffffffffffeULL == zigzag(0x7fffffffffffffffLL));
+  assertTrue(0xffffffffffffffffULL == zigzag(-0x7fffffffffffffffLL - 1));
+
+  const boost::int64_t values[] = {
+    0, 1, -1, 63, -64, 64, -65, 2147483647LL, -2147483647LL - 1,
+    0x7fffffffffffffffLL, -0x7fffffffffffffffLL - 1
+  };
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    assertTrue(values[i] == unzigzag(zigzag(values[i])));
+
+    string buf;
+    put_varint(buf, zigzag(values[i]));
+    const char * p = buf.data();
+    assertTrue(values[i] == unzigzag(get_varint(p, p + buf.length())));
+  }
+}
+
+void ColumnarTestCase::testLz4Literals()
+{
+  // Literal runs of 15 and more spill into extra length bytes, and from
+  // 15 + 255 on into more than one.
+  const std::size_t lengths[] = { 0, 1, 14, 15, 16, 269, 270, 271, 600 };
+  for (std::size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    string src(noise(lengths[i]));
+    assertEqual(src, lz4_round_trip(src));
+  }
+
+  // Decoding a block of nothing but 270 literals by hand.
+  string src(noise(270));
+  string block;
+  block += char(15 << 4);
+  put_lz4_length(block, 270 - 15);
+  block += src;
+
+  string out;
+  lz4_decompress(block.data(), block.length(), src.length(), out);
+  assertEqual(src, out);
+
+  // The stated length must be exactly right.
+  assertThrow(lz4_decompress(block.data(), block.length(), 271, out),
+	      columnar_error);
+  assertThrow(lz4_decompress(block.data(), block.length() - 1, 270, out),
+	      columnar_error);
+}
+
+void ColumnarTestCase::testLz4Matches()
+{
+  // Runs compress to overlapping matches, whose lengths beyond four
+  // spill from the token at 15, and again at 15 + 255.
+  const std::size_t lengths[] = { 18, 19, 20, 33, 34, 35, 287, 288, 1000 };
+  for (std::size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    string src(lengths[i], 'x');
+    string packed;
+    lz4_compress(src, packed);
+    assertTrue(packed.length() < src.length());
+    assertEqual(src, lz4_round_trip(src));
+  }
+
+  // Repeats of something longer than a byte.
+  string src;
+  for (int i = 0; i < 100; i++)
+    src += "Expenses:Food";
+  src += noise(40);
+  assertEqual(src, lz4_round_trip(src));
+}
+
+void ColumnarTestCase::testLz4FarOffset()
+{
+  // Repeats 65535 bytes back, as far as an offset reaches, and just
+  // beyond, where there can be no match.
+  string within(noise(65535));
+  within += string(within, 0, 100);
+  assertEqual(within, lz4_round_trip(within));
+
+  string beyond(noise(65536));
+  beyond += string(beyond, 0, 100);
+  assertEqual(beyond, lz4_round_trip(beyond));
+
+  // Decoding a match at an offset of 65535 by hand: the first 65535
+  // bytes of within as literals, then a 20 byte match, then five
+  // literals.
+  string block;
+  block += char(15 << 4 | 15);
+  put_lz4_length(block, 65535 - 15);
+  block.append(within, 0, 65535);
+  block += char(0xff);
+  block += char(0xff);
+  put_lz4_length(block, 20 - 4 - 15);
+  block += char(5 << 4);
+  block += "12345";
+
+  string expected(within, 0, 65535 + 20);
+  expected += "12345";
+
+  string out;
+  lz4_decompress(block.data(), block.length(), expected.length(), out);
+  assertEqual(expected, out);
+
+  // An offset reaching back before the start is refused.
+  string before;
+  before += char(5 << 4 | 1);
+  before += "abcde";
+  before += char(6);
+  before += char(0);
+  before += char(5 << 4);
+  before += "12345";
+  assertThrow(lz4_decompress(before.data(), before.length(), 15, out),
+	      columnar_error);
+}
+
+void ColumnarTestCase::testLz4BlockEnd()
+{
+  // The last five bytes are always literals, and no match starts within
+  // the last twelve; the decoder insists on both, so round trips around
+  // those lengths show the compressor keeps to them.
+  for (std::size_t len = 1; len <= 40; len++) {
+    string run(len, 'a');
+    assertEqual(run, lz4_round_trip(run));
+
+    string mixed(noise(len / 2));
+    mixed += mixed;
+    assertEqual(mixed, lz4_round_trip(mixed));
+  }
+
+  // One literal, a match of four at offset one starting eleven bytes
+  // from the end, then six literals: too near the end.
+  string early;
+  early += char(1 << 4);
+  early += "a";
+  early += char(1);
+  early += char(0);
+  early += char(6 << 4);
+  early += "bcdefg";
+  string out;
+  assertThrow(lz4_decompress(early.data(), early.length(), 11, out),
+	      columnar_error);
+
+  // Twelve literals, then a match of eight starting twelve bytes from
+  // the end, which is allowed, but which reaches into the last five.
+  string literals(noise(12));
+  string late;
+  late += char(12 << 4 | 4);
+  late += literals;
+  late += char(1);
+  late += char(0);
+  late += char(4 << 4);
+  late += "wxyz";
+  assertThrow(lz4_decompress(late.data(), late.length(), 12 + 8 + 4, out),
+	      columnar_error);
+
+  // A block must end with a sequence of literals alone.
+  string cut;
+  cut += char(12 << 4);
+  cut += literals;
+  cut += char(1);
+  cut += char(0);
+  assertThrow(lz4_decompress(cut.data(), cut.length(), 24, out),
+	      columnar_error);
+}
+
+void ColumnarTestCase::testRoundTrip()
+{
+  account_t * food = session.master->find_account("Expenses:Food");
+  account_t * cash = session.master->find_account("Assets:Cash");
+
+  entry_t grocery;
+  grocery._date = parse_date("2008/01/01");
+  grocery.payee = "Grocery";
+
+  entry_t broker;
+  broker._date = parse_date("2008/01/03");
+  broker.payee = "Broker";
+
+  // The transactions are not added to their entries, which would then
+  // try to delete them.
+  xact_t x1(food, amount_t("$12.50"));
+  x1.entry = &grocery;
+  x1.note  = "weekly";
+  x1.set_state(item_t::CLEARED);
+
+  xact_t x2(cash, amount_t("$-12.50"));
+  x2.entry     = &grocery;
+  x2._date_eff = parse_date("2008/01/05");
+
+  xact_t x3(cash, amount_t("10 AAPL"));
+  x3.entry = &broker;
+  x3.cost  = amount_t("$300.00");
+  x3.set_state(item_t::PENDING);
+
+  std::ostringstream out;
+  {
+    format_columnar_xacts writer(out, 2);
+    writer(x1);
+    writer(x2);
+    writer(x3);
+    writer.flush();
+  }
+
+  string data(out.str());
+  columnar_reader_t reader(data);
+
+  assertEqual(std::size_t(2), reader.blocks.size());
+  assertEqual(std::size_t(2), reader.payees.size());
+  assertEqual(string("Grocery"), reader.payees[0]);
+  assertEqual(string("Broker"), reader.payees[1]);
+  assertEqual(string("Expenses:Food"), reader.accounts[0]);
+  assertEqual(string("Assets:Cash"), reader.accounts[1]);
+  assertEqual(string(""), reader.notes[0]);
+
+  columnar_reader_t::rows_list rows;
+  reader.read_block(0, rows);
+  reader.read_block(1, rows);
+  assertEqual(std::size_t(3), rows.size());
+
+  const columnar_reader_t::row_t& r1(rows[0]);
+  assertEqual(days(date_t(2008, 1, 1)), r1.date);
+  assertEqual(no_date, r1.effective_date);
+  assertEqual(string("Grocery"), reader.payees[r1.payee]);
+  assertEqual(string("Expenses:Food"), reader.accounts[r1.account]);
+  assertEqual(string("$"), reader.commodities[r1.commodity]);
+  assertTrue(1250 == r1.quantity);
+  assertEqual(2, int(r1.quantity_scale));
+  assertFalse(r1.cost_commodity);
+  assertEqual(int(item_t::CLEARED), int(r1.state));
+  assertEqual(string("weekly"), reader.notes[r1.note]);
+
+  const columnar_reader_t::row_t& r2(rows[1]);
+  assertEqual(days(date_t(2008, 1, 1)), r2.date);
+  assertEqual(days(date_t(2008, 1, 5)), r2.effective_date);
+  assertTrue(-1250 == r2.quantity);
+  assertEqual(0U, r2.note);
+
+  const columnar_reader_t::row_t& r3(rows[2]);
+  assertEqual(days(date_t(2008, 1, 3)), r3.date);
+  assertEqual(string("Broker"), reader.payees[r3.payee]);
+  assertEqual(string("AAPL"), reader.commodities[r3.commodity]);
+  assertTrue(10 == r3.quantity);
+  assertEqual(0, int(r3.quantity_scale));
+  assertTrue(r3.cost_commodity);
+  assertEqual(string("$"), reader.commodities[*r3.cost_commodity]);
+  assertTrue(30000 == r3.cost);
+  assertEqual(2, int(r3.cost_scale));
+  assertEqual(int(item_t::PENDING), int(r3.state));
+
+  // Anything but a complete export is refused.
+  assertThrow(columnar_reader_t(string(data, 0, data.length() - 1)),
+	      columnar_error);
+  assertThrow(columnar_reader_t(string("LDGRCOL")), columnar_error);
+}
+
+void ColumnarTestCase::testDateRanges()
+{
+  account_t * food = session.master->find_account("Expenses:Food");
+
+  const char * dates[] = {
+    "2008/01/01", "2008/01/02", "2008/01/10", "2008/01/11", "2008/01/20"
+  };
+
+  // With two rows to a block, the blocks cover the 1st and 2nd, the
+  // 10th and 11th, and the 20th.
+  std::ostringstream out;
+  {
+    format_columnar_xacts writer(out, 2);
+    for (std::size_t i = 0; i < 5; i++) {
+      entry_t entry;
+      entry._date = parse_date(dates[i]);
+      entry.payee = "Grocery";
+
+      xact_t xact(food, amount_t("$1.00"));
+      xact.entry = &entry;
+      writer(xact);
+    }
+    writer.flush();
+  }
+
+  string data(out.str());
+  columnar_reader_t reader(data);
+  assertEqual(std::size_t(3), reader.blocks.size());
+
+  assertEqual(days(date_t(2008, 1, 10)), reader.blocks[1].first_date);
+  assertEqual(days(date_t(2008, 1, 11)), reader.blocks[1].last_date);
+
+  std::vector<std::size_t> found;
+
+  found = reader.blocks_between(days(date_t(2008, 1, 5)),
+				days(date_t(2008, 1, 10)));
+  assertEqual(std::size_t(1), found.size());
+  assertEqual(std::size_t(1), found[0]);
+
+  found = reader.blocks_between(days(date_t(2008, 1, 2)),
+				days(date_t(2008, 1, 10)));
+  assertEqual(std::size_t(2), found.size());
+  assertEqual(std::size_t(0), found[0]);
+  assertEqual(std::size_t(1), found[1]);
+
+  found = reader.blocks_between(days(date_t(2008, 1, 12)),
+				days(date_t(2008, 1, 19)));
+  assertTrue(found.empty());
+
+  found = reader.blocks_between(days(date_t(2008, 1, 1)),
+				days(date_t(2008, 1, 31)));
+  assertEqual(std::size_t(3), found.size());
+
+  // Only the blocks found need be read, and they hold the rows sought.
+  found = reader.blocks_between(days(date_t(2008, 1, 20)),
+				days(date_t(2008, 1, 20)));
+  assertEqual(std::size_t(1), found.size());
+
+  columnar_reader_t::rows_list rows;
+  reader.read_block(found[0], rows);
+  assertEqual(std::size_t(1), rows.size());
+  assertEqual(days(date_t(2008, 1, 20)), rows[0].date);
+}
@@ -0,0 +1,44 @@
+#ifndef _T_COLUMNAR_H
+#define _T_COLUMNAR_H
+
+#include "UnitTests.h"
+
+class ColumnarTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(ColumnarTestCase);
+
+  CPPUNIT_TEST(testVarints);
+  CPPUNIT_TEST(testZigzag);
+  CPPUNIT_TEST(testLz4Literals);
+  CPPUNIT_TEST(testLz4Matches);
+  CPPUNIT_TEST(testLz4FarOffset);
+  CPPUNIT_TEST(testLz4BlockEnd);
+  CPPUNIT_TEST(testRoundTrip);
+  CPPUNIT_TEST(testDateRanges);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  ledger::session_t session;
+
+  ColumnarTestCase() {}
+  virtual ~ColumnarTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testVarints();
+  void testZigzag();
+  void testLz4Literals();
+  void testLz4Matches();
+  void testLz4FarOffset();
+  void testLz4BlockEnd();
+  void testRoundTrip();
+  void testDateRanges();
+
+private:
+  ColumnarTestCase(const ColumnarTestCase &copy);
+  void operator=(const ColumnarTestCase &copy);
+};
+
+#endif // _T_COLUMNAR_H
@@ -49,7 +49,79 @@ void CommodityTestCase::testPriceHistory()
 
 void CommodityTestCase::testLots()
 {
-  // jww (2007-04-17): tbd
+  amount_t x1("10 AAPL {$50.00} [2007/01/17] (lot)");
+  amount_t x2("5 AAPL {$50} [2007/01/17] (lot)");
+  amount_t x3("5 AAPL {$51} [2007/01/17] (lot)");
+  amount_t x4("5 AAPL {$50}");
+
+  // Lots whose annotations are equal share one commodity, even when
+  // their prices were written with different precisions.
+  assertTrue(&x1.commodity() == &x2.commodity());
+  assertTrue(&x1.commodity() != &x3.commodity());
+  assertTrue(&x1.commodity() != &x4.commodity());
+
+  commodity_pool_t& pool(x1.commodity().parent());
+  commodity_t&	    aapl(as_annotated_commodity(x1.commodity()).referent());
+
+  annotation_t details(amount_t("$50.0"), parse_date("2007/01/17"),
+		       string("lot"));
+  assertTrue(pool.find(aapl, details) == &x1.commodity());
+  assertTrue(pool.find("AAPL", details) == &x1.commodity());
+  assertTrue(pool.find(aapl, annotation_t(amount_t("$52"))) == NULL);
+  assertTrue(pool.find_or_create(aapl, details) == &x1.commodity());
+
+  assertValid(x1);
+  assertValid(x4);
+}
+
+void CommodityTestCase::testLotKeys()
+{
+  amount_t x1("10 AAPL");
+  amount_t x2("10 EUR");
+  assertTrue(x2.has_commodity());
+
+  const commodity_t::base_t * aapl(x1.commodity().base.get());
+
+  annotation_t dollars(amount_t("$50"));
+  annotation_t dollars_long(amount_t("$50.00"));
+  annotation_t euros(amount_t("45 EUR"));
+  annotation_t euros_alike(amount_t("50 EUR"));
+  annotation_t bare(amount_t("50"));
+  annotation_t none;
+
+  annotated_key_t by_dollars(aapl, dollars);
+  annotated_key_t by_dollars_long(aapl, dollars_long);
+  annotated_key_t by_euros(aapl, euros);
+  annotated_key_t by_euros_alike(aapl, euros_alike);
+  annotated_key_t by_bare(aapl, bare);
+  annotated_key_t by_none(aapl, none);
+
+  // Keys priced in different currencies simply differ, whatever their
+  // quantities, instead of throwing.
+  assertFalse(by_dollars == by_euros);
+  assertFalse(by_euros == by_dollars);
+  assertFalse(by_dollars == by_euros_alike);
+
+  // A price without a commodity equals neither.
+  assertFalse(by_dollars == by_bare);
+  assertFalse(by_bare == by_euros_alike);
+  assertFalse(by_bare == by_none);
+
+  // Equal keys hash alike, even when written at different precisions.
+  assertTrue(by_dollars == by_dollars_long);
+  assertEqual(hash_value(by_dollars), hash_value(by_dollars_long));
+  assertTrue(by_none == annotated_key_t(aapl, annotation_t()));
+
+  // Lots of one commodity priced in two currencies are kept apart in
+  // the pool.
+  amount_t x3("5 AAPL {$50}");
+  amount_t x4("5 AAPL {50 EUR}");
+  assertTrue(&x3.commodity() != &x4.commodity());
+  assertTrue(x1.commodity().parent().find
+	     (x1.commodity(), euros_alike) == &x4.commodity());
+
+  assertValid(x3);
+  assertValid(x4);
 }
 
 void CommodityTestCase::testScalingBase()
@@ -62,3 +134,27 @@ void CommodityTestCase::testReduction()
   // jww (2007-04-17): tbd
 }
 
+void CommodityTestCase::testFrozenPool()
+{
+  amount_t x1("10 AAPL {$50.00} [2007/01/17] (lot)");
+
+  commodity_pool_t& pool(x1.commodity().parent());
+  pool.freeze();
+
+  // Every stripped form of a lot exists ahead of time, so reports can
+  // still strip annotations without adding to the pool.
+  amount_t x2(x1.strip_annotations(true, false, false));
+  assertTrue(x2.commodity().annotated);
+  assertTrue(as_annotated_commodity(x2.commodity()).details.price);
+  assertFalse(as_annotated_commodity(x2.commodity()).details.date);
+
+  amount_t x3(x1.strip_annotations(false, false, false));
+  assertFalse(x3.commodity().annotated);
+  assertEqual(amount_t("20 AAPL"), x3 + amount_t("10 AAPL"));
+
+  assertThrow(amount_t("5 XYZ"), commodity_error);
+
+  assertValid(x1);
+  assertValid(x2);
+  assertValid(x3);
+}
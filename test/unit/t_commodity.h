@@ -9,8 +9,10 @@ class CommodityTestCase : public CPPUNIT_NS::TestCase
 
   CPPUNIT_TEST(testPriceHistory);
   CPPUNIT_TEST(testLots);
+  CPPUNIT_TEST(testLotKeys);
   CPPUNIT_TEST(testScalingBase);
   CPPUNIT_TEST(testReduction);
+  CPPUNIT_TEST(testFrozenPool);
 
   CPPUNIT_TEST_SUITE_END();
 
@@ -25,8 +27,10 @@ public:
 
   void testPriceHistory();
   void testLots();
+  void testLotKeys();
   void testScalingBase();
   void testReduction();
+  void testFrozenPool();
 
 private:
   CommodityTestCase(const CommodityTestCase &copy);
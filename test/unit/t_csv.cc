@@ -0,0 +1,119 @@
+#include "t_csv.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(CsvTestCase, "journal");
+
+void CsvTestCase::setUp()
+{
+  ledger::set_session_context(&session);
+}
+
+void CsvTestCase::tearDown()
+{
+  ledger::set_session_context();
+}
+
+void CsvTestCase::testQuoting()
+{
+  journal_t journal;
+
+  // The payee holds a separator and quotes, the first note a line break
+  // and the amounts, which use thousands marks, a separator each.  The
+  // xacts are declared first, so that they outlive the entry.
+  xact_t food(journal.find_account("Expenses:Food"),
+	      amount_t("$1,000.00"), ITEM_TEMP, string("one\ntwo"));
+  food.set_state(item_t::CLEARED);
+  xact_t checking(journal.find_account("Assets:Checking"),
+		  amount_t("$-1,000.00"), ITEM_TEMP, string("plain"));
+  checking.set_state(item_t::PENDING);
+
+  entry_t entry;
+  entry._date = parse_date("2008/01/15");
+  entry.payee = "Smith, \"Bob\"";
+  entry.code  = "101";
+  entry.add_xact(&food);
+  entry.add_xact(&checking);
+
+  std::ostringstream out;
+  format_csv_xacts   csv(out);
+  csv(food);
+  csv(checking);
+  csv(food);			// already displayed; not written again
+  csv.flush();
+
+  assertEqual(string("date,payee,account,amount,total,state,code,note\n"
+		     "2008-01-15,\"Smith, \"\"Bob\"\"\",Expenses:Food,"
+		     "\"$1,000.00\",\"$1,000.00\",*,101,\"one\ntwo\"\n"
+		     "2008-01-15,\"Smith, \"\"Bob\"\"\",Assets:Checking,"
+		     "\"$-1,000.00\",\"$-1,000.00\",!,101,plain\n"),
+	      out.str());
+}
+
+void CsvTestCase::testTabEscapes()
+{
+  journal_t journal;
+
+  xact_t food(journal.find_account("Expenses:Food"),
+	      amount_t("$1,000.00"), ITEM_TEMP, string("C:\\dir\r\nnext"));
+
+  entry_t entry;
+  entry._date = parse_date("2008/01/15");
+  entry.payee = "Tab\there, \"quoted\"";
+  entry.add_xact(&food);
+
+  std::ostringstream out;
+  format_csv_xacts   tsv(out, "", '\t');
+  tsv(food);
+  tsv.flush();
+
+  // Tabs, line breaks and backslashes are escaped, and nothing is
+  // quoted: commas and quotes pass through as they are.
+  assertEqual(string("date\tpayee\taccount\tamount\ttotal\tstate\tcode\tnote\n"
+		     "2008-01-15\tTab\\there, \"quoted\"\tExpenses:Food\t"
+		     "$1,000.00\t$1,000.00\t\t\tC:\\\\dir\\r\\nnext\n"),
+	      out.str());
+}
+
+void CsvTestCase::testColumns()
+{
+  journal_t journal;
+
+  xact_t shares(journal.find_account("Assets:Brokerage"),
+		amount_t("10 AAPL"), ITEM_TEMP);
+  shares.cost = amount_t("$300.00");
+  xact_t checking(journal.find_account("Assets:Checking"),
+		  amount_t("$-300.00"), ITEM_TEMP);
+
+  entry_t entry;
+  entry._date	  = parse_date("2008/01/15");
+  entry._date_eff = parse_date("2008/01/20");
+  entry.payee	  = "Broker";
+  entry.add_xact(&shares);
+  entry.add_xact(&checking);
+
+  // Columns are written in the order given, may repeat, and are named
+  // in the header just as they were in the list.
+  std::ostringstream out;
+  format_csv_xacts   csv(out, "payee,quantity,commodity,cost,"
+			 "effective_date,quantity");
+  csv(shares);
+  csv(checking);
+  csv.flush();
+
+  assertEqual(string("payee,quantity,commodity,cost,effective_date,quantity\n"
+		     "Broker,10,AAPL,$300.00,2008-01-20,10\n"
+		     "Broker,-300.00,$,,2008-01-20,-300.00\n"),
+	      out.str());
+}
+
+void CsvTestCase::testUnknownColumn()
+{
+  std::ostringstream out;
+
+  assertThrow(format_csv_xacts(out, "date,bogus"), format_error);
+  assertThrow(format_csv_xacts(out, "Date"), format_error);
+  assertThrow(format_csv_xacts(out, "date,,payee"), format_error);
+  assertThrow(format_csv_xacts(out, "date,"), format_error);
+
+  // Nothing is written for a list that was rejected.
+  assertEqual(string(""), out.str());
+}
@@ -0,0 +1,36 @@
+#ifndef _T_CSV_H
+#define _T_CSV_H
+
+#include "UnitTests.h"
+
+class CsvTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(CsvTestCase);
+
+  CPPUNIT_TEST(testQuoting);
+  CPPUNIT_TEST(testTabEscapes);
+  CPPUNIT_TEST(testColumns);
+  CPPUNIT_TEST(testUnknownColumn);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  ledger::session_t session;
+
+  CsvTestCase() {}
+  virtual ~CsvTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testQuoting();
+  void testTabEscapes();
+  void testColumns();
+  void testUnknownColumn();
+
+private:
+  CsvTestCase(const CsvTestCase &copy);
+  void operator=(const CsvTestCase &copy);
+};
+
+#endif // _T_CSV_H
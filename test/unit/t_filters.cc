@@ -0,0 +1,205 @@
+#include "t_filters.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(FiltersTestCase, "journal");
+
+void FiltersTestCase::setUp()
+{
+  ledger::set_session_context(&session);
+}
+
+void FiltersTestCase::tearDown()
+{
+  ledger::set_session_context();
+}
+
+namespace {
+  // Log each xact reported as "date account amount", one per line.
+  class log_xacts : public item_handler<xact_t>
+  {
+  public:
+    std::ostringstream& out;
+
+    log_xacts(std::ostringstream& _out) : out(_out) {}
+
+    virtual void operator()(xact_t& xact) {
+      out << format_date(*xact.date(), string("%Y/%m/%d")) << ' '
+	  << xact.reported_account()->fullname() << ' '
+	  << xact.amount << '\n';
+    }
+  };
+
+  // Log every xact seen like log_xacts, but mark those matching `pred'
+  // the way filter_xacts would, without dropping the others.
+  class mark_xacts : public item_handler<xact_t>
+  {
+  public:
+    std::ostringstream&	   out;
+    item_predicate<xact_t> pred;
+
+    mark_xacts(std::ostringstream& _out, const string& predicate)
+      : out(_out), pred(predicate) {}
+
+    virtual void operator()(xact_t& xact) {
+      out << format_date(*xact.date(), string("%Y/%m/%d")) << ' '
+	  << xact.reported_account()->fullname();
+      if (pred(xact)) {
+	xact.xdata().add_flags(XACT_EXT_MATCHES);
+	out << " *";
+      }
+      out << '\n';
+    }
+  };
+
+  // Exposes how many xacts a forecast had to allocate.
+  class counted_forecast_xacts : public forecast_xacts
+  {
+  public:
+    counted_forecast_xacts(xact_handler_ptr handler, const string& predicate)
+      : forecast_xacts(handler, predicate) {}
+
+    std::size_t temporaries() const {
+      return xact_temps.size();
+    }
+  };
+}
+
+void FiltersTestCase::testBudgetOrder()
+{
+  journal_t   journal;
+  account_t * expenses = journal.find_account("Expenses");
+  account_t * food     = journal.find_account("Expenses:Food");
+  account_t * dining   = journal.find_account("Expenses:Food:Dining");
+  account_t * car      = journal.find_account("Expenses:Car");
+  account_t * checking = journal.find_account("Assets:Checking");
+
+  // Expenses is budgeted monthly, and Expenses:Food, listed after it,
+  // every two weeks; both from the start of January, so their periods
+  // overlap.
+  xact_t monthly(expenses, amount_t("$500.00"));
+  xact_t biweekly(food, amount_t("$50.00"));
+
+  std::ostringstream log;
+  budget_xacts	     budget(xact_handler_ptr(new log_xacts(log)));
+
+  budget.add_xact(interval_t(0, 1, 0, parse_date("2008/01/01")), monthly);
+  budget.add_xact(interval_t(14, 0, 0, parse_date("2008/01/01")), biweekly);
+
+  xact_t x1(dining, amount_t("$20.00"));
+  x1._date = parse_date("2008/02/01");
+  xact_t x2(checking, amount_t("$15.00"));
+  x2._date = parse_date("2008/02/15");
+  xact_t x3(food, amount_t("$30.00"));
+  x3._date = parse_date("2008/03/01");
+  xact_t x4(car, amount_t("$10.00"));
+  x4._date = parse_date("2008/03/01");
+
+  budget(x1);
+  budget(x2);
+  budget(x3);
+  budget(x4);
+  budget.flush();
+
+  // Budget items due before a posting are reported round by round: one
+  // instance of each due item per round, in the order they were listed.
+  // Postings are reported in the earliest-listed budgeted account among
+  // their own and their parents, which for everything here is Expenses,
+  // even for Expenses:Food which is budgeted itself.  Unbudgeted
+  // postings are dropped and report no budget items.
+  assertEqual(string("2008/01/01 Expenses $-500.00\n"
+		     "2008/01/01 Expenses:Food $-50.00\n"
+		     "2008/01/15 Expenses:Food $-50.00\n"
+		     "2008/01/29 Expenses:Food $-50.00\n"
+		     "2008/02/01 Expenses $20.00\n"
+		     "2008/02/01 Expenses $-500.00\n"
+		     "2008/02/12 Expenses:Food $-50.00\n"
+		     "2008/02/26 Expenses:Food $-50.00\n"
+		     "2008/03/01 Expenses $30.00\n"
+		     "2008/03/01 Expenses $10.00\n"), log.str());
+}
+
+void FiltersTestCase::testForecastOrder()
+{
+  journal_t   journal;
+  account_t * rent   = journal.find_account("Expenses:Rent");
+  account_t * food   = journal.find_account("Expenses:Food");
+  account_t * coffee = journal.find_account("Expenses:Coffee");
+  account_t * salary = journal.find_account("Income:Salary");
+
+  // The periods all begin well after today, so that forecast_xacts
+  // leaves them alone.  Rent and Food both fall due first on the same
+  // day; Coffee ends part way through January; and Salary is never
+  // reported, since the filter below the forecast drops it.
+  xact_t monthly(rent, amount_t("$500.00"));
+  xact_t biweekly(food, amount_t("$50.00"));
+  xact_t weekly(coffee, amount_t("$5.00"));
+  xact_t income(salary, amount_t("$-1000.00"));
+
+  std::ostringstream     log;
+  counted_forecast_xacts forecast
+    (xact_handler_ptr(new filter_xacts(xact_handler_ptr(new log_xacts(log)),
+				       "account =~ /^Expenses/")),
+     "date < [2100/03/01]");
+
+  forecast.add_xact(interval_t(0, 1, 0, parse_date("2100/01/01")), monthly);
+  forecast.add_xact(interval_t(14, 0, 0, parse_date("2100/01/01")), biweekly);
+  forecast.add_xact(interval_t(7, 0, 0, parse_date("2100/01/04"),
+			       parse_date("2100/01/20")), weekly);
+  forecast.add_xact(interval_t(0, 1, 0, parse_date("2100/01/15")), income);
+  forecast.flush();
+
+  // Instances are reported in date order, and on the same date in the
+  // order their periodic xacts were added.  The first reported instance
+  // beyond the forecast limit is still passed on, and ends the forecast.
+  assertEqual(string("2100/01/01 Expenses:Rent $500.00\n"
+		     "2100/01/01 Expenses:Food $50.00\n"
+		     "2100/01/04 Expenses:Coffee $5.00\n"
+		     "2100/01/11 Expenses:Coffee $5.00\n"
+		     "2100/01/15 Expenses:Food $50.00\n"
+		     "2100/01/18 Expenses:Coffee $5.00\n"
+		     "2100/01/29 Expenses:Food $50.00\n"
+		     "2100/02/01 Expenses:Rent $500.00\n"
+		     "2100/02/12 Expenses:Food $50.00\n"
+		     "2100/02/26 Expenses:Food $50.00\n"
+		     "2100/03/01 Expenses:Rent $500.00\n"), log.str());
+
+  // Both Salary instances were dropped by the filter, so the second
+  // reuses the first's storage: eleven reported instances, plus one.
+  assertEqual(std::size_t(12), forecast.temporaries());
+}
+
+void FiltersTestCase::testForecastRounds()
+{
+  journal_t   journal;
+  account_t * rent = journal.find_account("Expenses:Rent");
+  account_t * food = journal.find_account("Expenses:Food");
+
+  xact_t monthly(rent, amount_t("$500.00"));
+  xact_t biweekly(food, amount_t("$50.00"));
+
+  // Only Rent before the middle of February is marked as matching, so
+  // the forecast limit, which is far off, is never what stops it.
+  std::ostringstream     log;
+  counted_forecast_xacts forecast
+    (xact_handler_ptr(new mark_xacts(log, "account =~ /Rent/ & "
+				     "date < [2100/02/15]")),
+     "date < [2101/01/01]");
+
+  forecast.add_xact(interval_t(0, 1, 0, parse_date("2100/01/01")), monthly);
+  forecast.add_xact(interval_t(14, 0, 0, parse_date("2100/01/01")), biweekly);
+  forecast.flush();
+
+  // The forecast gives up once every periodic xact has generated an
+  // instance since the last one to match; Food generating several in a
+  // row counts only once.
+  assertEqual(string("2100/01/01 Expenses:Rent *\n"
+		     "2100/01/01 Expenses:Food\n"
+		     "2100/01/15 Expenses:Food\n"
+		     "2100/01/29 Expenses:Food\n"
+		     "2100/02/01 Expenses:Rent *\n"
+		     "2100/02/12 Expenses:Food\n"
+		     "2100/02/26 Expenses:Food\n"
+		     "2100/03/01 Expenses:Rent\n"), log.str());
+
+  // Nothing below is a filter_xacts, so no instance was reused.
+  assertEqual(std::size_t(8), forecast.temporaries());
+}
@@ -0,0 +1,34 @@
+#ifndef _T_FILTERS_H
+#define _T_FILTERS_H
+
+#include "UnitTests.h"
+
+class FiltersTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(FiltersTestCase);
+
+  CPPUNIT_TEST(testBudgetOrder);
+  CPPUNIT_TEST(testForecastOrder);
+  CPPUNIT_TEST(testForecastRounds);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  ledger::session_t session;
+
+  FiltersTestCase() {}
+  virtual ~FiltersTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testBudgetOrder();
+  void testForecastOrder();
+  void testForecastRounds();
+
+private:
+  FiltersTestCase(const FiltersTestCase &copy);
+  void operator=(const FiltersTestCase &copy);
+};
+
+#endif // _T_FILTERS_H
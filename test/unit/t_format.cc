@@ -0,0 +1,206 @@
+#include "t_format.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(FormatTestCase, "journal");
+
+namespace {
+  const char * format_data =
+    "2008/01/15 Grocery Store With A Long Name\n"
+    "    Expenses:Food:Groceries:Organic    $12.50\n"
+    "    (Budget:Food)                      $-12.50\n"
+    "    [Savings:Reserve]                  $5.00\n"
+    "    [Assets:Checking:Joint]            $-5.00\n"
+    "    Assets:Checking:Joint\n"
+    "\n"
+    "2008/02/01=2008/02/03 Bar\n"
+    "    Expenses:Drink                     10 EUR @ $1.50\n"
+    "    Assets:Checking:Joint\n";
+}
+
+void FormatTestCase::setUp()
+{
+  ledger::set_session_context(&session);
+
+  report = new report_t(session);
+  set_report_context(report);
+
+  session.register_parser(new textual_parser_t);
+
+  journal_t * journal = session.create_journal();
+  journal->sources.push_back(path("format.dat"));
+
+  std::istringstream in(format_data);
+  session.read_journal(*journal, in, path("format.dat"));
+}
+
+void FormatTestCase::tearDown()
+{
+  set_report_context();
+  checked_delete(report);
+  report = NULL;
+
+  ledger::set_session_context();
+}
+
+namespace {
+  string format_with(const string& fmt, scope_t& scope)
+  {
+    format_t format(fmt);
+    std::ostringstream out;
+    format.format(out, scope);
+    return out.str();
+  }
+
+  // Widths, alignment and truncation, as they precede a format code.
+  const char * specs[] = {
+    "", "-", "20", "-20", ".5", "-.9", "12.20", "-.23", "!.5", "-!.8"
+  };
+
+  // Check that the compiled accessor for each code gives what its
+  // expression, doubly parenthesized so that it isn't recognized as
+  // one, gives when evaluated.
+  void compare_with_expressions(scope_t& scope, const char * codes[][2],
+				std::size_t count)
+  {
+    for (std::size_t i = 0; i < sizeof(specs) / sizeof(specs[0]); i++)
+      for (std::size_t j = 0; j < count; j++) {
+	string prefix(string("|%") + specs[i]);
+	string evaluated(format_with(prefix + "((" + codes[j][1] + "))|",
+				     scope));
+	if (codes[j][0])
+	  assertEqual(evaluated,
+		      format_with(prefix + codes[j][0] + "|", scope));
+	assertEqual(evaluated,
+		    format_with(prefix + "(" + codes[j][1] + ")|", scope));
+      }
+  }
+
+  void set_displayed(account_t * account)
+  {
+    account->xdata().add_flags(ACCOUNT_EXT_DISPLAYED);
+  }
+
+  void compare_accounts(account_t& account, const char * codes[][2],
+			std::size_t count)
+  {
+    if (account.has_xdata())
+      compare_with_expressions(account, codes, count);
+    foreach (accounts_map::value_type& pair, account.accounts)
+      compare_accounts(*pair.second, codes, count);
+  }
+}
+
+void FormatTestCase::testXactAccessors()
+{
+  const char * codes[][2] = {
+    { "D", "date"    },
+    { "P", "payee"   },
+    { "A", "account" },
+    { "t", "amount"  },
+    { "T", "total"   }
+  };
+  const std::size_t count = sizeof(codes) / sizeof(codes[0]);
+
+  // First with no extended data, so that the total is the amount and
+  // the date is the entry's; then with running totals, a compound
+  // amount and effective dates.
+  foreach (journal_t& journal, session.journals)
+    foreach (entry_t * entry, journal.entries)
+      foreach (xact_t * xact, entry->xacts)
+	compare_with_expressions(*xact, codes, count);
+
+  push_variable<bool> save_use_effective_date(item_t::use_effective_date,
+					      true);
+  value_t running;
+  foreach (journal_t& journal, session.journals)
+    foreach (entry_t * entry, journal.entries)
+      foreach (xact_t * xact, entry->xacts) {
+	add_or_set_value(running, xact->amount);
+	xact->xdata().total = running;
+	if (xact->cost) {
+	  xact->xdata().value = *xact->cost;
+	  xact->xdata().add_flags(XACT_EXT_COMPOUND);
+	}
+	compare_with_expressions(*xact, codes, count);
+      }
+
+  // Spot checks of what the accessors print.
+  xact_t& organic(*session.journals.front().entries.front()->xacts[0]);
+  assertEqual(string("Grocery Store With.."),
+	      format_with("%-.20P", organic));
+  assertEqual(string("Grocery Store With A Long Name  $12.50"),
+	      format_with("%P %7t", organic));
+
+  xact_t& drink(*session.journals.front().entries.back()->xacts[0]);
+  assertEqual(format_date(parse_date("2008/02/03")),
+	      format_with("%D", drink));
+  assertEqual(string("$15.00"), format_with("%t", drink));
+}
+
+void FormatTestCase::testAccountAccessors()
+{
+  report->sum_all_accounts();
+
+  set_displayed(session.master->find_account("Expenses"));
+  set_displayed(session.master->find_account("Expenses:Food"));
+
+  const char * codes[][2] = {
+    { "t",  "amount"	      },
+    { "T",  "total"	      },
+    { "_",  "depth_spacer"    },
+    { NULL, "partial_account" }
+  };
+  compare_accounts(*session.master, codes,
+		   sizeof(codes) / sizeof(codes[0]));
+
+  // An account's partial name stops at the nearest displayed parent,
+  // and it is indented two spaces for each displayed account above it.
+  account_t * organic =
+    session.master->find_account("Expenses:Food:Groceries:Organic");
+  assertEqual(string("Groceries:Organic"),
+	      format_with("%(partial_account)", *organic));
+  assertEqual(string("    |"), format_with("%_|", *organic));
+  assertEqual(string("      $12.50"), format_with("%12T", *organic));
+}
+
+void FormatTestCase::testAccountNames()
+{
+  xact_t * organic = NULL;
+  xact_t * budget  = NULL;
+  xact_t * reserve = NULL;
+  xact_t * joint   = NULL;
+  foreach (xact_t * xact, session.journals.front().entries.front()->xacts) {
+    string name(xact->account->fullname());
+    if (name == "Expenses:Food:Groceries:Organic")
+      organic = xact;
+    else if (name == "Budget:Food")
+      budget = xact;
+    else if (name == "Savings:Reserve")
+      reserve = xact;
+    else if (name == "Assets:Checking:Joint" && ! joint)
+      joint = xact;
+  }
+  assertTrue(organic && budget && reserve && joint);
+
+  // Names which fit are only padded, and virtual ones are bracketed.
+  assertEqual(string("(Budget:Food)  |"), format_with("%-15A|", *budget));
+  assertEqual(string("  [Savings:Reserve]"), format_with("%19A", *reserve));
+
+  // Names which don't fit have all but their last component abbreviated
+  // as far as needed, before any brackets are added; if that isn't
+  // enough, the start is cut off as well.
+  assertEqual(string("Ex:Fo:Gr:Organic       |"),
+	      format_with("%-.23A|", *organic));
+  assertEqual(string("[..:Joint]"), format_with("%.10A", *joint));
+  assertEqual(string("Ex:Fo:Gr:Organic"),
+	      format_t::truncate(organic->account->fullname(), 16, true));
+  assertEqual(string("..:Joint"),
+	      format_t::truncate(joint->account->fullname(), 8, true));
+
+  // Other strings are cut off at the end.
+  assertEqual(string("Grocery.."),
+	      format_t::truncate("Grocery Store", 9));
+
+  // A formatted element (%!) is padded but never truncated.
+  assertEqual(string("Grocery Store With A Long Name"),
+	      format_with("%!.5P", *organic));
+}
@@ -0,0 +1,35 @@
+#ifndef _T_FORMAT_H
+#define _T_FORMAT_H
+
+#include "UnitTests.h"
+
+class FormatTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(FormatTestCase);
+
+  CPPUNIT_TEST(testXactAccessors);
+  CPPUNIT_TEST(testAccountAccessors);
+  CPPUNIT_TEST(testAccountNames);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  ledger::session_t  session;
+  ledger::report_t * report;
+
+  FormatTestCase() : report(NULL) {}
+  virtual ~FormatTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testXactAccessors();
+  void testAccountAccessors();
+  void testAccountNames();
+
+private:
+  FormatTestCase(const FormatTestCase &copy);
+  void operator=(const FormatTestCase &copy);
+};
+
+#endif // _T_FORMAT_H
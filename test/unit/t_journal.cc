@@ -0,0 +1,472 @@
+#include "t_journal.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(JournalTestCase, "journal");
+
+// Each test binds its own sessions, possibly on several threads, so
+// none is bound here.
+void JournalTestCase::setUp() {}
+void JournalTestCase::tearDown() {}
+
+namespace {
+  // Bind a session to the calling thread for as long as this lives.
+  struct session_scope_t
+  {
+    session_scope_t(session_t& session) {
+      set_session_context(&session);
+    }
+    ~session_scope_t() {
+      set_session_context();
+    }
+  };
+
+  const char * textual_data =
+    "2008/01/01 Grocery\n"
+    "    Expenses:Food            $12.50\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/01/02 Grocery\n"
+    "    Expenses:Food            $1,000.25\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/01/03 Grocery\n"
+    "    Expenses:Food            10 AAPL @ $30.00\n"
+    "    Assets:Checking\n";
+
+  const char * qif_data =
+    "!Type:Bank\n"
+    "D2008/01/01\n"
+    "T-12.50\n"
+    "N101\n"
+    "PGrocery\n"
+    "LExpenses:Food\n"
+    "^\n"
+    "D2008/01/02\n"
+    "T-1,000.25\n"
+    "N102\n"
+    "PGrocery\n"
+    "LExpenses:Food\n"
+    "^\n";
+
+  // Parse a textual and a QIF journal over and over in a session of its
+  // own, checking each result, so that two of these running at once
+  // would trip over any parser state the sessions shared.
+  struct parse_job_t
+  {
+    std::size_t passes;
+    std::size_t entries;
+    bool	foreign_commodity;
+    bool	wrong_payee;
+    string	error;
+
+    parse_job_t()
+      : passes(0), entries(0), foreign_commodity(false), wrong_payee(false) {}
+
+    void read(session_t& session, const char * data, const char * name,
+	      std::size_t expected)
+    {
+      journal_t * journal = session.create_journal();
+      journal->sources.push_back(path(name));
+
+      std::istringstream in(data);
+      std::size_t count = session.read_journal(*journal, in, path(name));
+      if (count != expected)
+	throw_(std::logic_error, "Read " << count << " entries from "
+	       << name << " instead of " << expected);
+      entries += count;
+
+      foreach (entry_t * entry, journal->entries) {
+	if (*entry->payee != "Grocery")
+	  wrong_payee = true;
+	foreach (xact_t * xact, entry->xacts)
+	  if (xact->amount.has_commodity() &&
+	      &xact->amount.commodity().parent() !=
+	      session.commodity_pool.get())
+	    foreign_commodity = true;
+      }
+
+      session.close_journal(journal);
+    }
+
+    void operator()()
+    {
+      session_t session;
+      set_session_context(&session);
+
+      try {
+	// As in main.cc, the textual parser goes last since it accepts
+	// almost anything.
+	session.register_parser(new qif_parser_t);
+	session.register_parser(new textual_parser_t);
+
+	for (; passes < 50; passes++) {
+	  read(session, textual_data, "test.dat", 3);
+	  read(session, qif_data, "test.qif", 2);
+	}
+      }
+      catch (const std::exception& err) {
+	error = err.what();
+      }
+
+      set_session_context();
+    }
+  };
+}
+
+void JournalTestCase::testConcurrentSessions()
+{
+  parse_job_t first;
+  parse_job_t second;
+
+#if defined(HAVE_BOOST_THREAD) && ! defined(VERIFY_ON)
+  // In verify mode every object made is recorded in one shared map, so
+  // the jobs only run at once when that is off.
+  boost::thread_group workers;
+  workers.create_thread(boost::ref(first));
+  workers.create_thread(boost::ref(second));
+  workers.join_all();
+#else
+  first();
+  second();
+#endif
+
+  assertEqual(string(), first.error);
+  assertEqual(string(), second.error);
+  assertEqual(std::size_t(250), first.entries);
+  assertEqual(std::size_t(250), second.entries);
+  assertFalse(first.foreign_commodity);
+  assertFalse(second.foreign_commodity);
+  assertFalse(first.wrong_payee);
+  assertFalse(second.wrong_payee);
+}
+
+namespace {
+  // The automated entries come after some of the entries they apply to,
+  // so the index is rebuilt with predicates which have already been
+  // compiled.  Virtual postings show up in the account function as
+  // "(Expenses:Food)", so an anchored mask must not match them, even
+  // though they are posted to the same account as real ones.
+  const char * auto_entry_data =
+    "= /^Expenses:Food/\n"
+    "    (Budget:Food)               -1\n"
+    "\n"
+    "2008/01/01 Grocery\n"
+    "    Expenses:Food               $10.00\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/01/02 Grocery\n"
+    "    (Expenses:Food)             $3.00\n"
+    "    Expenses:Food               $5.00\n"
+    "    Assets:Checking\n"
+    "\n"
+    "= /^Expenses:Drink/\n"
+    "    (Budget:Drink)              -1\n"
+    "\n"
+    "2008/01/03 Bar\n"
+    "    Expenses:Drink              $4.00\n"
+    "    (Expenses:Food)             $2.00\n"
+    "    Assets:Checking\n"
+    "\n"
+    "2008/01/04 Grocery\n"
+    "    (Expenses:Food)             $1.00\n"
+    "    Expenses:Food               $6.00\n"
+    "    Assets:Checking\n";
+
+  // The generated postings of an entry, as "account amount" lines.
+  string auto_xacts(const entry_t& entry)
+  {
+    std::ostringstream out;
+    foreach (xact_t * xact, entry.xacts)
+      if (xact->has_flags(XACT_AUTO))
+	out << xact->account->fullname() << ' ' << xact->amount << '\n';
+    return out.str();
+  }
+}
+
+void JournalTestCase::testAutoEntryIndex()
+{
+  session_t	  session;
+  session_scope_t scope(session);
+
+  session.register_parser(new textual_parser_t);
+
+  journal_t * journal = session.create_journal();
+  journal->sources.push_back(path("auto.dat"));
+
+  std::istringstream in(auto_entry_data);
+  assertEqual(std::size_t(4),
+	      session.read_journal(*journal, in, path("auto.dat")));
+
+  assertEqual(std::size_t(2), journal->auto_entries.size());
+  foreach (auto_entry_t * entry, journal->auto_entries)
+    assertTrue(entry->tests_account_only());
+
+  assertEqual(std::size_t(4), journal->entries.size());
+  assertEqual(string("Budget:Food $-10.00\n"),
+	      auto_xacts(*journal->entries[0]));
+  assertEqual(string("Budget:Food $-5.00\n"),
+	      auto_xacts(*journal->entries[1]));
+  assertEqual(string("Budget:Drink $-4.00\n"),
+	      auto_xacts(*journal->entries[2]));
+
+  // By now the verdicts for both kinds of posting to Expenses:Food are
+  // cached, and must still be kept apart.
+  assertEqual(string("Budget:Food $-6.00\n"),
+	      auto_xacts(*journal->entries[3]));
+
+  // A predicate which looks at more than the account is not indexed.
+  auto_entry_t by_amount("amount > 100");
+  assertFalse(by_amount.tests_account_only());
+  auto_entry_t by_account("account =~ /Food/");
+  assertTrue(by_account.tests_account_only());
+}
+
+void JournalTestCase::testXactArena()
+{
+  session_t	  session;
+  session_scope_t scope(session);
+
+  session.register_parser(new textual_parser_t);
+
+  journal_t * journal = session.create_journal();
+  journal->sources.push_back(path("arena.dat"));
+
+  std::istringstream in(textual_data);
+  assertEqual(std::size_t(3),
+	      session.read_journal(*journal, in, path("arena.dat")));
+
+  // Parsed transactions are laid out one after another, in the order
+  // they were read.
+  xact_t * last = NULL;
+  foreach (entry_t * entry, journal->entries)
+    foreach (xact_t * xact, entry->xacts) {
+      assertTrue(xact->has_flags(ITEM_IN_ARENA));
+      if (last)
+	assertTrue(xact == last + 1);
+      last = xact;
+    }
+
+  // A copy is allocated on its own, and is deleted as usual.
+  xact_t * copy = new xact_t(*journal->entries[0]->xacts[0]);
+  assertFalse(copy->has_flags(ITEM_IN_ARENA));
+  checked_delete(copy);
+
+  // A discarded transaction's slot is the next one handed out.
+  xact_t * discarded = journal->make_xact();
+  journal->discard_xact(discarded);
+  xact_t * reused = journal->make_xact();
+  assertTrue(reused == discarded);
+  journal->discard_xact(reused);
+}
+
+namespace {
+  // A journal of many entries, mixing ones which get automated postings
+  // of their own, ones whose two commodities imply a cost, and ones with
+  // a posting whose amount is left to be inferred.
+  string balancing_data(std::size_t count)
+  {
+    std::ostringstream out;
+    out << "= /^Expenses:Food/\n"
+	<< "    Expenses:Tax                $0.10\n"
+	<< "    Liabilities:Tax             $-0.10\n"
+	<< "\n";
+
+    for (std::size_t i = 0; i < count; i++) {
+      out << "2008/" << (i % 12 + 1) << '/' << (i % 28 + 1)
+	  << " Payee " << i << '\n';
+      switch (i % 3) {
+      case 0:
+	out << "    Expenses:Food               $" << i << ".25\n"
+	    << "    Assets:Checking\n";
+	break;
+      case 1:
+	out << "    Assets:Brokerage            " << (i % 10 + 1) << " AAPL\n"
+	    << "    Assets:Checking             $-" << i * 3 << ".00\n";
+	break;
+      case 2:
+	out << "    Expenses:Rent               " << i << " EUR\n"
+	    << "    Expenses:Food               $" << i << ".50\n"
+	    << "    Assets:Checking             $-" << i << ".50\n"
+	    << "    Assets:Savings\n";
+	break;
+      }
+      out << '\n';
+    }
+    return out.str();
+  }
+
+  // Read data in a session of its own, finalizing its entries with the
+  // given number of jobs, and describe every posting that results.
+  string balanced_postings(const string& data, unsigned int jobs)
+  {
+    session_t	    session;
+    session_scope_t scope(session);
+
+    session.finalize_jobs = jobs;
+    session.register_parser(new textual_parser_t);
+
+    journal_t * journal = session.create_journal();
+    journal->sources.push_back(path("balance.dat"));
+
+    std::istringstream in(data);
+    std::size_t count = session.read_journal(*journal, in,
+					     path("balance.dat"));
+
+    std::ostringstream out;
+    out << count << " entries\n";
+    foreach (entry_t * entry, journal->entries) {
+      out << *entry->payee << '\n';
+      foreach (xact_t * xact, entry->xacts) {
+	out << "  " << xact->account->fullname() << ' ' << xact->amount;
+	if (xact->cost)
+	  out << " @@ " << *xact->cost;
+	if (xact->has_flags(XACT_AUTO))
+	  out << " (auto)";
+	out << '\n';
+      }
+    }
+    return out.str();
+  }
+}
+
+void JournalTestCase::testThreadedBalancing()
+{
+  // With 640 entries in one batch, add_entries gives each of four jobs
+  // a share well above its minimum, so they really do run at once
+  // (unless threads are unavailable, or verify mode is on).
+  string data(balancing_data(640));
+
+  string sequential(balanced_postings(data, 1));
+  assertEqual(string("640 entries\n"),
+	      sequential.substr(0, sequential.find('\n') + 1));
+  assertTrue(sequential.find("(auto)") != string::npos);
+  assertTrue(sequential.find(" @@ ") != string::npos);
+
+  assertEqual(sequential, balanced_postings(data, 4));
+}
+
+namespace {
+  // Produce a register or a balance report over a frozen session, with
+  // a report and report data of its own, as many times as asked.  Each
+  // job may use effective dates or not, without affecting the other.
+  struct report_job_t
+  {
+    session_t&	session;
+    bool	balance;
+    bool	effective;
+    std::size_t passes;
+    string	output;
+    string	error;
+
+    report_job_t(session_t& _session, bool _balance, bool _effective,
+		 std::size_t _passes = 1)
+      : session(_session), balance(_balance), effective(_effective),
+	passes(_passes) {}
+
+    void run() {
+      report_t	     report(session);
+      report_xdata_t xdata;
+      set_report_context(&report, &xdata);
+
+      push_variable<bool> save_use_effective_date(item_t::use_effective_date,
+						  effective);
+
+      std::ostringstream out;
+      report.output_stream = &out;
+
+      if (balance) {
+	report.display_predicate = "total";
+	report.accounts_report
+	  (acct_handler_ptr(new format_accounts(report,
+						session.balance_format)));
+      } else {
+	report.predicate = "account =~ /^Expenses/";
+	report.xacts_report
+	  (xact_handler_ptr(new format_xacts(report,
+					     session.register_format)));
+      }
+
+      set_report_context();
+      output += out.str();
+    }
+
+    void operator()()
+    {
+      // The sequential runs happen on a thread which is already bound.
+      bool bind = session_t::current != &session;
+      if (bind)
+	set_session_context(&session);
+
+      try {
+	for (std::size_t pass = 0; pass < passes; pass++)
+	  run();
+      }
+      catch (const std::exception& err) {
+	error = err.what();
+      }
+
+      if (bind)
+	set_session_context();
+    }
+  };
+}
+
+void JournalTestCase::testFrozenReports()
+{
+  session_t	  session;
+  session_scope_t scope(session);
+
+  session.register_parser(new textual_parser_t);
+
+  journal_t * journal = session.create_journal();
+  journal->sources.push_back(path("frozen.dat"));
+
+  string data(balancing_data(200));
+  data += ("2009/01/31=2009/02/02 Grocery\n"
+	   "    Expenses:Food               $15.00\n"
+	   "    Assets:Checking\n");
+
+  std::istringstream in(data);
+  assertEqual(std::size_t(201),
+	      session.read_journal(*journal, in, path("frozen.dat")));
+
+  session.freeze();
+
+  report_job_t reg(session, false, true);
+  report_job_t bal(session, true, false);
+  reg();
+  bal();
+  assertEqual(string(), reg.error);
+  assertEqual(string(), bal.error);
+  assertFalse(reg.output.empty());
+  assertFalse(bal.output.empty());
+
+  report_job_t actual(session, false, false);
+  actual();
+  assertNotEqual(reg.output, actual.output);
+
+  const std::size_t passes = 10;
+  report_job_t reg_again(session, false, true, passes);
+  report_job_t bal_again(session, true, false, passes);
+
+#if defined(HAVE_BOOST_THREAD) && ! defined(VERIFY_ON)
+  boost::thread_group workers;
+  workers.create_thread(boost::ref(reg_again));
+  workers.create_thread(boost::ref(bal_again));
+  workers.join_all();
+#else
+  reg_again();
+  bal_again();
+#endif
+
+  assertEqual(string(), reg_again.error);
+  assertEqual(string(), bal_again.error);
+
+  string reg_expected;
+  string bal_expected;
+  for (std::size_t pass = 0; pass < passes; pass++) {
+    reg_expected += reg.output;
+    bal_expected += bal.output;
+  }
+  assertEqual(reg_expected, reg_again.output);
+  assertEqual(bal_expected, bal_again.output);
+}
@@ -0,0 +1,36 @@
+#ifndef _T_JOURNAL_H
+#define _T_JOURNAL_H
+
+#include "UnitTests.h"
+
+class JournalTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(JournalTestCase);
+
+  CPPUNIT_TEST(testConcurrentSessions);
+  CPPUNIT_TEST(testAutoEntryIndex);
+  CPPUNIT_TEST(testXactArena);
+  CPPUNIT_TEST(testThreadedBalancing);
+  CPPUNIT_TEST(testFrozenReports);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  JournalTestCase() {}
+  virtual ~JournalTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testConcurrentSessions();
+  void testAutoEntryIndex();
+  void testXactArena();
+  void testThreadedBalancing();
+  void testFrozenReports();
+
+private:
+  JournalTestCase(const JournalTestCase &copy);
+  void operator=(const JournalTestCase &copy);
+};
+
+#endif // _T_JOURNAL_H
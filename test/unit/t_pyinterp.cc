@@ -0,0 +1,75 @@
+#include "t_pyinterp.h"
+
+#include "pyinterp.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(PyInterpTestCase, "utility");
+
+void PyInterpTestCase::setUp()
+{
+  ledger::set_session_context(&session);
+}
+
+void PyInterpTestCase::tearDown()
+{
+  ledger::set_session_context();
+}
+
+namespace {
+  typedef python_interpreter_t::global_t global_t;
+
+  // What the name resolved by `def' is bound to now, as a long.
+  long bound_value(expr_t::ptr_op_t def)
+  {
+    global_t * global = def->as_function_lval().target<global_t>();
+    assertTrue(global);
+
+    optional<boost::python::object> bound(global->resolve());
+    assertTrue(bound);
+    return boost::python::extract<long>(*bound);
+  }
+}
+
+void PyInterpTestCase::testFunctorCache()
+{
+  // The interpreter finalizes Python when it is destroyed, which can
+  // only be done once, so all of this is checked with the one.
+  python_interpreter_t python(session);
+
+  python.eval("target = 1\n"
+	      "\n"
+	      "def rebind():\n"
+	      "    global target\n"
+	      "    target = 2\n",
+	      python_interpreter_t::PY_EVAL_MULTI);
+
+  // Names are resolved from the namespace and the builtins, once each.
+  expr_t::ptr_op_t target = python.lookup("target");
+  assertTrue(target);
+  assertTrue(target == python.lookup("target"));
+  assertEqual(1L, bound_value(target));
+
+  assertTrue(python.lookup("len"));
+  assertFalse(python.lookup("undefined_name"));
+
+  // A function which rebinds a global behind the interpreter's back,
+  // called from an expression, leaves the cache as it is; the cached
+  // functor must still see the new binding.
+  python.eval("rebind()");
+  assertTrue(target == python.lookup("target"));
+  assertEqual(2L, bound_value(target));
+
+  // Evaluating a statement clears the cache, and so does importing a
+  // module, whose top-level names are copied into the namespace.
+  python.eval("target = 3", python_interpreter_t::PY_EVAL_STMT);
+  expr_t::ptr_op_t after_stmt = python.lookup("target");
+  assertTrue(after_stmt != target);
+  assertEqual(3L, bound_value(after_stmt));
+
+  python.eval("undefined_name = 4", python_interpreter_t::PY_EVAL_STMT);
+  assertTrue(python.lookup("undefined_name"));
+
+  python.import("string");
+  expr_t::ptr_op_t after_import = python.lookup("target");
+  assertTrue(after_import != after_stmt);
+  assertEqual(3L, bound_value(after_import));
+}
@@ -0,0 +1,30 @@
+#ifndef _T_PYINTERP_H
+#define _T_PYINTERP_H
+
+#include "UnitTests.h"
+
+class PyInterpTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(PyInterpTestCase);
+
+  CPPUNIT_TEST(testFunctorCache);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  ledger::session_t session;
+
+  PyInterpTestCase() {}
+  virtual ~PyInterpTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testFunctorCache();
+
+private:
+  PyInterpTestCase(const PyInterpTestCase &copy);
+  void operator=(const PyInterpTestCase &copy);
+};
+
+#endif // _T_PYINTERP_H
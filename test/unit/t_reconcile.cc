@@ -0,0 +1,104 @@
+#include "t_reconcile.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(ReconcileTestCase, "journal");
+
+void ReconcileTestCase::setUp()
+{
+  ledger::set_session_context(&session);
+}
+
+void ReconcileTestCase::tearDown()
+{
+  ledger::set_session_context();
+}
+
+namespace {
+  // Pass xacts through reconcile_xacts, and return those it kept.
+  xacts_list reconcile(std::vector<xact_t *>& xacts, const string& balance)
+  {
+    xacts_list matched;
+    reconcile_xacts reconciler
+      (xact_handler_ptr(new push_to_xacts_list(matched)),
+       value_t(amount_t(balance)), date_t());
+
+    foreach (xact_t * xact, xacts)
+      reconciler(*xact);
+    reconciler.flush();
+
+    return matched;
+  }
+}
+
+void ReconcileTestCase::testFoundSubset()
+{
+  xact_t x1(NULL, amount_t("$10.00"));
+  xact_t x2(NULL, amount_t("$2.50"));
+  xact_t x3(NULL, amount_t("$7.25"));
+  xact_t x4(NULL, amount_t("$-1.75"));
+
+  std::vector<xact_t *> xacts;
+  xacts.push_back(&x1);
+  xacts.push_back(&x2);
+  xacts.push_back(&x3);
+  xacts.push_back(&x4);
+
+  // Only $10.00 and $-1.75 add up to $8.25.
+  xacts_list matched(reconcile(xacts, "$8.25"));
+
+  assertEqual(std::size_t(2), matched.size());
+  assertTrue(matched[0] == &x1);
+  assertTrue(matched[1] == &x4);
+}
+
+void ReconcileTestCase::testFoundComplement()
+{
+  xact_t x1(NULL, amount_t("$10.00"));
+  xact_t x2(NULL, amount_t("$2.50"));
+  xact_t x3(NULL, amount_t("$7.25"));
+  xact_t x4(NULL, amount_t("$-1.75"));
+
+  std::vector<xact_t *> xacts;
+  xacts.push_back(&x1);
+  xacts.push_back(&x2);
+  xacts.push_back(&x3);
+  xacts.push_back(&x4);
+
+  // $15.50 is nearer the pending total of $18.00 than it is to zero, so
+  // the search looks for the $2.50 to leave out instead.
+  xacts_list matched(reconcile(xacts, "$15.50"));
+
+  assertEqual(std::size_t(3), matched.size());
+  assertTrue(matched[0] == &x1);
+  assertTrue(matched[1] == &x3);
+  assertTrue(matched[2] == &x4);
+}
+
+void ReconcileTestCase::testNotFound()
+{
+  xact_t x1(NULL, amount_t("$10.00"));
+  xact_t x2(NULL, amount_t("$2.50"));
+  xact_t x3(NULL, amount_t("$7.25"));
+
+  std::vector<xact_t *> xacts;
+  xacts.push_back(&x1);
+  xacts.push_back(&x2);
+  xacts.push_back(&x3);
+
+  assertThrow(reconcile(xacts, "$1.00"), std::runtime_error);
+  assertThrow(reconcile(xacts, "$12.00"), std::runtime_error);
+}
+
+void ReconcileTestCase::testOverflow()
+{
+  // Each of these fits in a long, but their sum does not.
+  xact_t x1(NULL, amount_t("3000000000000000000"));
+  xact_t x2(NULL, amount_t("3000000000000000000"));
+  xact_t x3(NULL, amount_t("1"));
+
+  std::vector<xact_t *> xacts;
+  xacts.push_back(&x1);
+  xacts.push_back(&x2);
+  xacts.push_back(&x3);
+
+  assertThrow(reconcile(xacts, "3000000000000000001"), std::runtime_error);
+}
@@ -0,0 +1,36 @@
+#ifndef _T_RECONCILE_H
+#define _T_RECONCILE_H
+
+#include "UnitTests.h"
+
+class ReconcileTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(ReconcileTestCase);
+
+  CPPUNIT_TEST(testFoundSubset);
+  CPPUNIT_TEST(testFoundComplement);
+  CPPUNIT_TEST(testNotFound);
+  CPPUNIT_TEST(testOverflow);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  ledger::session_t session;
+
+  ReconcileTestCase() {}
+  virtual ~ReconcileTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testFoundSubset();
+  void testFoundComplement();
+  void testNotFound();
+  void testOverflow();
+
+private:
+  ReconcileTestCase(const ReconcileTestCase &copy);
+  void operator=(const ReconcileTestCase &copy);
+};
+
+#endif // _T_RECONCILE_H